@@ -0,0 +1,91 @@
+/*
+ * Copyright (C) 2004-2018 David Bernstein <david.h.bernstein@gmail.com>
+ *
+ * This file is part of utility_cpp.
+ *
+ * utility_cpp is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * utility_cpp is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with utility_cpp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _choleskyfactorization_h_
+#define _choleskyfactorization_h_
+
+#include "utility.h"
+#include "realmatrix.h"
+
+namespace utility {
+	// Cholesky factorization A = L L^T of a symmetric positive definite
+	// matrix, about half the work of LU and no pivoting
+	// only the lower triangle of A is read
+	class CholeskyFactorization {
+	public:
+		// Constructors
+		CholeskyFactorization(void);
+		CholeskyFactorization(const Matrix<double> &a);
+		
+		// Destructor
+		~CholeskyFactorization(void) { };
+		
+		// factorization
+		void Factor(const Matrix<double> &a);
+		bool Factored(void) const;
+		bool PositiveDefinite(void) const;
+		long Size(void) const;
+		
+		// solves A x = b for every column of b, b is overwritten with x
+		void Solve(Matrix<double> &b) const;
+		void Solve(const Matrix<double> &b, Matrix<double> &x) const;
+		
+		// log of the determinant, which can't overflow the way the
+		// determinant itself does for large matrices
+		double LogDeterminant(void) const;
+		double Determinant(void) const;
+		void Inverse(Matrix<double> &inv) const;
+		
+		// the factor L, zero above the diagonal
+		void GetL(Matrix<double> &l) const;
+		
+	private:
+		void CheckSolvable(void) const;
+		
+	private:
+		// L on and below the diagonal, the upper triangle is not used
+		Matrix<double> mL;
+		
+		// false if a non-positive pivot was found
+		bool mPositiveDefinite;
+	};
+	
+	
+	
+	inline bool CholeskyFactorization::Factored() const
+	{
+		return mL.NumRows() > 0;
+	}
+	
+	
+	
+	inline bool CholeskyFactorization::PositiveDefinite() const
+	{
+		return mPositiveDefinite;
+	}
+	
+	
+	
+	inline long CholeskyFactorization::Size() const
+	{
+		return mL.NumRows();
+	}
+}
+
+#endif // _choleskyfactorization_h_
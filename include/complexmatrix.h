@@ -22,13 +22,21 @@
 
 #include "utility.h"
 #include "complexnumber.h"
+#include "matrixexpression.h"
+#include "workspacepool.h"
+
+#include <memory>
 
 namespace utility {
-	class ComplexMatrix {
+	class ComplexMatrix : public MatrixExpression<ComplexMatrix, ComplexNumber> {
     public:
 		// Constructor
 		ComplexMatrix(long numRows = 0, long numColumns = 0);
         
+        // evaluates a lazy expression such as A + B - C.Conjugate()
+        template<class E>
+        ComplexMatrix(const MatrixExpression<E, ComplexNumber> &e);
+        
 		// Destructor
 		virtual ~ComplexMatrix(void);
         void Erase(void);
@@ -42,16 +50,40 @@ namespace utility {
 		const ComplexNumber& operator()(long i, long j) const;
         ComplexMatrix operator*(const ComplexMatrix &m) const;
 		ComplexMatrix& operator*=(ComplexNumber a);
-        const ComplexMatrix operator+(const ComplexMatrix &a) const;
-        const ComplexMatrix operator-(const ComplexMatrix &a) const;
         ComplexMatrix& operator+=(const ComplexMatrix &m);
+        
+        // operator* is CLASSICAL_MULTIPLY, STRASSEN_MULTIPLY pays off for
+        // large square products, see StrassenMultiplier for its error
+        // bound and to keep the workspace between products
+        ComplexMatrix Multiply(const ComplexMatrix &m, MatrixMultiplyType type) const;
+        
+        // + and - (and scalar *) are defined in matrixexpression.h and are
+        // evaluated on assignment
+        template<class E>
+        ComplexMatrix& operator=(const MatrixExpression<E, ComplexNumber> &e);
+        template<class E>
+        ComplexMatrix& operator+=(const MatrixExpression<E, ComplexNumber> &e);
+        
+        // element access without range checking, used by the expressions
+        const ComplexNumber& Element(long i, long j) const;
 		
-        // Matrix functions
+        // Matrix functions, Conjugate() and Eval() are inherited from
+        // MatrixExpression
         ComplexMatrix Transpose(void) const;
-        ComplexMatrix Conjugate(void) const;
         ComplexMatrix Adjoint(void) const;
+        void TransposeInPlace(void);
+        void AdjointInPlace(void);
+        
+        // exp of a square matrix, see MatrixExponential to keep the work
+        // matrices between calls
+        ComplexMatrix Exponential(void) const;
+        
+        // the Frobenius inner product tr(A^H m), the norm and distance that
+        // go with it and tr(A m), each in one pass over the elements with
+        // no temporaries
         ComplexNumber InnerProduct(const ComplexMatrix &m) const;
         ComplexNumber Trace(void) const;
+        ComplexNumber TraceOfProduct(const ComplexMatrix &m) const;
         double Norm(void) const;
         double Distance(const ComplexMatrix &m) const;
         ComplexMatrix TensorProduct(const ComplexMatrix &m) const;
@@ -61,6 +93,12 @@ namespace utility {
 		long NumRows(void) const;
 		long NumColumns(void) const;
 		
+		// raw access to the contiguous row-major storage, element (i, j)
+		// lives at Data()[i * Stride() + j]
+		ComplexNumber* Data(void);
+		const ComplexNumber* Data(void) const;
+		long Stride(void) const;
+		
 		// various matrix operations
         double Determinant(void) const;
         void MakeRandom(long seed = 1);
@@ -76,8 +114,11 @@ namespace utility {
         long mRows;
 		long mColumns;
         
-		// data pointer
-		ComplexNumber **mpData;
+        // distance in elements between the starts of consecutive rows
+        long mStride;
+        
+		// data pointer, a single row-major block of mRows * mStride elements
+		ComplexNumber *mpData;
 	};
     
     
@@ -87,7 +128,7 @@ namespace utility {
         if ((i >= mRows) || (i < 0) || (j >= mColumns) || (j < 0))
             ThrowOutOfRangeException();
         
-        return mpData[i][j];
+        return mpData[i * mStride + j];
 	}
 	
     
@@ -97,7 +138,7 @@ namespace utility {
 		if ((i >= mRows) || (i < 0) || (j >= mColumns) || (j < 0))
 			ThrowOutOfRangeException();
         
-		return mpData[i][j];
+		return mpData[i * mStride + j];
 	}
 	
     
@@ -107,6 +148,7 @@ namespace utility {
         mpData = NULL;
         mRows = 0;
         mColumns = 0;
+        mStride = 0;
         
         SetSize(numRows, numColumns);
         
@@ -126,14 +168,12 @@ namespace utility {
     inline void ComplexMatrix::Erase()
 	{
         if (mpData != NULL) {
-            for (long i = 0; i < mRows; ++i)
-                delete [] mpData[i];
-            
-            delete [] mpData;
+            WorkspaceRelease(mpData, mRows * mStride * sizeof(ComplexNumber));
             
             mpData = NULL;
             mRows = 0;
             mColumns = 0;
+            mStride = 0;
         }
         else {
             if ((mRows > 0) || (mColumns > 0))
@@ -149,6 +189,11 @@ namespace utility {
 	// copy constructor
     inline ComplexMatrix::ComplexMatrix(const ComplexMatrix &m)
 	{
+        mpData = NULL;
+        mRows = 0;
+        mColumns = 0;
+        mStride = 0;
+        
         *this = m;
         return;
 	}
@@ -164,9 +209,10 @@ namespace utility {
         SetSize(m.mRows, m.mColumns);
         
         for (long i = 0; i < mRows; ++i) {
-            for (long j = 0; j < mColumns; ++j) {
-                mpData[i][j] = m.mpData[i][j];
-            }
+            ComplexNumber *row = mpData + i * mStride;
+            const ComplexNumber *mRow = m.mpData + i * m.mStride;
+            for (long j = 0; j < mColumns; ++j) 
+                row[j] = mRow[j];
         }
         
         return *this;
@@ -190,10 +236,13 @@ namespace utility {
         
         mRows = numRows;
         mColumns = numColumns;
+        mStride = numColumns;
         
-        mpData = new ComplexNumber*[mRows];
-        for (long i = 0; i < mRows; ++i)
-            mpData[i] = new ComplexNumber[mColumns];
+        // one block for the whole matrix, rows are stored back to back, the
+        // block is recycled through workspacepool.h as raw memory, so the
+        // ComplexNumbers are constructed in it, as zeros
+        mpData = static_cast<ComplexNumber*>(WorkspaceAllocate(mRows * mStride * sizeof(ComplexNumber)));
+        std::uninitialized_fill_n(mpData, mRows * mStride, ComplexNumber(0.0, 0.0));
         
         return;
 	}
@@ -214,37 +263,94 @@ namespace utility {
 	
     
     
-    inline const ComplexMatrix ComplexMatrix::operator+(const ComplexMatrix &a) const
+    inline const ComplexNumber& ComplexMatrix::Element(long i, long j) const
+    {
+        return mpData[i * mStride + j];
+    }
+    
+    
+    
+    template<class E>
+    inline ComplexMatrix::ComplexMatrix(const MatrixExpression<E, ComplexNumber> &e)
+    {
+        mpData = NULL;
+        mRows = 0;
+        mColumns = 0;
+        mStride = 0;
+        
+        *this = e;
+        return;
+    }
+    
+    
+    
+    template<class E>
+    inline ComplexMatrix& ComplexMatrix::operator=(const MatrixExpression<E, ComplexNumber> &e)
     {
-        ComplexMatrix result(mRows, mColumns);
+        // every expression is elementwise so it is safe for this matrix to
+        // appear in e, in which case the size can't change
+        const E &expression = e.Expression();
+        SetSize(expression.NumRows(), expression.NumColumns());
         
         for (long i = 0; i < mRows; ++i) {
-            for (long j = 0; j < mColumns; ++j) {
-                result(i, j) = mpData[i][j] + a(i, j);
-            }
+            ComplexNumber *row = mpData + i * mStride;
+            for (long j = 0; j < mColumns; ++j) 
+                row[j] = expression.Element(i, j);
         }
         
-        return result;
+        return *this;
     }
     
     
     
-    inline const ComplexMatrix ComplexMatrix::operator-(const ComplexMatrix &a) const
+    template<class E>
+    inline ComplexMatrix& ComplexMatrix::operator+=(const MatrixExpression<E, ComplexNumber> &e)
     {
-        ComplexMatrix result(mRows, mColumns);
+        const E &expression = e.Expression();
+        if ((expression.NumRows() != mRows) || (expression.NumColumns() != mColumns))
+            ThrowException("ComplexMatrix::operator+= : matrices are different sizes");
         
         for (long i = 0; i < mRows; ++i) {
-            for (long j = 0; j < mColumns; ++j) {
-                result(i, j) = mpData[i][j] - a(i, j);
-            }
+            ComplexNumber *row = mpData + i * mStride;
+            for (long j = 0; j < mColumns; ++j) 
+                row[j] += expression.Element(i, j);
         }
-
         
-        return result;
+        return *this;
     }
     
     
     
+    // a real scalar on the right, without this ComplexMatrix(long) would
+    // make m * 2.0 ambiguous with the matrix product
+    inline ScaledMatrix<ComplexMatrix, double, ComplexNumber> operator*(const ComplexMatrix &m, double a)
+    {
+        return ScaledMatrix<ComplexMatrix, double, ComplexNumber>(a, m);
+    }
+    
+    
+    
+    inline ComplexNumber* ComplexMatrix::Data()
+	{
+		return mpData;
+	}
+	
+	
+	
+    inline const ComplexNumber* ComplexMatrix::Data() const
+	{
+		return mpData;
+	}
+	
+	
+	
+    inline long ComplexMatrix::Stride() const
+	{
+		return mStride;
+	}
+	
+    
+    
     inline void ComplexMatrix::ThrowOutOfRangeException() const
 	{
 		ThrowException("Matrix index out of range");
@@ -22,8 +22,7 @@
 
 #include <math.h>
 #include "utility.h"
-
-#define PI 3.14159265358979
+#include "constants.h"
 
 namespace utility {
     class ComplexNumber
@@ -52,6 +51,7 @@ namespace utility {
         const ComplexNumber operator*(const ComplexNumber &a) const;
         const ComplexNumber operator/(const ComplexNumber &a) const;
         ComplexNumber& operator+=(const ComplexNumber &a);
+        ComplexNumber& operator-=(const ComplexNumber &a);
         ComplexNumber& operator*=(const ComplexNumber &a);
 
         // conjugate
@@ -168,6 +168,15 @@ namespace utility {
     
     
     
+    inline ComplexNumber& ComplexNumber::operator-=(const ComplexNumber &a)
+    {
+        mReal -= a.mReal;
+        mImaginary -= a.mImaginary;
+        return *this;
+    }
+    
+    
+    
     inline ComplexNumber& ComplexNumber::operator*=(const ComplexNumber &a)
     {
         ComplexNumber tmp = *this;
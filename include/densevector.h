@@ -0,0 +1,228 @@
+/*
+ * Copyright (C) 2004-2018 David Bernstein <david.h.bernstein@gmail.com>
+ *
+ * This file is part of utility_cpp.
+ *
+ * utility_cpp is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * utility_cpp is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with utility_cpp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _densevector_h_
+#define _densevector_h_
+
+#include "utility.h"
+#include "workspacepool.h"
+
+#include <algorithm>
+#include <memory>
+
+namespace utility {
+	// a contiguous vector of double, float or ComplexNumber for the
+	// matrix-vector kernels in gemv.h, the storage is recycled through
+	// workspacepool.h like that of the matrices, and a new or resized
+	// vector is all zeros
+	template<class T>
+	class DenseVector {
+	public:
+		// Constructor
+		DenseVector(long size = 0);
+
+		// Destructor
+		~DenseVector(void);
+		void Erase(void);
+
+		// copy constructor
+		DenseVector(const DenseVector<T> &v);
+
+		// operators
+		DenseVector<T>& operator=(const DenseVector<T> &v);
+		T& operator()(long i);
+		const T& operator()(long i) const;
+
+		// Sets and Gets, SetSize keeps the storage if the size is unchanged
+		void SetSize(long size);
+		long Size(void) const;
+
+		// raw access to the contiguous storage
+		T* Data(void);
+		const T* Data(void) const;
+
+		void MakeZero(void);
+
+	protected:
+		void ThrowOutOfRangeException(void) const;
+
+	protected:
+		long mSize;
+		T *mpData;
+	};
+
+
+
+	template<class T>
+	inline T& DenseVector<T>::operator()(long i)
+	{
+		if ((i >= mSize) || (i < 0))
+			ThrowOutOfRangeException();
+
+		return mpData[i];
+	}
+
+
+
+	template<class T>
+	inline const T& DenseVector<T>::operator()(long i) const
+	{
+		if ((i >= mSize) || (i < 0))
+			ThrowOutOfRangeException();
+
+		return mpData[i];
+	}
+
+
+
+	template<class T>
+	inline DenseVector<T>::DenseVector(long size)
+	{
+		mpData = NULL;
+		mSize = 0;
+
+		SetSize(size);
+
+		return;
+	}
+
+
+
+	template<class T>
+	inline DenseVector<T>::~DenseVector()
+	{
+		Erase();
+		return;
+	}
+
+
+
+	template<class T>
+	inline void DenseVector<T>::Erase()
+	{
+		if (mpData != NULL) {
+			WorkspaceRelease(mpData, mSize * sizeof(T));
+
+			mpData = NULL;
+			mSize = 0;
+		}
+
+		return;
+	}
+
+
+
+	// copy constructor
+	template<class T>
+	inline DenseVector<T>::DenseVector(const DenseVector<T> &v)
+	{
+		mpData = NULL;
+		mSize = 0;
+
+		*this = v;
+		return;
+	}
+
+
+
+	template<class T>
+	inline DenseVector<T>& DenseVector<T>::operator=(const DenseVector<T> &v)
+	{
+		// check for assignment to self
+		if (this == &v)
+			return *this;
+
+		// SetSize has constructed the elements, so they can be assigned
+		SetSize(v.mSize);
+		std::copy(v.mpData, v.mpData + mSize, mpData);
+
+		return *this;
+	}
+
+
+
+	template<class T>
+	inline void DenseVector<T>::SetSize(long size)
+	{
+		if (mSize == size)
+			return;
+
+		Erase();
+
+		if (size < 0)
+			ThrowException("DenseVector : negative size");
+
+		if (size == 0)
+			return;
+
+		mSize = size;
+		// the pooled block is raw memory, construct the elements in it as
+		// zeros, T() is 0.0 for each of the element types
+		mpData = static_cast<T*>(WorkspaceAllocate(mSize * sizeof(T)));
+		std::uninitialized_fill_n(mpData, mSize, T());
+
+		return;
+	}
+
+
+
+	template<class T>
+	inline long DenseVector<T>::Size() const
+	{
+		return mSize;
+	}
+
+
+
+	template<class T>
+	inline T* DenseVector<T>::Data()
+	{
+		return mpData;
+	}
+
+
+
+	template<class T>
+	inline const T* DenseVector<T>::Data() const
+	{
+		return mpData;
+	}
+
+
+
+	template<class T>
+	inline void DenseVector<T>::MakeZero()
+	{
+		// T() is 0.0 for each of the element types
+		std::fill_n(mpData, mSize, T());
+
+		return;
+	}
+
+
+
+	template<class T>
+	inline void DenseVector<T>::ThrowOutOfRangeException() const
+	{
+		ThrowException("DenseVector index out of range");
+		return;
+	}
+}
+
+#endif // _densevector_h_
@@ -0,0 +1,607 @@
+/*
+ * Copyright (C) 2004-2018 David Bernstein <david.h.bernstein@gmail.com>
+ *
+ * This file is part of utility_cpp.
+ *
+ * utility_cpp is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * utility_cpp is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with utility_cpp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _fixedmatrix_h_
+#define _fixedmatrix_h_
+
+#include "utility.h"
+#include "complexnumber.h"
+
+// Small dense matrices whose size is a template parameter. The elements live
+// inside the object (no heap, no virtual destructor) and every loop has a
+// compile-time trip count, so for the 2x2 to 4x4 blocks these are meant for
+// the compiler unrolls everything and keeps the elements in registers.
+// Determinants and inverses up to 4x4 are written out in closed form.
+//
+// Element access is not range checked. T is double or ComplexNumber.
+// CopyFrom and CopyTo move a block between a FixedMatrix and any of the dense
+// matrices (Matrix<double>, ComplexMatrix) through their row-major storage.
+
+namespace utility {
+	// the few things the algorithms need to know about the element type
+	template<class T>
+	struct FixedMatrixScalar;
+
+	template<>
+	struct FixedMatrixScalar<double> {
+		static double One(void) { return 1.0; }
+		static double Magnitude(double x) { return fabs(x); }
+	};
+
+	template<>
+	struct FixedMatrixScalar<ComplexNumber> {
+		static ComplexNumber One(void) { return ComplexNumber(1.0, 0.0); }
+		static double Magnitude(const ComplexNumber &z) { return z.Modulus(); }
+	};
+
+
+
+	template<class T, long R, long C>
+	class FixedMatrix {
+	public:
+		// Constructor, the elements are not initialized
+		FixedMatrix(void) { };
+
+		// operators
+		T& operator()(long i, long j);
+		const T& operator()(long i, long j) const;
+		FixedMatrix<T, R, C> operator+(const FixedMatrix<T, R, C> &m) const;
+		FixedMatrix<T, R, C> operator-(const FixedMatrix<T, R, C> &m) const;
+		FixedMatrix<T, R, C>& operator+=(const FixedMatrix<T, R, C> &m);
+		FixedMatrix<T, R, C>& operator-=(const FixedMatrix<T, R, C> &m);
+		FixedMatrix<T, R, C>& operator*=(const T &a);
+
+		template<long K>
+		FixedMatrix<T, R, K> operator*(const FixedMatrix<T, C, K> &m) const;
+
+		// matrix functions, Determinant and Inverse need R == C and Inverse
+		// throws if the matrix is singular
+		FixedMatrix<T, C, R> Transpose(void) const;
+		T Determinant(void) const;
+		FixedMatrix<T, R, C> Inverse(void) const;
+		T Trace(void) const;
+
+		void MakeZero(void);
+		void MakeIdentity(void);
+
+		// copies the R x C block of m starting at (i0, j0) in or out
+		template<class M>
+		void CopyFrom(const M &m, long i0 = 0, long j0 = 0);
+		template<class M>
+		void CopyTo(M &m, long i0 = 0, long j0 = 0) const;
+
+		// Sets and Gets
+		long NumRows(void) const;
+		long NumColumns(void) const;
+		T* Data(void);
+		const T* Data(void) const;
+
+	private:
+		// row-major
+		T mData[R * C];
+	};
+
+
+
+	// closed forms for N <= 4 and Gaussian elimination with partial pivoting
+	// above that, a and inverse are N x N row-major and Inverse returns false
+	// if a is singular
+	template<class T, long N>
+	struct FixedMatrixAlgebra {
+		static T Determinant(const T *a);
+		static bool Inverse(const T *a, T *inverse);
+	};
+
+
+
+	template<class T>
+	struct FixedMatrixAlgebra<T, 1> {
+		static T Determinant(const T *a)
+		{
+			return a[0];
+		}
+
+		static bool Inverse(const T *a, T *inverse)
+		{
+			if (FixedMatrixScalar<T>::Magnitude(a[0]) == 0.0)
+				return false;
+
+			inverse[0] = FixedMatrixScalar<T>::One() / a[0];
+			return true;
+		}
+	};
+
+
+
+	template<class T>
+	struct FixedMatrixAlgebra<T, 2> {
+		static T Determinant(const T *a)
+		{
+			return a[0] * a[3] - a[1] * a[2];
+		}
+
+		static bool Inverse(const T *a, T *inverse)
+		{
+			T det = Determinant(a);
+			if (FixedMatrixScalar<T>::Magnitude(det) == 0.0)
+				return false;
+
+			T d = FixedMatrixScalar<T>::One() / det;
+			T zero = T();
+			inverse[0] = a[3] * d;
+			inverse[1] = (zero - a[1]) * d;
+			inverse[2] = (zero - a[2]) * d;
+			inverse[3] = a[0] * d;
+
+			return true;
+		}
+	};
+
+
+
+	template<class T>
+	struct FixedMatrixAlgebra<T, 3> {
+		static T Determinant(const T *a)
+		{
+			return a[0] * (a[4] * a[8] - a[5] * a[7])
+				 - a[1] * (a[3] * a[8] - a[5] * a[6])
+				 + a[2] * (a[3] * a[7] - a[4] * a[6]);
+		}
+
+		static bool Inverse(const T *a, T *inverse)
+		{
+			// cofactors of the first row give the determinant as well
+			T c00 = a[4] * a[8] - a[5] * a[7];
+			T c01 = a[5] * a[6] - a[3] * a[8];
+			T c02 = a[3] * a[7] - a[4] * a[6];
+
+			T det = a[0] * c00 + a[1] * c01 + a[2] * c02;
+			if (FixedMatrixScalar<T>::Magnitude(det) == 0.0)
+				return false;
+
+			T d = FixedMatrixScalar<T>::One() / det;
+			inverse[0] = c00 * d;
+			inverse[1] = (a[2] * a[7] - a[1] * a[8]) * d;
+			inverse[2] = (a[1] * a[5] - a[2] * a[4]) * d;
+			inverse[3] = c01 * d;
+			inverse[4] = (a[0] * a[8] - a[2] * a[6]) * d;
+			inverse[5] = (a[2] * a[3] - a[0] * a[5]) * d;
+			inverse[6] = c02 * d;
+			inverse[7] = (a[1] * a[6] - a[0] * a[7]) * d;
+			inverse[8] = (a[0] * a[4] - a[1] * a[3]) * d;
+
+			return true;
+		}
+	};
+
+
+
+	// the 4x4 forms are expansions in the 2x2 minors of the first two rows
+	// (s) and of the last two rows (c)
+	template<class T>
+	struct FixedMatrixAlgebra<T, 4> {
+		static T Determinant(const T *a)
+		{
+			T s0 = a[0] * a[5] - a[1] * a[4];
+			T s1 = a[0] * a[6] - a[2] * a[4];
+			T s2 = a[0] * a[7] - a[3] * a[4];
+			T s3 = a[1] * a[6] - a[2] * a[5];
+			T s4 = a[1] * a[7] - a[3] * a[5];
+			T s5 = a[2] * a[7] - a[3] * a[6];
+
+			T c0 = a[8] * a[13] - a[9] * a[12];
+			T c1 = a[8] * a[14] - a[10] * a[12];
+			T c2 = a[8] * a[15] - a[11] * a[12];
+			T c3 = a[9] * a[14] - a[10] * a[13];
+			T c4 = a[9] * a[15] - a[11] * a[13];
+			T c5 = a[10] * a[15] - a[11] * a[14];
+
+			return s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0;
+		}
+
+		static bool Inverse(const T *a, T *inverse)
+		{
+			T s0 = a[0] * a[5] - a[1] * a[4];
+			T s1 = a[0] * a[6] - a[2] * a[4];
+			T s2 = a[0] * a[7] - a[3] * a[4];
+			T s3 = a[1] * a[6] - a[2] * a[5];
+			T s4 = a[1] * a[7] - a[3] * a[5];
+			T s5 = a[2] * a[7] - a[3] * a[6];
+
+			T c0 = a[8] * a[13] - a[9] * a[12];
+			T c1 = a[8] * a[14] - a[10] * a[12];
+			T c2 = a[8] * a[15] - a[11] * a[12];
+			T c3 = a[9] * a[14] - a[10] * a[13];
+			T c4 = a[9] * a[15] - a[11] * a[13];
+			T c5 = a[10] * a[15] - a[11] * a[14];
+
+			T det = s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0;
+			if (FixedMatrixScalar<T>::Magnitude(det) == 0.0)
+				return false;
+
+			T d = FixedMatrixScalar<T>::One() / det;
+
+			inverse[0] = (a[5] * c5 - a[6] * c4 + a[7] * c3) * d;
+			inverse[1] = (a[2] * c4 - a[1] * c5 - a[3] * c3) * d;
+			inverse[2] = (a[13] * s5 - a[14] * s4 + a[15] * s3) * d;
+			inverse[3] = (a[10] * s4 - a[9] * s5 - a[11] * s3) * d;
+
+			inverse[4] = (a[6] * c2 - a[4] * c5 - a[7] * c1) * d;
+			inverse[5] = (a[0] * c5 - a[2] * c2 + a[3] * c1) * d;
+			inverse[6] = (a[14] * s2 - a[12] * s5 - a[15] * s1) * d;
+			inverse[7] = (a[8] * s5 - a[10] * s2 + a[11] * s1) * d;
+
+			inverse[8] = (a[4] * c4 - a[5] * c2 + a[7] * c0) * d;
+			inverse[9] = (a[1] * c2 - a[0] * c4 - a[3] * c0) * d;
+			inverse[10] = (a[12] * s4 - a[13] * s2 + a[15] * s0) * d;
+			inverse[11] = (a[9] * s2 - a[8] * s4 - a[11] * s0) * d;
+
+			inverse[12] = (a[5] * c1 - a[4] * c3 - a[6] * c0) * d;
+			inverse[13] = (a[0] * c3 - a[1] * c1 + a[2] * c0) * d;
+			inverse[14] = (a[13] * s1 - a[12] * s3 - a[14] * s0) * d;
+			inverse[15] = (a[8] * s3 - a[9] * s1 + a[10] * s0) * d;
+
+			return true;
+		}
+	};
+
+
+
+	template<class T, long N>
+	T FixedMatrixAlgebra<T, N>::Determinant(const T *a)
+	{
+		T lu[N * N];
+		for (long k = 0; k < N * N; ++k)
+			lu[k] = a[k];
+
+		T det = FixedMatrixScalar<T>::One();
+		for (long j = 0; j < N; ++j) {
+			long p = j;
+			double big = FixedMatrixScalar<T>::Magnitude(lu[j * N + j]);
+			for (long i = j + 1; i < N; ++i) {
+				double x = FixedMatrixScalar<T>::Magnitude(lu[i * N + j]);
+				if (x > big) {
+					big = x;
+					p = i;
+				}
+			}
+
+			if (big == 0.0)
+				return T();
+
+			if (p != j) {
+				for (long c = 0; c < N; ++c) {
+					T tmp = lu[j * N + c];
+					lu[j * N + c] = lu[p * N + c];
+					lu[p * N + c] = tmp;
+				}
+				det = T() - det;
+			}
+
+			det *= lu[j * N + j];
+			T pivotInverse = FixedMatrixScalar<T>::One() / lu[j * N + j];
+			for (long i = j + 1; i < N; ++i) {
+				T l = lu[i * N + j] * pivotInverse;
+				for (long c = j + 1; c < N; ++c)
+					lu[i * N + c] = lu[i * N + c] - l * lu[j * N + c];
+			}
+		}
+
+		return det;
+	}
+
+
+
+	// Gauss-Jordan on [A | I]
+	template<class T, long N>
+	bool FixedMatrixAlgebra<T, N>::Inverse(const T *a, T *inverse)
+	{
+		T work[N * N];
+		for (long k = 0; k < N * N; ++k)
+			work[k] = a[k];
+
+		for (long i = 0; i < N; ++i) {
+			for (long j = 0; j < N; ++j)
+				inverse[i * N + j] = (i == j) ? FixedMatrixScalar<T>::One() : T();
+		}
+
+		for (long j = 0; j < N; ++j) {
+			long p = j;
+			double big = FixedMatrixScalar<T>::Magnitude(work[j * N + j]);
+			for (long i = j + 1; i < N; ++i) {
+				double x = FixedMatrixScalar<T>::Magnitude(work[i * N + j]);
+				if (x > big) {
+					big = x;
+					p = i;
+				}
+			}
+
+			if (big == 0.0)
+				return false;
+
+			if (p != j) {
+				for (long c = 0; c < N; ++c) {
+					T tmp = work[j * N + c];
+					work[j * N + c] = work[p * N + c];
+					work[p * N + c] = tmp;
+
+					tmp = inverse[j * N + c];
+					inverse[j * N + c] = inverse[p * N + c];
+					inverse[p * N + c] = tmp;
+				}
+			}
+
+			T pivotInverse = FixedMatrixScalar<T>::One() / work[j * N + j];
+			for (long c = 0; c < N; ++c) {
+				work[j * N + c] *= pivotInverse;
+				inverse[j * N + c] *= pivotInverse;
+			}
+
+			for (long i = 0; i < N; ++i) {
+				if (i == j)
+					continue;
+
+				T l = work[i * N + j];
+				for (long c = 0; c < N; ++c) {
+					work[i * N + c] = work[i * N + c] - l * work[j * N + c];
+					inverse[i * N + c] = inverse[i * N + c] - l * inverse[j * N + c];
+				}
+			}
+		}
+
+		return true;
+	}
+
+
+
+	template<class T, long R, long C>
+	inline T& FixedMatrix<T, R, C>::operator()(long i, long j)
+	{
+		return mData[i * C + j];
+	}
+
+
+
+	template<class T, long R, long C>
+	inline const T& FixedMatrix<T, R, C>::operator()(long i, long j) const
+	{
+		return mData[i * C + j];
+	}
+
+
+
+	template<class T, long R, long C>
+	inline FixedMatrix<T, R, C> FixedMatrix<T, R, C>::operator+(const FixedMatrix<T, R, C> &m) const
+	{
+		FixedMatrix<T, R, C> result;
+		for (long k = 0; k < R * C; ++k)
+			result.mData[k] = mData[k] + m.mData[k];
+
+		return result;
+	}
+
+
+
+	template<class T, long R, long C>
+	inline FixedMatrix<T, R, C> FixedMatrix<T, R, C>::operator-(const FixedMatrix<T, R, C> &m) const
+	{
+		FixedMatrix<T, R, C> result;
+		for (long k = 0; k < R * C; ++k)
+			result.mData[k] = mData[k] - m.mData[k];
+
+		return result;
+	}
+
+
+
+	template<class T, long R, long C>
+	inline FixedMatrix<T, R, C>& FixedMatrix<T, R, C>::operator+=(const FixedMatrix<T, R, C> &m)
+	{
+		for (long k = 0; k < R * C; ++k)
+			mData[k] += m.mData[k];
+
+		return *this;
+	}
+
+
+
+	template<class T, long R, long C>
+	inline FixedMatrix<T, R, C>& FixedMatrix<T, R, C>::operator-=(const FixedMatrix<T, R, C> &m)
+	{
+		for (long k = 0; k < R * C; ++k)
+			mData[k] = mData[k] - m.mData[k];
+
+		return *this;
+	}
+
+
+
+	template<class T, long R, long C>
+	inline FixedMatrix<T, R, C>& FixedMatrix<T, R, C>::operator*=(const T &a)
+	{
+		for (long k = 0; k < R * C; ++k)
+			mData[k] *= a;
+
+		return *this;
+	}
+
+
+
+	template<class T, long R, long C>
+	template<long K>
+	inline FixedMatrix<T, R, K> FixedMatrix<T, R, C>::operator*(const FixedMatrix<T, C, K> &m) const
+	{
+		FixedMatrix<T, R, K> result;
+		for (long i = 0; i < R; ++i) {
+			for (long j = 0; j < K; ++j) {
+				T sum = T();
+				for (long p = 0; p < C; ++p)
+					sum += mData[i * C + p] * m(p, j);
+				result(i, j) = sum;
+			}
+		}
+
+		return result;
+	}
+
+
+
+	template<class T, long R, long C>
+	inline FixedMatrix<T, C, R> FixedMatrix<T, R, C>::Transpose() const
+	{
+		FixedMatrix<T, C, R> result;
+		for (long i = 0; i < R; ++i) {
+			for (long j = 0; j < C; ++j)
+				result(j, i) = mData[i * C + j];
+		}
+
+		return result;
+	}
+
+
+
+	template<class T, long R, long C>
+	inline T FixedMatrix<T, R, C>::Determinant() const
+	{
+		static_assert(R == C, "FixedMatrix::Determinant : matrix is not square");
+		return FixedMatrixAlgebra<T, R>::Determinant(mData);
+	}
+
+
+
+	template<class T, long R, long C>
+	inline FixedMatrix<T, R, C> FixedMatrix<T, R, C>::Inverse() const
+	{
+		static_assert(R == C, "FixedMatrix::Inverse : matrix is not square");
+
+		FixedMatrix<T, R, C> result;
+		if (!FixedMatrixAlgebra<T, R>::Inverse(mData, result.mData))
+			ThrowException("FixedMatrix::Inverse : matrix is singular");
+
+		return result;
+	}
+
+
+
+	template<class T, long R, long C>
+	inline T FixedMatrix<T, R, C>::Trace() const
+	{
+		static_assert(R == C, "FixedMatrix::Trace : matrix is not square");
+
+		T trace = T();
+		for (long i = 0; i < R; ++i)
+			trace += mData[i * C + i];
+
+		return trace;
+	}
+
+
+
+	template<class T, long R, long C>
+	inline void FixedMatrix<T, R, C>::MakeZero()
+	{
+		for (long k = 0; k < R * C; ++k)
+			mData[k] = T();
+
+		return;
+	}
+
+
+
+	template<class T, long R, long C>
+	inline void FixedMatrix<T, R, C>::MakeIdentity()
+	{
+		for (long i = 0; i < R; ++i) {
+			for (long j = 0; j < C; ++j)
+				mData[i * C + j] = (i == j) ? FixedMatrixScalar<T>::One() : T();
+		}
+
+		return;
+	}
+
+
+
+	template<class T, long R, long C>
+	template<class M>
+	inline void FixedMatrix<T, R, C>::CopyFrom(const M &m, long i0, long j0)
+	{
+		if ((i0 < 0) || (j0 < 0) || (i0 + R > m.NumRows()) || (j0 + C > m.NumColumns()))
+			ThrowException("FixedMatrix::CopyFrom : block is out of range");
+
+		const T *data = m.Data() + i0 * m.Stride() + j0;
+		for (long i = 0; i < R; ++i) {
+			for (long j = 0; j < C; ++j)
+				mData[i * C + j] = data[i * m.Stride() + j];
+		}
+
+		return;
+	}
+
+
+
+	template<class T, long R, long C>
+	template<class M>
+	inline void FixedMatrix<T, R, C>::CopyTo(M &m, long i0, long j0) const
+	{
+		if ((i0 < 0) || (j0 < 0) || (i0 + R > m.NumRows()) || (j0 + C > m.NumColumns()))
+			ThrowException("FixedMatrix::CopyTo : block is out of range");
+
+		T *data = m.Data() + i0 * m.Stride() + j0;
+		for (long i = 0; i < R; ++i) {
+			for (long j = 0; j < C; ++j)
+				data[i * m.Stride() + j] = mData[i * C + j];
+		}
+
+		return;
+	}
+
+
+
+	template<class T, long R, long C>
+	inline long FixedMatrix<T, R, C>::NumRows() const
+	{
+		return R;
+	}
+
+
+
+	template<class T, long R, long C>
+	inline long FixedMatrix<T, R, C>::NumColumns() const
+	{
+		return C;
+	}
+
+
+
+	template<class T, long R, long C>
+	inline T* FixedMatrix<T, R, C>::Data()
+	{
+		return mData;
+	}
+
+
+
+	template<class T, long R, long C>
+	inline const T* FixedMatrix<T, R, C>::Data() const
+	{
+		return mData;
+	}
+}
+
+#endif // _fixedmatrix_h_
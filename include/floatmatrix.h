@@ -0,0 +1,338 @@
+/*
+ * Copyright (C) 2004-2018 David Bernstein <david.h.bernstein@gmail.com>
+ *
+ * This file is part of utility_cpp.
+ *
+ * utility_cpp is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * utility_cpp is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with utility_cpp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _floatmatrix_h_
+#define _floatmatrix_h_
+
+#include "utility.h"
+#include "matrix.h"
+#include "matrixexpression.h"
+
+// Matrix<float> has the same interface as Matrix<double> in realmatrix.h.
+// It takes half the memory and its kernels process twice as many elements
+// per instruction, at the cost of about 7 significant digits instead of 16.
+
+namespace utility {
+	template<>
+	class Matrix<float> : public MatrixExpression<Matrix<float>, float> {
+    public:
+		// Constructor
+		Matrix(long numRows = 0, long numColumns = 0);
+        
+        // evaluates a lazy expression such as A + B - 2.0 * C
+        template<class E>
+        Matrix(const MatrixExpression<E, float> &e);
+        
+		// Destructor
+		virtual ~Matrix(void);
+        void Erase(void);
+        
+		// copy constructor
+		Matrix(const Matrix<float> &m);
+        
+		// operators
+		Matrix<float>& operator=(const Matrix<float> &m);
+		float& operator()(long i, long j);
+		const float& operator()(long i, long j) const;
+        Matrix<float> operator*(const Matrix<float> &m) const;
+		Matrix<float>& operator*=(float a);
+        Matrix<float>& operator+=(const Matrix<float> &m);
+        
+        // + and - (and scalar *) are defined in matrixexpression.h and are
+        // evaluated on assignment
+        template<class E>
+        Matrix<float>& operator=(const MatrixExpression<E, float> &e);
+        template<class E>
+        Matrix<float>& operator+=(const MatrixExpression<E, float> &e);
+        
+        // element access without range checking, used by the expressions
+        const float& Element(long i, long j) const;
+		
+		// Sets and Gets
+		void SetSize(long numRows, long numColumns);
+		long NumRows(void) const;
+		long NumColumns(void) const;
+		
+		// raw access to the contiguous row-major storage, element (i, j)
+		// lives at Data()[i * Stride() + j]
+		float* Data(void);
+		const float* Data(void) const;
+		long Stride(void) const;
+		
+		// various matrix operations
+        double Determinant(void) const;
+        void MakeRandom(long seed = 1);
+		void MakeZero(void);
+        void Print(void) const;
+        void Inverse(Matrix<float> &inv) const;
+        Matrix<float> Transpose(void) const;
+        void TransposeInPlace(void);
+        
+    protected:
+		void ThrowOutOfRangeException(void) const; 
+        
+    protected:
+        // size
+        long mRows;
+		long mColumns;
+        
+        // distance in elements between the starts of consecutive rows
+        long mStride;
+        
+		// data pointer, a single row-major block of mRows * mStride elements
+		float *mpData;
+	};
+    
+    
+    
+    inline float& Matrix<float>::operator()(long i, long j)
+	{
+        if ((i >= mRows) || (i < 0) || (j >= mColumns) || (j < 0))
+            ThrowOutOfRangeException();
+			
+        return mpData[i * mStride + j];
+	}
+	
+    
+    
+    inline const float& Matrix<float>::operator()(long i, long j) const
+	{
+		if ((i >= mRows) || (i < 0) || (j >= mColumns) || (j < 0))
+			ThrowOutOfRangeException();
+        
+		return mpData[i * mStride + j];
+	}
+	
+    
+    
+    inline Matrix<float>::Matrix(long numRows, long numColumns)
+	{
+        mpData = NULL;
+        mRows = 0;
+        mColumns = 0;
+        mStride = 0;
+            
+        SetSize(numRows, numColumns);
+            
+        return;
+	}
+	
+    
+    
+    inline Matrix<float>::~Matrix()
+	{
+        Erase();
+        return;
+	}
+    
+    
+    
+    inline void Matrix<float>::Erase()
+	{
+        if (mpData != NULL) {
+            delete [] mpData;
+                
+            mpData = NULL;
+            mRows = 0;
+            mColumns = 0;
+            mStride = 0;
+        }
+        else {
+            if ((mRows > 0) || (mColumns > 0))
+                ThrowException("Array::Erase : inconsistent data");
+        }
+            
+            
+        return;
+	}
+    
+    
+    
+	// copy constructor
+    inline Matrix<float>::Matrix(const Matrix<float> &m)
+	{
+        mpData = NULL;
+        mRows = 0;
+        mColumns = 0;
+        mStride = 0;
+        
+        *this = m;
+        return;
+	}
+    
+    
+    
+    inline Matrix<float>& Matrix<float>::operator=(const Matrix<float> &m)
+	{
+        // check for assignment to self
+        if (this == &m)
+            return *this;
+            
+        SetSize(m.mRows, m.mColumns);
+            
+        for (long i = 0; i < mRows; ++i) {
+            float *row = mpData + i * mStride;
+            const float *mRow = m.mpData + i * m.mStride;
+            for (long j = 0; j < mColumns; ++j) 
+                row[j] = mRow[j];
+        }
+            
+        return *this;
+	}
+	
+	
+    
+    inline void Matrix<float>::SetSize(long numRows, long numColumns)
+	{
+        if ((mRows == numRows) && (mColumns == numColumns))
+            return;
+            
+        Erase();
+            
+        if ((numRows < 0) || (numColumns < 0))
+            ThrowException("Matrix : negative size");
+			
+        // if either numRows or numColumns is zero then the Matrix is left empty
+        if ((numRows == 0) || (numColumns == 0))
+            return;
+            
+        mRows = numRows;
+        mColumns = numColumns;
+        mStride = numColumns;
+            
+        // one allocation for the whole matrix, rows are stored back to back
+        mpData = new float[mRows * mStride];
+            
+        return;
+	}
+    
+    
+    
+    inline long Matrix<float>::NumRows() const
+	{
+		return mRows;
+	}
+	
+	
+	
+    inline long Matrix<float>::NumColumns() const
+	{
+		return mColumns;
+	}
+	
+    
+    
+    inline float* Matrix<float>::Data()
+	{
+		return mpData;
+	}
+	
+	
+	
+    inline const float* Matrix<float>::Data() const
+	{
+		return mpData;
+	}
+	
+	
+	
+    inline long Matrix<float>::Stride() const
+	{
+		return mStride;
+	}
+	
+    
+    
+    inline const float& Matrix<float>::Element(long i, long j) const
+    {
+        return mpData[i * mStride + j];
+    }
+    
+    
+    
+    template<class E>
+    inline Matrix<float>::Matrix(const MatrixExpression<E, float> &e)
+    {
+        mpData = NULL;
+        mRows = 0;
+        mColumns = 0;
+        mStride = 0;
+        
+        *this = e;
+        return;
+    }
+    
+    
+    
+    template<class E>
+    inline Matrix<float>& Matrix<float>::operator=(const MatrixExpression<E, float> &e)
+    {
+        // every expression is elementwise so it is safe for this matrix to
+        // appear in e, in which case the size can't change
+        const E &expression = e.Expression();
+        SetSize(expression.NumRows(), expression.NumColumns());
+        
+        for (long i = 0; i < mRows; ++i) {
+            float *row = mpData + i * mStride;
+            for (long j = 0; j < mColumns; ++j) 
+                row[j] = expression.Element(i, j);
+        }
+        
+        return *this;
+    }
+    
+    
+    
+    template<class E>
+    inline Matrix<float>& Matrix<float>::operator+=(const MatrixExpression<E, float> &e)
+    {
+        const E &expression = e.Expression();
+        if ((expression.NumRows() != mRows) || (expression.NumColumns() != mColumns))
+            ThrowException("Matrix<float>::operator+= : matrices are different sizes");
+        
+        for (long i = 0; i < mRows; ++i) {
+            float *row = mpData + i * mStride;
+            for (long j = 0; j < mColumns; ++j) 
+                row[j] += expression.Element(i, j);
+        }
+        
+        return *this;
+    }
+    
+    
+    
+    // a scalar on the right, without this Matrix(long) would make m * 2.0
+    // ambiguous with the matrix product
+    inline ScaledMatrix<Matrix<float>, double, float> operator*(const Matrix<float> &m, double a)
+    {
+        return ScaledMatrix<Matrix<float>, double, float>(a, m);
+    }
+    
+    
+    
+    inline void Matrix<float>::ThrowOutOfRangeException() const
+	{
+		ThrowException("Matrix index out of range");
+		return;
+	}
+}
+
+#endif // _floatmatrix_h_	
+
+
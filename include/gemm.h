@@ -0,0 +1,90 @@
+/*
+ * Copyright (C) 2004-2018 David Bernstein <david.h.bernstein@gmail.com>
+ *
+ * This file is part of utility_cpp.
+ *
+ * utility_cpp is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * utility_cpp is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with utility_cpp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _gemm_h_
+#define _gemm_h_
+
+#include "utility.h"
+#include "complexnumber.h"
+#include "realmatrix.h"
+#include "complexmatrix.h"
+
+namespace utility {
+	// general matrix multiply on raw row-major storage
+	// computes C = alpha * A * B + beta * C where A is m x k, B is k x n and
+	// C is m x n; lda, ldb and ldc are the row strides of the three matrices
+	// when beta is zero C is not read, so it may hold uninitialized data
+	void Gemm(long m, long n, long k, double alpha, const double *a, long lda,
+			  const double *b, long ldb, double beta, double *c, long ldc);
+	
+	// the same in single precision, which runs about twice as fast
+	void Gemm(long m, long n, long k, float alpha, const float *a, long lda,
+			  const float *b, long ldb, float beta, float *c, long ldc);
+	
+	// the same for complex matrices
+	void Gemm(long m, long n, long k, const ComplexNumber &alpha, const ComplexNumber *a, long lda,
+			  const ComplexNumber *b, long ldb, const ComplexNumber &beta, ComplexNumber *c, long ldc);
+	
+	// C = alpha * op(A) * op(B) + beta * C where op is applied inside the
+	// kernel, op(A) is m x k and op(B) is k x n, so a stored A is k x m when
+	// opA is TRANSPOSE or CONJUGATE_TRANSPOSE (the two are the same for
+	// real matrices), and likewise for B
+	void Gemm(MatrixOperation opA, MatrixOperation opB, long m, long n, long k, double alpha,
+			  const double *a, long lda, const double *b, long ldb, double beta, double *c, long ldc);
+	
+	void Gemm(MatrixOperation opA, MatrixOperation opB, long m, long n, long k, float alpha,
+			  const float *a, long lda, const float *b, long ldb, float beta, float *c, long ldc);
+	
+	void Gemm(MatrixOperation opA, MatrixOperation opB, long m, long n, long k, const ComplexNumber &alpha,
+			  const ComplexNumber *a, long lda, const ComplexNumber *b, long ldb, const ComplexNumber &beta,
+			  ComplexNumber *c, long ldc);
+	
+	// the 3M (Gauss) form of the complex multiply, three real GEMMs on split
+	// copies of the operands in place of the four real multiply-adds of
+	// each complex one, at the cost of 3 (mk + kn + mn) doubles of pooled
+	// workspace
+	// the real part of the product is as accurate as before but the
+	// imaginary part is not componentwise accurate, its error is bounded by
+	// |Ar + Ai| |Br + Bi| rather than |A| |B| (Higham, Accuracy and
+	// Stability of Numerical Algorithms, section 23.2.4), so it can lose
+	// the small imaginary parts of nearly real products while staying
+	// accurate in norm
+	void Gemm3M(MatrixOperation opA, MatrixOperation opB, long m, long n, long k, const ComplexNumber &alpha,
+				const ComplexNumber *a, long lda, const ComplexNumber *b, long ldb, const ComplexNumber &beta,
+				ComplexNumber *c, long ldc);
+	
+	// which of the two the complex Gemm (and so ComplexMatrix::operator*)
+	// uses for all but small products, COMPLEX_MULTIPLY_4M by default
+	void SetComplexMultiplyMethod(ComplexMultiplyMethod method);
+	ComplexMultiplyMethod CurrentComplexMultiplyMethod(void);
+	
+	// the same on matrices, C += A^H B say with no temporaries, C is sized
+	// to fit when beta is zero and must already have the right size
+	// otherwise, and may not be A or B
+	void Gemm(MatrixOperation opA, MatrixOperation opB, double alpha, const Matrix<double> &a,
+			  const Matrix<double> &b, double beta, Matrix<double> &c);
+	
+	void Gemm(MatrixOperation opA, MatrixOperation opB, const ComplexNumber &alpha, const ComplexMatrix &a,
+			  const ComplexMatrix &b, const ComplexNumber &beta, ComplexMatrix &c);
+	
+	// all the multiplies split large products across NumThreads() threads,
+	// see parallel.h
+}
+
+#endif // _gemm_h_
@@ -0,0 +1,61 @@
+/*
+ * Copyright (C) 2004-2018 David Bernstein <david.h.bernstein@gmail.com>
+ *
+ * This file is part of utility_cpp.
+ *
+ * utility_cpp is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * utility_cpp is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with utility_cpp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _gemv_h_
+#define _gemv_h_
+
+#include "utility.h"
+#include "complexnumber.h"
+#include "realmatrix.h"
+#include "floatmatrix.h"
+#include "complexmatrix.h"
+#include "densevector.h"
+
+namespace utility {
+	// general matrix-vector multiply on raw row-major storage
+	// computes y = alpha * op(A) * x + beta * y where A is m x n with row
+	// stride lda and op(A) is A, A^T or A^H (the same as A^T for real A),
+	// so x has n elements and y m for NO_TRANSPOSE, the other way round
+	// otherwise
+	// when beta is zero y is not read, x and y may not overlap
+	void Gemv(MatrixOperation op, long m, long n, double alpha, const double *a, long lda,
+			  const double *x, double beta, double *y);
+
+	void Gemv(MatrixOperation op, long m, long n, float alpha, const float *a, long lda,
+			  const float *x, float beta, float *y);
+
+	void Gemv(MatrixOperation op, long m, long n, const ComplexNumber &alpha, const ComplexNumber *a, long lda,
+			  const ComplexNumber *x, const ComplexNumber &beta, ComplexNumber *y);
+
+	// the same on matrices and vectors, y is sized to match when beta is
+	// zero and must already have the right size otherwise, y may not be x
+	void Gemv(MatrixOperation op, double alpha, const Matrix<double> &a, const DenseVector<double> &x,
+			  double beta, DenseVector<double> &y);
+
+	void Gemv(MatrixOperation op, float alpha, const Matrix<float> &a, const DenseVector<float> &x,
+			  float beta, DenseVector<float> &y);
+
+	void Gemv(MatrixOperation op, const ComplexNumber &alpha, const ComplexMatrix &a,
+			  const DenseVector<ComplexNumber> &x, const ComplexNumber &beta, DenseVector<ComplexNumber> &y);
+
+	// all of them split large products across NumThreads() threads, by rows
+	// of A for NO_TRANSPOSE and by blocks of y otherwise, see parallel.h
+}
+
+#endif // _gemv_h_
@@ -0,0 +1,101 @@
+/*
+ * Copyright (C) 2004-2018 David Bernstein <david.h.bernstein@gmail.com>
+ *
+ * This file is part of utility_cpp.
+ *
+ * utility_cpp is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * utility_cpp is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with utility_cpp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _kroneckeroperator_h_
+#define _kroneckeroperator_h_
+
+#include "utility.h"
+#include "complexnumber.h"
+#include "complexmatrix.h"
+#include "densevector.h"
+
+#include <vector>
+
+namespace utility {
+	// the Kronecker product A1 x A2 x ... x An of complex matrices, kept as
+	// its factors and applied without ever forming the product, whose size
+	// is the product of theirs
+	// the factors are in the order of ComplexMatrix::TensorProduct, so
+	// A.TensorProduct(B) is the operator with factors A then B, and the
+	// first factor's index varies slowest
+	// Apply contracts one factor at a time over the index that factor acts
+	// on, with complex GEMMs (see gemm.h) or a direct loop when the blocks
+	// are small, so applying n x n factors to a vector of size N costs
+	// about N times the sum of the n's instead of N^2, and the only storage
+	// is two pooled intermediates the size of the vectors passed between
+	// factors
+	class KroneckerOperator {
+	public:
+		// Constructor
+		KroneckerOperator(void);
+
+		// Destructor
+		~KroneckerOperator(void) { };
+
+		// appends a factor on the right, the factor is copied
+		void AddFactor(const ComplexMatrix &m);
+		void Clear(void);
+
+		// Sets and Gets
+		long NumFactors(void) const;
+		const ComplexMatrix& Factor(long i) const;
+
+		// the dimensions of the full product
+		long NumRows(void) const;
+		long NumColumns(void) const;
+
+		// y = K x, y is sized to NumRows()
+		void Apply(const DenseVector<ComplexNumber> &x, DenseVector<ComplexNumber> &y) const;
+
+		// Y = K X, X has NumColumns() rows and any number of columns and Y is
+		// sized to NumRows() by that
+		void Apply(const ComplexMatrix &x, ComplexMatrix &y) const;
+
+	private:
+		void Apply(long numVectors, const ComplexNumber *x, ComplexNumber *y) const;
+
+	private:
+		std::vector<ComplexMatrix> mFactors;
+		long mRows;
+		long mColumns;
+	};
+
+
+
+	inline long KroneckerOperator::NumFactors() const
+	{
+		return static_cast<long>(mFactors.size());
+	}
+
+
+
+	inline long KroneckerOperator::NumRows() const
+	{
+		return mRows;
+	}
+
+
+
+	inline long KroneckerOperator::NumColumns() const
+	{
+		return mColumns;
+	}
+}
+
+#endif // _kroneckeroperator_h_
@@ -0,0 +1,231 @@
+/*
+ * Copyright (C) 2004-2018 David Bernstein <david.h.bernstein@gmail.com>
+ *
+ * This file is part of utility_cpp.
+ *
+ * utility_cpp is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * utility_cpp is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with utility_cpp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _lufactorization_h_
+#define _lufactorization_h_
+
+#include "utility.h"
+#include "realmatrix.h"
+#include "floatmatrix.h"
+#include "complexmatrix.h"
+
+namespace utility {
+	// LU factorization with partial pivoting, P A = L U
+	// factor a matrix once and then reuse the factorization for any number
+	// of solves, the determinant or the inverse
+	class LUFactorization {
+	public:
+		// Constructors
+		LUFactorization(void);
+		LUFactorization(const Matrix<double> &a);
+		
+		// Destructor
+		~LUFactorization(void) { };
+		
+		// factorization
+		void Factor(const Matrix<double> &a);
+		bool Factored(void) const;
+		bool Singular(void) const;
+		long Size(void) const;
+		
+		// solves A x = b for every column of b, b is overwritten with x
+		void Solve(Matrix<double> &b) const;
+		void Solve(const Matrix<double> &b, Matrix<double> &x) const;
+		
+		// solves A x = b for a single vector of Size() elements, in place
+		void Solve(double *b) const;
+		
+		double Determinant(void) const;
+		void Inverse(Matrix<double> &inv) const;
+		
+	private:
+		void CheckSolvable(void) const;
+		
+	private:
+		// L (unit diagonal, not stored) below the diagonal, U on and above
+		Matrix<double> mLU;
+		
+		// row i was interchanged with row mPivot[i] at step i
+		Array<long> mPivot;
+		
+		// +1 or -1 for an even or odd number of interchanges
+		double mPivotSign;
+		
+		// true if a zero pivot was found
+		bool mSingular;
+	};
+	
+	
+	
+	inline bool LUFactorization::Factored() const
+	{
+		return mLU.NumRows() > 0;
+	}
+	
+	
+	
+	inline bool LUFactorization::Singular() const
+	{
+		return mSingular;
+	}
+	
+	
+	
+	inline long LUFactorization::Size() const
+	{
+		return mLU.NumRows();
+	}
+	
+	
+	
+	// LU on raw row-major storage, for code that manages its own memory
+	// factors the m x n panel a (m >= n) in place with partial pivoting, row
+	// j was interchanged with row pivot[j], returns false if a zero pivot was
+	// found
+	bool FactorLU(long m, long n, double *a, long lda, long *pivot, double &sign);
+	
+	// x = L^-1 x with L the unit lower triangle of the n x n block at l, and
+	// x = U^-1 x with U the upper triangle of the block at u, for the m
+	// columns of the n x m block x
+	void SolveUnitLower(long n, const double *l, long ldl, long m, double *x, long ldx);
+	void SolveUpper(long n, const double *u, long ldu, long m, double *x, long ldx);
+	
+	// b = A^-1 b for the m columns of the n x m block b, given the factors
+	// and pivots from FactorLU
+	void SolveLU(long n, const double *lu, long ldlu, const long *pivot, long m, double *b, long ldb);
+	
+	
+	
+	// single precision LU for Matrix<float>, a is overwritten with its
+	// factors in the same layout as LUFactorization uses, sign is the sign
+	// of the row permutation, returns false if a is singular
+	bool FactorLU(Matrix<float> &a, Array<long> &pivot, double &sign);
+	
+	// b = A^-1 b given the factors from FactorLU
+	void SolveLU(const Matrix<float> &lu, const Array<long> &pivot, Matrix<float> &b);
+	
+	// the same for Matrix<double>, for code that keeps its own work matrices,
+	// and for ComplexMatrix
+	bool FactorLU(Matrix<double> &a, Array<long> &pivot, double &sign);
+	void SolveLU(const Matrix<double> &lu, const Array<long> &pivot, Matrix<double> &b);
+	bool FactorLU(ComplexMatrix &a, Array<long> &pivot, double &sign);
+	void SolveLU(const ComplexMatrix &lu, const Array<long> &pivot, ComplexMatrix &b);
+	
+	
+	
+	// LU in single precision with the solution refined in double precision
+	// each refinement step computes the residual r = b - A x in double, solves
+	// A d = r with the single precision factors and adds d to x, so for a
+	// reasonably conditioned A the result is as accurate as a double LU
+	// while the factorization, the expensive part, runs at float speed
+	// if refinement doesn't converge (or A doesn't fit in a float) A is
+	// factored in double and the solve is done again with that
+	class MixedPrecisionLU {
+	public:
+		// Constructors
+		MixedPrecisionLU(void);
+		MixedPrecisionLU(const Matrix<double> &a);
+		
+		// Destructor
+		~MixedPrecisionLU(void) { };
+		
+		// factorization
+		void Factor(const Matrix<double> &a);
+		bool Factored(void) const;
+		long Size(void) const;
+		
+		// solves A x = b for every column of b, b is overwritten with x
+		// these aren't const because a failed refinement factors A in double
+		// and keeps that factorization for later solves
+		void Solve(Matrix<double> &b);
+		void Solve(const Matrix<double> &b, Matrix<double> &x);
+		
+		// refinement steps taken by the last solve, and whether it (or an
+		// earlier one) had to fall back to the double factorization
+		long NumRefinementSteps(void) const;
+		bool UsedDoubleFactorization(void) const;
+		
+		// default MIXED_PRECISION_MAX_STEPS
+		void SetMaxRefinementSteps(long n);
+		
+	private:
+		bool RefineSolution(const Matrix<double> &b, Matrix<double> &x);
+		void SolveSingle(const Matrix<double> &b, Matrix<double> &x, Matrix<float> &work) const;
+		
+	private:
+		// A itself is needed for the residuals
+		Matrix<double> mA;
+		
+		// single precision factors, as in LUFactorization
+		Matrix<float> mLU;
+		Array<long> mPivot;
+		bool mSingleFailed;
+		
+		// infinity norm of A, for the convergence test
+		double mNorm;
+		
+		// factored only if refinement fails
+		LUFactorization mDoubleLU;
+		
+		long mNumRefinementSteps;
+		long mMaxRefinementSteps;
+	};
+	
+	
+	
+	const long MIXED_PRECISION_MAX_STEPS = 30;
+	
+	
+	
+	inline bool MixedPrecisionLU::Factored() const
+	{
+		return mA.NumRows() > 0;
+	}
+	
+	
+	
+	inline long MixedPrecisionLU::Size() const
+	{
+		return mA.NumRows();
+	}
+	
+	
+	
+	inline long MixedPrecisionLU::NumRefinementSteps() const
+	{
+		return mNumRefinementSteps;
+	}
+	
+	
+	
+	inline bool MixedPrecisionLU::UsedDoubleFactorization() const
+	{
+		return mDoubleLU.Factored();
+	}
+	
+	
+	
+	inline void MixedPrecisionLU::SetMaxRefinementSteps(long n)
+	{
+		mMaxRefinementSteps = n;
+		return;
+	}
+}
+
+#endif // _lufactorization_h_
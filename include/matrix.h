@@ -47,6 +47,12 @@ namespace utility {
 		void SetSize(long numRows, long numColumns);
 		long NumRows(void) const;
 		long NumColumns(void) const;
+		
+		// raw access to the contiguous row-major storage, element (i, j)
+		// lives at Data()[i * Stride() + j]
+		T* Data(void);
+		const T* Data(void) const;
+		long Stride(void) const;
         
     protected:
 		void ThrowOutOfRangeException(void) const; 
@@ -55,9 +61,12 @@ namespace utility {
 		// size
 		long mRows;
 		long mColumns;
+		
+		// distance in elements between the starts of consecutive rows
+		long mStride;
 
-		// data pointer
-		T **mpData;
+		// data pointer, a single row-major block of mRows * mStride elements
+		T *mpData;
 	};
     
 
@@ -68,7 +77,7 @@ namespace utility {
 		if ((i >= mRows) || (i < 0) || (j >= mColumns) || (j < 0))
 			ThrowOutOfRangeException();
 			
-		return mpData[i][j];
+		return mpData[i * mStride + j];
 	}
 	
 
@@ -79,7 +88,7 @@ namespace utility {
 		if ((i >= mRows) || (i < 0) || (j >= mColumns) || (j < 0))
 			ThrowOutOfRangeException();
 			
-		return mpData[i][j];
+		return mpData[i * mStride + j];
 	}
 	
 
@@ -90,6 +99,7 @@ namespace utility {
 		mpData = NULL;
 		mRows = 0;
 		mColumns = 0;
+		mStride = 0;
 		
 		SetSize(numRows, numColumns);
 	
@@ -111,14 +121,12 @@ namespace utility {
 	inline void Matrix<T>::Erase()
 	{
 		if (mpData != NULL) {
-			for (long i = 0; i < mRows; ++i)
-				delete [] mpData[i];
-				
 			delete [] mpData;
 			
 			mpData = NULL;
 			mRows = 0;
 			mColumns = 0;
+			mStride = 0;
 		}
 		else {
 			if ((mRows > 0) || (mColumns > 0))
@@ -135,6 +143,11 @@ namespace utility {
 	template<class T>
 	inline Matrix<T>::Matrix(const Matrix<T> &m)
 	{
+		mpData = NULL;
+		mRows = 0;
+		mColumns = 0;
+		mStride = 0;
+		
 		*this = m;
 		return;
 	}
@@ -151,9 +164,10 @@ namespace utility {
 		SetSize(m.mRows, m.mColumns);
 		
 		for (long i = 0; i < mRows; ++i) {
-			for (long j = 0; j < mColumns; ++j) {
-				mpData[i][j] = m.mpData[i][j];
-			}
+			T *row = mpData + i * mStride;
+			const T *mRow = m.mpData + i * m.mStride;
+			for (long j = 0; j < mColumns; ++j) 
+				row[j] = mRow[j];
 		}
 
 		return *this;
@@ -168,9 +182,10 @@ namespace utility {
 			ThrowException("");
 		
 		for (long i = 0; i < mRows; ++i) {
-            for (long j = 0; j < mColumns; ++j) {
-                mpData[i][j] += m.mpData[i][j];
-            }
+            T *row = mpData + i * mStride;
+            const T *mRow = m.mpData + i * m.mStride;
+            for (long j = 0; j < mColumns; ++j) 
+                row[j] += mRow[j];
         }
         
 		return *this;
@@ -195,10 +210,10 @@ namespace utility {
 
 		mRows = numRows;
 		mColumns = numColumns;
+		mStride = numColumns;
 		
-		mpData = new T*[mRows];
-		for (long i = 0; i < mRows; ++i)
-			mpData[i] = new T[mColumns];
+		// one allocation for the whole matrix, rows are stored back to back
+		mpData = new T[mRows * mStride];
 
 		return;
 	}
@@ -221,6 +236,30 @@ namespace utility {
 	
 
 
+	template<class T>
+	inline T* Matrix<T>::Data()
+	{
+		return mpData;
+	}
+	
+	
+	
+	template<class T>
+	inline const T* Matrix<T>::Data() const
+	{
+		return mpData;
+	}
+	
+	
+	
+	template<class T>
+	inline long Matrix<T>::Stride() const
+	{
+		return mStride;
+	}
+	
+
+
 	template<class T>
 	inline void Matrix<T>::ThrowOutOfRangeException() const
 	{
@@ -0,0 +1,86 @@
+/*
+ * Copyright (C) 2004-2018 David Bernstein <david.h.bernstein@gmail.com>
+ *
+ * This file is part of utility_cpp.
+ *
+ * utility_cpp is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * utility_cpp is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with utility_cpp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _matrixexponential_h_
+#define _matrixexponential_h_
+
+#include "utility.h"
+#include "realmatrix.h"
+#include "complexmatrix.h"
+
+namespace utility {
+	// exp(A) by scaling and squaring with a diagonal Pade approximant
+	// (Higham, SIAM J. Matrix Anal. Appl. 26, 2005): the degree 3, 5, 7, 9 or
+	// 13 is the cheapest one whose backward error bound holds for the 1-norm
+	// of A, and above the degree 13 threshold A is scaled by 2^-s first and
+	// the result squared s times
+	// M is Matrix<double> or ComplexMatrix, the powers of A and the other work
+	// matrices are kept between calls, so exponentials of many matrices of
+	// one size (time steps, say) allocate nothing after the first
+	template<class M>
+	class MatrixExponential {
+	public:
+		// Constructors
+		MatrixExponential(void) : mDegree(0), mNumSquarings(0) { };
+
+		// Destructor
+		~MatrixExponential(void) { };
+
+		// result = exp(a), result may not be a
+		void Compute(const M &a, M &result);
+
+		// of the last Compute
+		long PadeDegree(void) const;
+		long NumSquarings(void) const;
+
+	private:
+		void Pade(long degree, M &result);
+
+	private:
+		M mA;
+		M mA2;
+		M mA4;
+		M mA6;
+		M mU;
+		M mV;
+		M mWork;
+		Array<long> mPivot;
+
+		long mDegree;
+		long mNumSquarings;
+	};
+
+
+
+	template<class M>
+	inline long MatrixExponential<M>::PadeDegree() const
+	{
+		return mDegree;
+	}
+
+
+
+	template<class M>
+	inline long MatrixExponential<M>::NumSquarings() const
+	{
+		return mNumSquarings;
+	}
+}
+
+#endif // _matrixexponential_h_
@@ -0,0 +1,530 @@
+/*
+ * Copyright (C) 2004-2018 David Bernstein <david.h.bernstein@gmail.com>
+ *
+ * This file is part of utility_cpp.
+ *
+ * utility_cpp is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * utility_cpp is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with utility_cpp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _matrixexpression_h_
+#define _matrixexpression_h_
+
+#include "utility.h"
+#include "complexnumber.h"
+
+#include <math.h>
+
+// Lazy elementwise matrix arithmetic. Sums, differences, scalar multiples
+// and conjugates of Matrix<double>, Matrix<float> and ComplexMatrix don't
+// compute anything when they are formed, they build a small expression
+// object instead. The whole expression is evaluated in a single loop when it
+// is assigned to a matrix, so D = A + B - 2.0 * C.Conjugate() makes one pass
+// over memory and allocates nothing beyond D itself.
+//
+// Expressions hold references to the matrices they are built from and are
+// meant to be consumed in the statement that creates them. Anything that
+// isn't elementwise, a matrix product or the member functions of the matrix
+// classes, works on Eval(), which evaluates the expression into a matrix;
+// the products below do that for you, and Norm() and Trace() are computed
+// straight from the expression.
+
+namespace utility {
+	template<class T> class Matrix;
+	template<> class Matrix<double>;
+	template<> class Matrix<float>;
+	class ComplexMatrix;
+	template<class E, class T> class ConjugateMatrix;
+
+
+
+	// the matrix an expression of element type T evaluates to
+	template<class T>
+	struct MatrixExpressionResult;
+
+	template<>
+	struct MatrixExpressionResult<double> {
+		typedef Matrix<double> Type;
+	};
+
+	template<>
+	struct MatrixExpressionResult<float> {
+		typedef Matrix<float> Type;
+	};
+
+	template<>
+	struct MatrixExpressionResult<ComplexNumber> {
+		typedef ComplexMatrix Type;
+	};
+
+
+
+	// base class of every expression, E is the derived class and T the
+	// element type
+	template<class E, class T>
+	class MatrixExpression {
+	public:
+		const E& Expression(void) const;
+		long NumRows(void) const;
+		long NumColumns(void) const;
+
+		// element access without range checking
+		T Element(long i, long j) const;
+
+		// elementwise complex conjugate
+		ConjugateMatrix<E, T> Conjugate(void) const;
+
+		// the expression evaluated into a new matrix
+		typename MatrixExpressionResult<T>::Type Eval(void) const;
+
+		// the Frobenius norm and the trace, in one pass over the expression
+		double Norm(void) const;
+		T Trace(void) const;
+	};
+
+
+
+	// matrices are held by reference, other expressions (which are small) by
+	// value so temporaries built inside a larger expression stay alive
+	template<class E>
+	struct MatrixExpressionOperand {
+		typedef const E Type;
+	};
+
+	template<>
+	struct MatrixExpressionOperand<Matrix<double> > {
+		typedef const Matrix<double>& Type;
+	};
+
+	template<>
+	struct MatrixExpressionOperand<Matrix<float> > {
+		typedef const Matrix<float>& Type;
+	};
+
+	template<>
+	struct MatrixExpressionOperand<ComplexMatrix> {
+		typedef const ComplexMatrix& Type;
+	};
+
+
+
+	template<class L, class R, class T>
+	class MatrixSum : public MatrixExpression<MatrixSum<L, R, T>, T> {
+	public:
+		MatrixSum(const L &left, const R &right);
+		long NumRows(void) const;
+		long NumColumns(void) const;
+		T Element(long i, long j) const;
+
+	private:
+		typename MatrixExpressionOperand<L>::Type mLeft;
+		typename MatrixExpressionOperand<R>::Type mRight;
+	};
+
+
+
+	template<class L, class R, class T>
+	class MatrixDifference : public MatrixExpression<MatrixDifference<L, R, T>, T> {
+	public:
+		MatrixDifference(const L &left, const R &right);
+		long NumRows(void) const;
+		long NumColumns(void) const;
+		T Element(long i, long j) const;
+
+	private:
+		typename MatrixExpressionOperand<L>::Type mLeft;
+		typename MatrixExpressionOperand<R>::Type mRight;
+	};
+
+
+
+	// S is the scalar type, double or ComplexNumber
+	template<class E, class S, class T>
+	class ScaledMatrix : public MatrixExpression<ScaledMatrix<E, S, T>, T> {
+	public:
+		ScaledMatrix(const S &scalar, const E &e);
+		long NumRows(void) const;
+		long NumColumns(void) const;
+		T Element(long i, long j) const;
+
+	private:
+		S mScalar;
+		typename MatrixExpressionOperand<E>::Type mExpression;
+	};
+
+
+
+	template<class E, class T>
+	class ConjugateMatrix : public MatrixExpression<ConjugateMatrix<E, T>, T> {
+	public:
+		ConjugateMatrix(const E &e);
+		long NumRows(void) const;
+		long NumColumns(void) const;
+		T Element(long i, long j) const;
+
+	private:
+		typename MatrixExpressionOperand<E>::Type mExpression;
+	};
+
+
+
+	// elementwise helpers shared by the real and complex expressions
+	inline double ScaleElement(double a, double x)
+	{
+		return a * x;
+	}
+
+
+
+	inline ComplexNumber ScaleElement(double a, const ComplexNumber &z)
+	{
+		return ComplexNumber(a * z.RealPart(), a * z.ImaginaryPart());
+	}
+
+
+
+	inline ComplexNumber ScaleElement(const ComplexNumber &a, const ComplexNumber &z)
+	{
+		return a * z;
+	}
+
+
+
+	inline double ConjugateElement(double x)
+	{
+		return x;
+	}
+
+
+
+	inline ComplexNumber ConjugateElement(const ComplexNumber &z)
+	{
+		return z.Conjugate();
+	}
+
+
+
+	inline double SquaredElement(double x)
+	{
+		return x * x;
+	}
+
+
+
+	inline double SquaredElement(const ComplexNumber &z)
+	{
+		return z.ModulusSquared();
+	}
+
+
+
+	template<class E, class T>
+	inline const E& MatrixExpression<E, T>::Expression() const
+	{
+		return static_cast<const E&>(*this);
+	}
+
+
+
+	template<class E, class T>
+	inline long MatrixExpression<E, T>::NumRows() const
+	{
+		return Expression().NumRows();
+	}
+
+
+
+	template<class E, class T>
+	inline long MatrixExpression<E, T>::NumColumns() const
+	{
+		return Expression().NumColumns();
+	}
+
+
+
+	template<class E, class T>
+	inline T MatrixExpression<E, T>::Element(long i, long j) const
+	{
+		return Expression().Element(i, j);
+	}
+
+
+
+	template<class E, class T>
+	inline ConjugateMatrix<E, T> MatrixExpression<E, T>::Conjugate() const
+	{
+		return ConjugateMatrix<E, T>(Expression());
+	}
+
+
+
+	template<class E, class T>
+	inline typename MatrixExpressionResult<T>::Type MatrixExpression<E, T>::Eval() const
+	{
+		return typename MatrixExpressionResult<T>::Type(*this);
+	}
+
+
+
+	template<class E, class T>
+	inline double MatrixExpression<E, T>::Norm() const
+	{
+		const E &e = Expression();
+		long rows = e.NumRows();
+		long columns = e.NumColumns();
+
+		double sum = 0.0;
+		for (long i = 0; i < rows; ++i) {
+			for (long j = 0; j < columns; ++j)
+				sum += SquaredElement(e.Element(i, j));
+		}
+
+		return sqrt(sum);
+	}
+
+
+
+	template<class E, class T>
+	inline T MatrixExpression<E, T>::Trace() const
+	{
+		const E &e = Expression();
+		if (e.NumRows() != e.NumColumns())
+			ThrowException("MatrixExpression::Trace : matrix is not square");
+
+		T sum = T();
+		for (long i = 0; i < e.NumRows(); ++i)
+			sum += e.Element(i, i);
+
+		return sum;
+	}
+
+
+
+	template<class L, class R, class T>
+	inline MatrixSum<L, R, T>::MatrixSum(const L &left, const R &right)
+		: mLeft(left), mRight(right)
+	{
+		if ((left.NumRows() != right.NumRows()) || (left.NumColumns() != right.NumColumns()))
+			ThrowException("MatrixSum : matrices are different sizes");
+
+		return;
+	}
+
+
+
+	template<class L, class R, class T>
+	inline long MatrixSum<L, R, T>::NumRows() const
+	{
+		return mLeft.NumRows();
+	}
+
+
+
+	template<class L, class R, class T>
+	inline long MatrixSum<L, R, T>::NumColumns() const
+	{
+		return mLeft.NumColumns();
+	}
+
+
+
+	template<class L, class R, class T>
+	inline T MatrixSum<L, R, T>::Element(long i, long j) const
+	{
+		return mLeft.Element(i, j) + mRight.Element(i, j);
+	}
+
+
+
+	template<class L, class R, class T>
+	inline MatrixDifference<L, R, T>::MatrixDifference(const L &left, const R &right)
+		: mLeft(left), mRight(right)
+	{
+		if ((left.NumRows() != right.NumRows()) || (left.NumColumns() != right.NumColumns()))
+			ThrowException("MatrixDifference : matrices are different sizes");
+
+		return;
+	}
+
+
+
+	template<class L, class R, class T>
+	inline long MatrixDifference<L, R, T>::NumRows() const
+	{
+		return mLeft.NumRows();
+	}
+
+
+
+	template<class L, class R, class T>
+	inline long MatrixDifference<L, R, T>::NumColumns() const
+	{
+		return mLeft.NumColumns();
+	}
+
+
+
+	template<class L, class R, class T>
+	inline T MatrixDifference<L, R, T>::Element(long i, long j) const
+	{
+		return mLeft.Element(i, j) - mRight.Element(i, j);
+	}
+
+
+
+	template<class E, class S, class T>
+	inline ScaledMatrix<E, S, T>::ScaledMatrix(const S &scalar, const E &e)
+		: mScalar(scalar), mExpression(e)
+	{
+		return;
+	}
+
+
+
+	template<class E, class S, class T>
+	inline long ScaledMatrix<E, S, T>::NumRows() const
+	{
+		return mExpression.NumRows();
+	}
+
+
+
+	template<class E, class S, class T>
+	inline long ScaledMatrix<E, S, T>::NumColumns() const
+	{
+		return mExpression.NumColumns();
+	}
+
+
+
+	template<class E, class S, class T>
+	inline T ScaledMatrix<E, S, T>::Element(long i, long j) const
+	{
+		return ScaleElement(mScalar, mExpression.Element(i, j));
+	}
+
+
+
+	template<class E, class T>
+	inline ConjugateMatrix<E, T>::ConjugateMatrix(const E &e)
+		: mExpression(e)
+	{
+		return;
+	}
+
+
+
+	template<class E, class T>
+	inline long ConjugateMatrix<E, T>::NumRows() const
+	{
+		return mExpression.NumRows();
+	}
+
+
+
+	template<class E, class T>
+	inline long ConjugateMatrix<E, T>::NumColumns() const
+	{
+		return mExpression.NumColumns();
+	}
+
+
+
+	template<class E, class T>
+	inline T ConjugateMatrix<E, T>::Element(long i, long j) const
+	{
+		return ConjugateElement(mExpression.Element(i, j));
+	}
+
+
+
+	// operators
+	template<class L, class R, class T>
+	inline MatrixSum<L, R, T> operator+(const MatrixExpression<L, T> &left, const MatrixExpression<R, T> &right)
+	{
+		return MatrixSum<L, R, T>(left.Expression(), right.Expression());
+	}
+
+
+
+	template<class L, class R, class T>
+	inline MatrixDifference<L, R, T> operator-(const MatrixExpression<L, T> &left, const MatrixExpression<R, T> &right)
+	{
+		return MatrixDifference<L, R, T>(left.Expression(), right.Expression());
+	}
+
+
+
+	template<class E, class T>
+	inline ScaledMatrix<E, double, T> operator*(double a, const MatrixExpression<E, T> &e)
+	{
+		return ScaledMatrix<E, double, T>(a, e.Expression());
+	}
+
+
+
+	template<class E, class T>
+	inline ScaledMatrix<E, double, T> operator*(const MatrixExpression<E, T> &e, double a)
+	{
+		return ScaledMatrix<E, double, T>(a, e.Expression());
+	}
+
+
+
+	template<class E>
+	inline ScaledMatrix<E, ComplexNumber, ComplexNumber> operator*(const ComplexNumber &a,
+		const MatrixExpression<E, ComplexNumber> &e)
+	{
+		return ScaledMatrix<E, ComplexNumber, ComplexNumber>(a, e.Expression());
+	}
+
+
+
+	template<class E>
+	inline ScaledMatrix<E, ComplexNumber, ComplexNumber> operator*(const MatrixExpression<E, ComplexNumber> &e,
+		const ComplexNumber &a)
+	{
+		return ScaledMatrix<E, ComplexNumber, ComplexNumber>(a, e.Expression());
+	}
+
+
+
+	// products aren't elementwise, so the expression operands are evaluated
+	// into temporaries first and the matrices' own operator* does the rest
+	template<class E, class T>
+	inline typename MatrixExpressionResult<T>::Type operator*(const MatrixExpression<E, T> &e,
+		const typename MatrixExpressionResult<T>::Type &m)
+	{
+		return e.Eval() * m;
+	}
+
+
+
+	template<class E, class T>
+	inline typename MatrixExpressionResult<T>::Type operator*(const typename MatrixExpressionResult<T>::Type &m,
+		const MatrixExpression<E, T> &e)
+	{
+		return m * e.Eval();
+	}
+
+
+
+	template<class L, class R, class T>
+	inline typename MatrixExpressionResult<T>::Type operator*(const MatrixExpression<L, T> &left,
+		const MatrixExpression<R, T> &right)
+	{
+		return left.Eval() * right.Eval();
+	}
+}
+
+#endif // _matrixexpression_h_
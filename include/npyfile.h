@@ -0,0 +1,138 @@
+/*
+ * Copyright (C) 2004-2018 David Bernstein <david.h.bernstein@gmail.com>
+ *
+ * This file is part of utility_cpp.
+ *
+ * utility_cpp is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * utility_cpp is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with utility_cpp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _npyfile_h_
+#define _npyfile_h_
+
+#include "utility.h"
+#include "array.h"
+#include "realmatrix.h"
+#include "floatmatrix.h"
+#include "complexmatrix.h"
+
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+namespace utility {
+	// binary files in NumPy's .npy format, readable with numpy.load
+	// matrices are written as 2-D C order arrays and arrays as 1-D ones, the
+	// element types are float64, float32, complex128 and int64
+	// the data goes to and from the file in one block, with no formatting
+	void SaveNpy(const std::string &fileName, const Matrix<double> &m);
+	void SaveNpy(const std::string &fileName, const Matrix<float> &m);
+	void SaveNpy(const std::string &fileName, const ComplexMatrix &m);
+	void SaveNpy(const std::string &fileName, const Array<double> &a);
+	void SaveNpy(const std::string &fileName, const Array<float> &a);
+	void SaveNpy(const std::string &fileName, const Array<long> &a);
+	void SaveNpy(const std::string &fileName, const Array<ComplexNumber> &a);
+
+	// the element type has to match, Fortran order 2-D files are transposed
+	// on the way in
+	void LoadNpy(const std::string &fileName, Matrix<double> &m);
+	void LoadNpy(const std::string &fileName, Matrix<float> &m);
+	void LoadNpy(const std::string &fileName, ComplexMatrix &m);
+	void LoadNpy(const std::string &fileName, Array<double> &a);
+	void LoadNpy(const std::string &fileName, Array<float> &a);
+	void LoadNpy(const std::string &fileName, Array<long> &a);
+	void LoadNpy(const std::string &fileName, Array<ComplexNumber> &a);
+
+
+
+	// a .npy file mapped read-only, the data is used where it lies in the
+	// file with no copy, and only the pages that are touched are read
+	class MappedNpyFile {
+	public:
+		// Constructors
+		MappedNpyFile(void);
+		MappedNpyFile(const std::string &fileName);
+
+		// Destructor
+		~MappedNpyFile(void);
+
+		void Open(const std::string &fileName);
+		void Close(void);
+		bool IsOpen(void) const;
+
+		// the NumPy type string, e.g. "<f8"
+		const std::string& TypeDescription(void) const;
+		bool FortranOrder(void) const;
+
+		long NumDimensions(void) const;
+		long Dimension(long i) const;
+		long NumElements(void) const;
+
+		// for 1-D files the rows are the elements and there is one column
+		long NumRows(void) const;
+		long NumColumns(void) const;
+
+		// T is double, float, long or ComplexNumber and has to match the file,
+		// element (i, j) of a C order file is at Data<T>()[i * NumColumns() + j]
+		template<class T> const T* Data(void) const;
+
+	private:
+		// not copyable, the mapping belongs to one object
+		MappedNpyFile(const MappedNpyFile &f);
+		MappedNpyFile& operator=(const MappedNpyFile &f);
+
+		// does the work of Open, which closes whatever it leaves open if it
+		// throws
+		void MapFile(const std::string &fileName);
+
+	private:
+		int mFile;
+		char *mMap;
+		size_t mMapSize;
+		size_t mDataOffset;
+
+		std::string mTypeDescription;
+		bool mFortranOrder;
+		std::vector<long> mShape;
+	};
+
+
+
+	inline bool MappedNpyFile::IsOpen() const
+	{
+		return mMap != NULL;
+	}
+
+
+
+	inline const std::string& MappedNpyFile::TypeDescription() const
+	{
+		return mTypeDescription;
+	}
+
+
+
+	inline bool MappedNpyFile::FortranOrder() const
+	{
+		return mFortranOrder;
+	}
+
+
+
+	inline long MappedNpyFile::NumDimensions() const
+	{
+		return (long) mShape.size();
+	}
+}
+
+#endif // _npyfile_h_
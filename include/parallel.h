@@ -0,0 +1,47 @@
+/*
+ * Copyright (C) 2004-2018 David Bernstein <david.h.bernstein@gmail.com>
+ *
+ * This file is part of utility_cpp.
+ *
+ * utility_cpp is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * utility_cpp is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with utility_cpp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _parallel_h_
+#define _parallel_h_
+
+#include "utility.h"
+
+// Threading is done with OpenMP. When the library is built without OpenMP
+// support (no -fopenmp) the pragmas are ignored, everything runs serially
+// and NumThreads() always returns 1.
+
+namespace utility {
+	// number of threads used by the parallel kernels, n <= 0 restores the
+	// default (the number of processors OpenMP reports)
+	void SetNumThreads(long n);
+	long NumThreads(void);
+	
+	// true if a kernel doing about numOperations multiply-adds should be
+	// split across threads, small problems run serially because starting
+	// the threads costs more than it saves
+	bool UseThreads(double numOperations);
+	
+	// the thread index inside a parallel region, 0 outside of one
+	long ThreadIndex(void);
+	
+	// problems with fewer multiply-adds than this run serially
+	const double PARALLEL_MIN_OPERATIONS = 128.0 * 128.0 * 128.0;
+}
+
+#endif // _parallel_h_
@@ -0,0 +1,151 @@
+/*
+ * Copyright (C) 2004-2018 David Bernstein <david.h.bernstein@gmail.com>
+ *
+ * This file is part of utility_cpp.
+ *
+ * utility_cpp is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * utility_cpp is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with utility_cpp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _planarcomplexmatrix_h_
+#define _planarcomplexmatrix_h_
+
+#include "utility.h"
+#include "complexnumber.h"
+#include "realmatrix.h"
+#include "complexmatrix.h"
+
+namespace utility {
+	// a complex matrix kept as two real matrices, one of the real parts and
+	// one of the imaginary parts, instead of ComplexMatrix's interleaved
+	// ComplexNumbers
+	// every operation then becomes real operations on whole planes, so a
+	// product is four real GEMMs with the full-width micro-kernel and sums
+	// and norms are the vector kernels of simd.h, with none of the shuffling
+	// interleaved storage needs
+	// convert with CopyFrom and CopyTo when a ComplexMatrix is wanted
+	class PlanarComplexMatrix {
+	public:
+		// Constructors
+		PlanarComplexMatrix(long numRows = 0, long numColumns = 0);
+		PlanarComplexMatrix(const ComplexMatrix &m);
+
+		// Destructor
+		~PlanarComplexMatrix(void) { };
+
+		// conversion from and to the interleaved layout
+		void CopyFrom(const ComplexMatrix &m);
+		void CopyTo(ComplexMatrix &m) const;
+
+		// operators
+		ComplexNumber operator()(long i, long j) const;
+		PlanarComplexMatrix operator*(const PlanarComplexMatrix &m) const;
+		PlanarComplexMatrix& operator+=(const PlanarComplexMatrix &m);
+		PlanarComplexMatrix& operator-=(const PlanarComplexMatrix &m);
+		PlanarComplexMatrix& operator*=(const ComplexNumber &a);
+
+		// Sets and Gets
+		void SetSize(long numRows, long numColumns);
+		long NumRows(void) const;
+		long NumColumns(void) const;
+		void Set(long i, long j, const ComplexNumber &z);
+
+		// the planes themselves
+		Matrix<double>& RealPart(void);
+		const Matrix<double>& RealPart(void) const;
+		Matrix<double>& ImaginaryPart(void);
+		const Matrix<double>& ImaginaryPart(void) const;
+
+		// Matrix functions, the same as ComplexMatrix's
+		void ConjugateInPlace(void);
+		void MakeZero(void);
+		ComplexNumber InnerProduct(const PlanarComplexMatrix &m) const;
+		double Norm(void) const;
+		double Distance(const PlanarComplexMatrix &m) const;
+
+	private:
+		void CheckSameSize(const PlanarComplexMatrix &m, const char *method) const;
+
+	private:
+		Matrix<double> mReal;
+		Matrix<double> mImaginary;
+	};
+
+
+
+	// C = alpha * op(A) * op(B) + beta * C as four real GEMMs, with real
+	// alpha and beta (use *= for a complex factor), C is sized to fit when
+	// beta is zero and may not be A or B
+	void Gemm(MatrixOperation opA, MatrixOperation opB, double alpha, const PlanarComplexMatrix &a,
+			  const PlanarComplexMatrix &b, double beta, PlanarComplexMatrix &c);
+
+
+
+	inline ComplexNumber PlanarComplexMatrix::operator()(long i, long j) const
+	{
+		return ComplexNumber(mReal(i, j), mImaginary(i, j));
+	}
+
+
+
+	inline void PlanarComplexMatrix::Set(long i, long j, const ComplexNumber &z)
+	{
+		mReal(i, j) = z.RealPart();
+		mImaginary(i, j) = z.ImaginaryPart();
+		return;
+	}
+
+
+
+	inline long PlanarComplexMatrix::NumRows() const
+	{
+		return mReal.NumRows();
+	}
+
+
+
+	inline long PlanarComplexMatrix::NumColumns() const
+	{
+		return mReal.NumColumns();
+	}
+
+
+
+	inline Matrix<double>& PlanarComplexMatrix::RealPart()
+	{
+		return mReal;
+	}
+
+
+
+	inline const Matrix<double>& PlanarComplexMatrix::RealPart() const
+	{
+		return mReal;
+	}
+
+
+
+	inline Matrix<double>& PlanarComplexMatrix::ImaginaryPart()
+	{
+		return mImaginary;
+	}
+
+
+
+	inline const Matrix<double>& PlanarComplexMatrix::ImaginaryPart() const
+	{
+		return mImaginary;
+	}
+}
+
+#endif // _planarcomplexmatrix_h_
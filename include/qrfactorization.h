@@ -0,0 +1,101 @@
+/*
+ * Copyright (C) 2004-2018 David Bernstein <david.h.bernstein@gmail.com>
+ *
+ * This file is part of utility_cpp.
+ *
+ * utility_cpp is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * utility_cpp is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with utility_cpp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _qrfactorization_h_
+#define _qrfactorization_h_
+
+#include "utility.h"
+#include "realmatrix.h"
+
+namespace utility {
+	// Householder QR factorization A = Q R of an m x n matrix with m >= n,
+	// Q is stored as the product of n reflectors H_i = I - tau_i v_i v_i^T
+	// Solve gives the least squares solution of A x = b without forming the
+	// normal equations A^T A x = A^T b, which square the condition number
+	class QRFactorization {
+	public:
+		// Constructors
+		QRFactorization(void);
+		QRFactorization(const Matrix<double> &a);
+		
+		// Destructor
+		~QRFactorization(void) { };
+		
+		// factorization
+		void Factor(const Matrix<double> &a);
+		bool Factored(void) const;
+		bool FullRank(void) const;
+		long NumRows(void) const;
+		long NumColumns(void) const;
+		
+		// x minimizes |A x - b| for every column of b, x has NumColumns() rows
+		void Solve(const Matrix<double> &b, Matrix<double> &x) const;
+		
+		// b = Q^T b and b = Q b, b has NumRows() rows
+		void ApplyQTranspose(Matrix<double> &b) const;
+		void ApplyQ(Matrix<double> &b) const;
+		
+		// the n x n factor R and the m x n matrix Q with orthonormal columns
+		void GetR(Matrix<double> &r) const;
+		void GetQ(Matrix<double> &q) const;
+		
+	private:
+		void CheckFactored(void) const;
+		void ApplyReflectors(Matrix<double> &b, bool transpose) const;
+		
+	private:
+		// R on and above the diagonal, the reflector vectors below it (their
+		// first element is 1 and not stored)
+		Matrix<double> mQR;
+		Array<double> mTau;
+		
+		// false if R has a zero on its diagonal
+		bool mFullRank;
+	};
+	
+	
+	
+	inline bool QRFactorization::Factored() const
+	{
+		return mQR.NumRows() > 0;
+	}
+	
+	
+	
+	inline bool QRFactorization::FullRank() const
+	{
+		return mFullRank;
+	}
+	
+	
+	
+	inline long QRFactorization::NumRows() const
+	{
+		return mQR.NumRows();
+	}
+	
+	
+	
+	inline long QRFactorization::NumColumns() const
+	{
+		return mQR.NumColumns();
+	}
+}
+
+#endif // _qrfactorization_h_
@@ -22,14 +22,20 @@
 
 #include "utility.h"
 #include "matrix.h"
+#include "matrixexpression.h"
+#include "workspacepool.h"
 
 namespace utility {
 	template<>
-	class Matrix<double> {
+	class Matrix<double> : public MatrixExpression<Matrix<double>, double> {
     public:
 		// Constructor
 		Matrix(long numRows = 0, long numColumns = 0);
         
+        // evaluates a lazy expression such as A + B - 2.0 * C
+        template<class E>
+        Matrix(const MatrixExpression<E, double> &e);
+        
 		// Destructor
 		virtual ~Matrix(void);
         void Erase(void);
@@ -44,25 +50,47 @@ namespace utility {
         Matrix<double> operator*(const Matrix<double> &m) const;
 		Matrix<double>& operator*=(double a);
         Matrix<double>& operator+=(const Matrix<double> &m);
+        
+        // operator* is CLASSICAL_MULTIPLY, STRASSEN_MULTIPLY pays off for
+        // large square products, see StrassenMultiplier for its error
+        // bound and to keep the workspace between products
+        Matrix<double> Multiply(const Matrix<double> &m, MatrixMultiplyType type) const;
+        
+        // + and - (and scalar *) are defined in matrixexpression.h and are
+        // evaluated on assignment
+        template<class E>
+        Matrix<double>& operator=(const MatrixExpression<E, double> &e);
+        template<class E>
+        Matrix<double>& operator+=(const MatrixExpression<E, double> &e);
+        
+        // element access without range checking, used by the expressions
+        const double& Element(long i, long j) const;
 		
 		// Sets and Gets
 		void SetSize(long numRows, long numColumns);
 		long NumRows(void) const;
 		long NumColumns(void) const;
 		
+		// raw access to the contiguous row-major storage, element (i, j)
+		// lives at Data()[i * Stride() + j]
+		double* Data(void);
+		const double* Data(void) const;
+		long Stride(void) const;
+		
 		// various matrix operations
         double Determinant(void) const;
         void MakeRandom(long seed = 1);
 		void MakeZero(void);
         void Print(void) const;
         void Inverse(Matrix<double> &inv) const;
+        Matrix<double> Transpose(void) const;
+        void TransposeInPlace(void);
         
-        // numerical recipes
-    	void lubksb(double **a, int n, int *indx, double b[]) const;
-    	void ludcmp(double **a, int n, int *indx, double *d) const;
+        // exp of a square matrix, see MatrixExponential to keep the work
+        // matrices between calls
+        Matrix<double> Exponential(void) const;
         
     protected:
-        void MakeNRMatrix(Matrix<double> &nr) const;
 		void ThrowOutOfRangeException(void) const; 
         
     protected:
@@ -70,8 +98,11 @@ namespace utility {
         long mRows;
 		long mColumns;
         
-		// data pointer
-		double **mpData;
+        // distance in elements between the starts of consecutive rows
+        long mStride;
+        
+		// data pointer, a single row-major block of mRows * mStride elements
+		double *mpData;
 	};
     
     
@@ -81,7 +112,7 @@ namespace utility {
         if ((i >= mRows) || (i < 0) || (j >= mColumns) || (j < 0))
             ThrowOutOfRangeException();
 			
-        return mpData[i][j];
+        return mpData[i * mStride + j];
 	}
 	
     
@@ -91,7 +122,7 @@ namespace utility {
 		if ((i >= mRows) || (i < 0) || (j >= mColumns) || (j < 0))
 			ThrowOutOfRangeException();
         
-		return mpData[i][j];
+		return mpData[i * mStride + j];
 	}
 	
     
@@ -101,6 +132,7 @@ namespace utility {
         mpData = NULL;
         mRows = 0;
         mColumns = 0;
+        mStride = 0;
             
         SetSize(numRows, numColumns);
             
@@ -120,15 +152,13 @@ namespace utility {
     inline void Matrix<double>::Erase()
 	{
         if (mpData != NULL) {
-            for (long i = 0; i < mRows; ++i)
-                delete [] mpData[i];
-				
-                delete [] mpData;
+            WorkspaceRelease(mpData, mRows * mStride * sizeof(double));
                 
-                mpData = NULL;
-                mRows = 0;
-                mColumns = 0;
-            }
+            mpData = NULL;
+            mRows = 0;
+            mColumns = 0;
+            mStride = 0;
+        }
         else {
             if ((mRows > 0) || (mColumns > 0))
                 ThrowException("Array::Erase : inconsistent data");
@@ -143,6 +173,11 @@ namespace utility {
 	// copy constructor
     inline Matrix<double>::Matrix(const Matrix<double> &m)
 	{
+        mpData = NULL;
+        mRows = 0;
+        mColumns = 0;
+        mStride = 0;
+        
         *this = m;
         return;
 	}
@@ -158,9 +193,10 @@ namespace utility {
         SetSize(m.mRows, m.mColumns);
             
         for (long i = 0; i < mRows; ++i) {
-            for (long j = 0; j < mColumns; ++j) {
-                mpData[i][j] = m.mpData[i][j];
-            }
+            double *row = mpData + i * mStride;
+            const double *mRow = m.mpData + i * m.mStride;
+            for (long j = 0; j < mColumns; ++j) 
+                row[j] = mRow[j];
         }
             
         return *this;
@@ -184,10 +220,11 @@ namespace utility {
             
         mRows = numRows;
         mColumns = numColumns;
+        mStride = numColumns;
             
-        mpData = new double*[mRows];
-        for (long i = 0; i < mRows; ++i)
-            mpData[i] = new double[mColumns];
+        // one block for the whole matrix, rows are stored back to back, the
+        // block is recycled through workspacepool.h
+        mpData = static_cast<double*>(WorkspaceAllocate(mRows * mStride * sizeof(double)));
             
         return;
 	}
@@ -208,6 +245,94 @@ namespace utility {
 	
     
     
+    inline double* Matrix<double>::Data()
+	{
+		return mpData;
+	}
+	
+	
+	
+    inline const double* Matrix<double>::Data() const
+	{
+		return mpData;
+	}
+	
+	
+	
+    inline long Matrix<double>::Stride() const
+	{
+		return mStride;
+	}
+	
+    
+    
+    inline const double& Matrix<double>::Element(long i, long j) const
+    {
+        return mpData[i * mStride + j];
+    }
+    
+    
+    
+    template<class E>
+    inline Matrix<double>::Matrix(const MatrixExpression<E, double> &e)
+    {
+        mpData = NULL;
+        mRows = 0;
+        mColumns = 0;
+        mStride = 0;
+        
+        *this = e;
+        return;
+    }
+    
+    
+    
+    template<class E>
+    inline Matrix<double>& Matrix<double>::operator=(const MatrixExpression<E, double> &e)
+    {
+        // every expression is elementwise so it is safe for this matrix to
+        // appear in e, in which case the size can't change
+        const E &expression = e.Expression();
+        SetSize(expression.NumRows(), expression.NumColumns());
+        
+        for (long i = 0; i < mRows; ++i) {
+            double *row = mpData + i * mStride;
+            for (long j = 0; j < mColumns; ++j) 
+                row[j] = expression.Element(i, j);
+        }
+        
+        return *this;
+    }
+    
+    
+    
+    template<class E>
+    inline Matrix<double>& Matrix<double>::operator+=(const MatrixExpression<E, double> &e)
+    {
+        const E &expression = e.Expression();
+        if ((expression.NumRows() != mRows) || (expression.NumColumns() != mColumns))
+            ThrowException("Matrix<double>::operator+= : matrices are different sizes");
+        
+        for (long i = 0; i < mRows; ++i) {
+            double *row = mpData + i * mStride;
+            for (long j = 0; j < mColumns; ++j) 
+                row[j] += expression.Element(i, j);
+        }
+        
+        return *this;
+    }
+    
+    
+    
+    // a scalar on the right, without this Matrix(long) would make m * 2.0
+    // ambiguous with the matrix product
+    inline ScaledMatrix<Matrix<double>, double, double> operator*(const Matrix<double> &m, double a)
+    {
+        return ScaledMatrix<Matrix<double>, double, double>(a, m);
+    }
+    
+    
+    
     inline void Matrix<double>::ThrowOutOfRangeException() const
 	{
 		ThrowException("Matrix index out of range");
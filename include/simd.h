@@ -0,0 +1,92 @@
+/*
+ * Copyright (C) 2004-2018 David Bernstein <david.h.bernstein@gmail.com>
+ *
+ * This file is part of utility_cpp.
+ *
+ * utility_cpp is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * utility_cpp is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with utility_cpp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _simd_h_
+#define _simd_h_
+
+#include "utility.h"
+
+// Hand vectorized kernels. The instruction set is detected with CPUID the
+// first time any kernel is used and the matching versions are called from
+// then on, so a single binary runs the best code the processor supports.
+// On compilers or processors other than gcc/clang on x86 only the scalar
+// versions exist.
+
+namespace utility {
+	// instruction set selection
+	SimdInstructionSet DetectSimdInstructionSet(void);
+	SimdInstructionSet CurrentSimdInstructionSet(void);
+	void SetSimdInstructionSet(SimdInstructionSet instructionSet);
+	
+	// elementwise kernels on n contiguous doubles
+	void VectorAdd(long n, const double *x, double *y);
+	void VectorScale(long n, double a, double *y);
+	void VectorZero(long n, double *y);
+	
+	// y += a x and the dot product of x and y
+	void VectorAxpy(long n, double a, const double *x, double *y);
+	double VectorDot(long n, const double *x, const double *y);
+	
+	// the sum of (x - y)^2, without forming x - y
+	double VectorDistanceSquared(long n, const double *x, const double *y);
+	
+	// dot[0] + i dot[1] = sum conj(x) y, and sum x y for the unconjugated
+	// form, over n interleaved complex numbers (2n doubles)
+	void VectorComplexDot(long n, const double *x, const double *y, double *dot);
+	void VectorComplexDotUnconjugated(long n, const double *x, const double *y, double *dot);
+	
+	// and on n contiguous floats
+	void VectorAdd(long n, const float *x, float *y);
+	void VectorScale(long n, float a, float *y);
+	void VectorZero(long n, float *y);
+	
+	// y *= (ar + i ai) on n interleaved complex numbers (2n doubles)
+	void VectorComplexScale(long n, double ar, double ai, double *y);
+	
+	// GEMM micro-kernel, sets the mr x nr row-major block ab to the product
+	// of an A panel packed mr tall and a B panel packed nr wide, both kc long
+	typedef void (*GemmMicroKernelFunction)(long kc, const double *a, const double *b, double *ab);
+	
+	struct GemmMicroKernel {
+		long mr;
+		long nr;
+		GemmMicroKernelFunction function;
+	};
+	
+	GemmMicroKernel CurrentGemmMicroKernel(void);
+	
+	// the same for single precision, a register holds twice as many floats
+	// so the blocks are twice as wide
+	typedef void (*GemmMicroKernelFunctionFloat)(long kc, const float *a, const float *b, float *ab);
+	
+	struct GemmMicroKernelFloat {
+		long mr;
+		long nr;
+		GemmMicroKernelFunctionFloat function;
+	};
+	
+	GemmMicroKernelFloat CurrentGemmMicroKernelFloat(void);
+	
+	// upper bounds on the register block over all instruction sets and
+	// both precisions
+	const long GEMM_MAX_MR = 8;
+	const long GEMM_MAX_NR = 32;
+}
+
+#endif // _simd_h_
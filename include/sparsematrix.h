@@ -0,0 +1,615 @@
+/*
+ * Copyright (C) 2004-2018 David Bernstein <david.h.bernstein@gmail.com>
+ *
+ * This file is part of utility_cpp.
+ *
+ * utility_cpp is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * utility_cpp is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with utility_cpp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _sparsematrix_h_
+#define _sparsematrix_h_
+
+#include "utility.h"
+#include "array.h"
+#include "complexnumber.h"
+#include "realmatrix.h"
+#include "complexmatrix.h"
+#include "parallel.h"
+
+#include <algorithm>
+#include <vector>
+
+// Sparse matrices in compressed sparse row (CSR) form. The nonzeros of row i
+// are mValue[mRowStart[i]] to mValue[mRowStart[i + 1] - 1], sorted by column,
+// with their columns in mColumnIndex. A matrix is built by collecting
+// (row, column, value) triplets in any order and then assembling them, or by
+// converting a dense matrix. T is double or ComplexNumber, and the dense
+// matrices used in the products and conversions are Matrix<double> or
+// ComplexMatrix to match.
+
+namespace utility {
+	// the dense matrix type with the same elements
+	template<class T>
+	struct SparseDenseMatrix;
+
+	template<>
+	struct SparseDenseMatrix<double> {
+		typedef Matrix<double> Type;
+	};
+
+	template<>
+	struct SparseDenseMatrix<ComplexNumber> {
+		typedef ComplexMatrix Type;
+	};
+
+
+
+	// unordered (row, column, value) entries, duplicates are added together
+	// when the matrix is assembled
+	template<class T>
+	class SparseMatrixTriplets {
+	public:
+		// Constructor
+		SparseMatrixTriplets(long numRows = 0, long numColumns = 0);
+
+		void SetSize(long numRows, long numColumns);
+		void Reserve(long numEntries);
+		void Add(long i, long j, const T &value);
+		void Clear(void);
+
+		long NumRows(void) const;
+		long NumColumns(void) const;
+		long NumEntries(void) const;
+
+		long Row(long k) const;
+		long Column(long k) const;
+		const T& Value(long k) const;
+
+	private:
+		long mRows;
+		long mColumns;
+		std::vector<long> mRow;
+		std::vector<long> mColumn;
+		std::vector<T> mValue;
+	};
+
+
+
+	template<class T>
+	class SparseMatrix {
+	public:
+		typedef typename SparseDenseMatrix<T>::Type DenseMatrix;
+
+		// Constructor
+		SparseMatrix(void);
+		SparseMatrix(const SparseMatrixTriplets<T> &triplets);
+		SparseMatrix(const DenseMatrix &m, double tolerance = 0.0);
+
+		// Destructor
+		~SparseMatrix(void) { };
+
+		// builds the matrix from triplets, summing duplicate entries
+		void Assemble(const SparseMatrixTriplets<T> &triplets);
+
+		// conversion to and from dense storage, entries of magnitude no
+		// more than tolerance are dropped
+		void FromDense(const DenseMatrix &m, double tolerance = 0.0);
+		void ToDense(DenseMatrix &m) const;
+
+		// y = A x, x has NumColumns() elements and y NumRows()
+		void Multiply(const T *x, T *y) const;
+
+		// C = A B for a dense B
+		void Multiply(const DenseMatrix &b, DenseMatrix &c) const;
+
+		// element (i, j), zero if it isn't stored
+		T operator()(long i, long j) const;
+
+		// Sets and Gets
+		long NumRows(void) const;
+		long NumColumns(void) const;
+		long NumNonzeros(void) const;
+
+		// raw CSR arrays
+		const long* RowStart(void) const;
+		const long* ColumnIndex(void) const;
+		const T* Values(void) const;
+
+	private:
+		void SetRowPartition(void);
+
+	private:
+		long mRows;
+		long mColumns;
+
+		// mRows + 1 offsets into mColumnIndex and mValue
+		Array<long> mRowStart;
+		Array<long> mColumnIndex;
+		Array<T> mValue;
+
+		// rows mPartition[p] to mPartition[p + 1] - 1 hold about the same
+		// number of nonzeros, the products hand these ranges to the threads
+		// so one dense row doesn't leave the other threads waiting
+		Array<long> mPartition;
+	};
+
+
+
+	// magnitudes used when dropping small entries
+	inline double SparseMagnitude(double x)
+	{
+		return fabs(x);
+	}
+
+
+
+	inline double SparseMagnitude(const ComplexNumber &z)
+	{
+		return z.Modulus();
+	}
+
+
+
+	// row ranges per thread are this many times finer than the number of
+	// threads so the dynamic schedule can even out what's left
+	const long SPARSE_PARTITIONS_PER_THREAD = 4;
+
+
+
+	template<class T>
+	inline SparseMatrixTriplets<T>::SparseMatrixTriplets(long numRows, long numColumns)
+	{
+		mRows = 0;
+		mColumns = 0;
+
+		SetSize(numRows, numColumns);
+
+		return;
+	}
+
+
+
+	template<class T>
+	inline void SparseMatrixTriplets<T>::SetSize(long numRows, long numColumns)
+	{
+		if ((numRows < 0) || (numColumns < 0))
+			ThrowException("SparseMatrixTriplets::SetSize : negative size");
+
+		mRows = numRows;
+		mColumns = numColumns;
+
+		return;
+	}
+
+
+
+	template<class T>
+	inline void SparseMatrixTriplets<T>::Reserve(long numEntries)
+	{
+		mRow.reserve(numEntries);
+		mColumn.reserve(numEntries);
+		mValue.reserve(numEntries);
+
+		return;
+	}
+
+
+
+	template<class T>
+	inline void SparseMatrixTriplets<T>::Add(long i, long j, const T &value)
+	{
+		if ((i >= mRows) || (i < 0) || (j >= mColumns) || (j < 0))
+			ThrowException("SparseMatrixTriplets::Add : index out of range");
+
+		mRow.push_back(i);
+		mColumn.push_back(j);
+		mValue.push_back(value);
+
+		return;
+	}
+
+
+
+	template<class T>
+	inline void SparseMatrixTriplets<T>::Clear()
+	{
+		mRow.clear();
+		mColumn.clear();
+		mValue.clear();
+
+		return;
+	}
+
+
+
+	template<class T>
+	inline long SparseMatrixTriplets<T>::NumRows() const
+	{
+		return mRows;
+	}
+
+
+
+	template<class T>
+	inline long SparseMatrixTriplets<T>::NumColumns() const
+	{
+		return mColumns;
+	}
+
+
+
+	template<class T>
+	inline long SparseMatrixTriplets<T>::NumEntries() const
+	{
+		return mRow.size();
+	}
+
+
+
+	template<class T>
+	inline long SparseMatrixTriplets<T>::Row(long k) const
+	{
+		return mRow[k];
+	}
+
+
+
+	template<class T>
+	inline long SparseMatrixTriplets<T>::Column(long k) const
+	{
+		return mColumn[k];
+	}
+
+
+
+	template<class T>
+	inline const T& SparseMatrixTriplets<T>::Value(long k) const
+	{
+		return mValue[k];
+	}
+
+
+
+	template<class T>
+	inline SparseMatrix<T>::SparseMatrix()
+	{
+		mRows = 0;
+		mColumns = 0;
+
+		return;
+	}
+
+
+
+	template<class T>
+	inline SparseMatrix<T>::SparseMatrix(const SparseMatrixTriplets<T> &triplets)
+	{
+		mRows = 0;
+		mColumns = 0;
+
+		Assemble(triplets);
+
+		return;
+	}
+
+
+
+	template<class T>
+	inline SparseMatrix<T>::SparseMatrix(const DenseMatrix &m, double tolerance)
+	{
+		mRows = 0;
+		mColumns = 0;
+
+		FromDense(m, tolerance);
+
+		return;
+	}
+
+
+
+	template<class T>
+	void SparseMatrix<T>::Assemble(const SparseMatrixTriplets<T> &triplets)
+	{
+		mRows = triplets.NumRows();
+		mColumns = triplets.NumColumns();
+		long numEntries = triplets.NumEntries();
+
+		// bucket the triplets by row with a counting sort
+		std::vector<long> count(mRows + 1, 0);
+		for (long k = 0; k < numEntries; ++k)
+			++count[triplets.Row(k) + 1];
+		for (long i = 0; i < mRows; ++i)
+			count[i + 1] += count[i];
+
+		std::vector<long> order(numEntries);
+		std::vector<long> next(count.begin(), count.end() - 1);
+		for (long k = 0; k < numEntries; ++k)
+			order[next[triplets.Row(k)]++] = k;
+
+		// sort each row by column and merge duplicates, rows are
+		// independent so this is done in parallel and the rows are then
+		// packed together
+		std::vector<long> mergedColumn(numEntries);
+		std::vector<T> mergedValue(numEntries);
+		std::vector<long> rowLength(mRows, 0);
+
+		#pragma omp parallel for schedule(dynamic, 64) num_threads(NumThreads()) if (UseThreads((double) numEntries * 16.0))
+		for (long i = 0; i < mRows; ++i) {
+			long begin = count[i];
+			long end = count[i + 1];
+
+			// (column, triplet) pairs, so duplicates are summed in the
+			// order they were added
+			std::vector<std::pair<long, long> > row(end - begin);
+			for (long k = begin; k < end; ++k)
+				row[k - begin] = std::make_pair(triplets.Column(order[k]), order[k]);
+			std::sort(row.begin(), row.end());
+
+			long length = 0;
+			for (long k = 0; k < end - begin; ++k) {
+				if ((length > 0) && (row[k].first == mergedColumn[begin + length - 1])) {
+					mergedValue[begin + length - 1] += triplets.Value(row[k].second);
+				}
+				else {
+					mergedColumn[begin + length] = row[k].first;
+					mergedValue[begin + length] = triplets.Value(row[k].second);
+					++length;
+				}
+			}
+			rowLength[i] = length;
+		}
+
+		mRowStart.SetSize(mRows + 1);
+		mRowStart[0] = 0;
+		for (long i = 0; i < mRows; ++i)
+			mRowStart[i + 1] = mRowStart[i] + rowLength[i];
+
+		long numNonzeros = mRowStart[mRows];
+		mColumnIndex.SetSize(numNonzeros);
+		mValue.SetSize(numNonzeros);
+
+		for (long i = 0; i < mRows; ++i) {
+			for (long k = 0; k < rowLength[i]; ++k) {
+				mColumnIndex[mRowStart[i] + k] = mergedColumn[count[i] + k];
+				mValue[mRowStart[i] + k] = mergedValue[count[i] + k];
+			}
+		}
+
+		SetRowPartition();
+
+		return;
+	}
+
+
+
+	template<class T>
+	void SparseMatrix<T>::FromDense(const DenseMatrix &m, double tolerance)
+	{
+		mRows = m.NumRows();
+		mColumns = m.NumColumns();
+
+		const T *data = m.Data();
+		long stride = m.Stride();
+
+		mRowStart.SetSize(mRows + 1);
+		mRowStart[0] = 0;
+		for (long i = 0; i < mRows; ++i) {
+			long length = 0;
+			for (long j = 0; j < mColumns; ++j) {
+				if (SparseMagnitude(data[i * stride + j]) > tolerance)
+					++length;
+			}
+			mRowStart[i + 1] = mRowStart[i] + length;
+		}
+
+		mColumnIndex.SetSize(mRowStart[mRows]);
+		mValue.SetSize(mRowStart[mRows]);
+
+		long k = 0;
+		for (long i = 0; i < mRows; ++i) {
+			for (long j = 0; j < mColumns; ++j) {
+				const T &x = data[i * stride + j];
+				if (SparseMagnitude(x) > tolerance) {
+					mColumnIndex[k] = j;
+					mValue[k] = x;
+					++k;
+				}
+			}
+		}
+
+		SetRowPartition();
+
+		return;
+	}
+
+
+
+	template<class T>
+	void SparseMatrix<T>::ToDense(DenseMatrix &m) const
+	{
+		m.SetSize(mRows, mColumns);
+
+		T *data = m.Data();
+		long stride = m.Stride();
+
+		for (long i = 0; i < mRows; ++i) {
+			T *row = data + i * stride;
+			for (long j = 0; j < mColumns; ++j)
+				row[j] = T();
+			for (long k = mRowStart[i]; k < mRowStart[i + 1]; ++k)
+				row[mColumnIndex[k]] = mValue[k];
+		}
+
+		return;
+	}
+
+
+
+	template<class T>
+	void SparseMatrix<T>::Multiply(const T *x, T *y) const
+	{
+		const long *rowStart = mRowStart.Begin();
+		const long *columnIndex = mColumnIndex.Begin();
+		const T *value = mValue.Begin();
+		long numParts = mPartition.Size() - 1;
+
+		#pragma omp parallel for schedule(dynamic) num_threads(NumThreads()) if (UseThreads((double) NumNonzeros()))
+		for (long p = 0; p < numParts; ++p) {
+			for (long i = mPartition[p]; i < mPartition[p + 1]; ++i) {
+				T sum = T();
+				for (long k = rowStart[i]; k < rowStart[i + 1]; ++k)
+					sum += value[k] * x[columnIndex[k]];
+				y[i] = sum;
+			}
+		}
+
+		return;
+	}
+
+
+
+	template<class T>
+	void SparseMatrix<T>::Multiply(const DenseMatrix &b, DenseMatrix &c) const
+	{
+		if (b.NumRows() != mColumns)
+			ThrowException("SparseMatrix::Multiply : matrices are wrong size");
+
+		long n = b.NumColumns();
+		c.SetSize(mRows, n);
+
+		const T *bData = b.Data();
+		long ldb = b.Stride();
+		T *cData = c.Data();
+		long ldc = c.Stride();
+
+		const long *rowStart = mRowStart.Begin();
+		const long *columnIndex = mColumnIndex.Begin();
+		const T *value = mValue.Begin();
+		long numParts = mPartition.Size() - 1;
+
+		// each nonzero a_ij adds a_ij times row j of B to row i of C, so
+		// both B and C are walked along their contiguous rows
+		#pragma omp parallel for schedule(dynamic) num_threads(NumThreads()) if (UseThreads((double) NumNonzeros() * n))
+		for (long p = 0; p < numParts; ++p) {
+			for (long i = mPartition[p]; i < mPartition[p + 1]; ++i) {
+				T *cRow = cData + i * ldc;
+				for (long j = 0; j < n; ++j)
+					cRow[j] = T();
+
+				for (long k = rowStart[i]; k < rowStart[i + 1]; ++k) {
+					const T a = value[k];
+					const T *bRow = bData + columnIndex[k] * ldb;
+					for (long j = 0; j < n; ++j)
+						cRow[j] += a * bRow[j];
+				}
+			}
+		}
+
+		return;
+	}
+
+
+
+	template<class T>
+	T SparseMatrix<T>::operator()(long i, long j) const
+	{
+		if ((i >= mRows) || (i < 0) || (j >= mColumns) || (j < 0))
+			ThrowException("SparseMatrix::operator() : index out of range");
+
+		const long *begin = mColumnIndex.Begin() + mRowStart[i];
+		const long *end = mColumnIndex.Begin() + mRowStart[i + 1];
+		const long *position = std::lower_bound(begin, end, j);
+
+		if ((position == end) || (*position != j))
+			return T();
+
+		return mValue[position - mColumnIndex.Begin()];
+	}
+
+
+
+	template<class T>
+	inline long SparseMatrix<T>::NumRows() const
+	{
+		return mRows;
+	}
+
+
+
+	template<class T>
+	inline long SparseMatrix<T>::NumColumns() const
+	{
+		return mColumns;
+	}
+
+
+
+	template<class T>
+	inline long SparseMatrix<T>::NumNonzeros() const
+	{
+		return (mRows > 0) ? mRowStart[mRows] : 0;
+	}
+
+
+
+	template<class T>
+	inline const long* SparseMatrix<T>::RowStart() const
+	{
+		return mRowStart.Begin();
+	}
+
+
+
+	template<class T>
+	inline const long* SparseMatrix<T>::ColumnIndex() const
+	{
+		return mColumnIndex.Begin();
+	}
+
+
+
+	template<class T>
+	inline const T* SparseMatrix<T>::Values() const
+	{
+		return mValue.Begin();
+	}
+
+
+
+	template<class T>
+	void SparseMatrix<T>::SetRowPartition()
+	{
+		long numParts = NumThreads() * SPARSE_PARTITIONS_PER_THREAD;
+		if (numParts > mRows)
+			numParts = (mRows > 0) ? mRows : 1;
+
+		// a row's weight is its nonzeros plus one for the row itself
+		long total = NumNonzeros() + mRows;
+
+		mPartition.SetSize(numParts + 1);
+		mPartition[0] = 0;
+		long row = 0;
+		for (long p = 1; p < numParts; ++p) {
+			long target = (total * p) / numParts;
+			while ((row < mRows) && (mRowStart[row] + row < target))
+				++row;
+			mPartition[p] = row;
+		}
+		mPartition[numParts] = mRows;
+
+		return;
+	}
+}
+
+#endif // _sparsematrix_h_
@@ -0,0 +1,91 @@
+/*
+ * Copyright (C) 2004-2018 David Bernstein <david.h.bernstein@gmail.com>
+ *
+ * This file is part of utility_cpp.
+ *
+ * utility_cpp is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * utility_cpp is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with utility_cpp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _strassen_h_
+#define _strassen_h_
+
+#include "utility.h"
+#include "array.h"
+#include "realmatrix.h"
+#include "complexmatrix.h"
+
+namespace utility {
+	// products with any dimension at or below this go to Gemm
+	const long STRASSEN_CROSSOVER = 512;
+
+
+
+	// C = A B by the Winograd form of Strassen's algorithm, 7 half-size
+	// products and 15 block additions per level, recursing until a
+	// dimension reaches the crossover and calling Gemm there
+	// odd dimensions are peeled off and finished with Gemm, so any shape
+	// works, but only large and roughly square products gain anything
+	// the error is bounded normwise only, not elementwise as for Gemm: for
+	// n x n matrices with n = 2^l n0, n0 the leaf size, and u the unit
+	// roundoff (Higham, Accuracy and Stability of Numerical Algorithms, 2nd
+	// ed., chapter 23)
+	//     max|C - C'| <= [(n / n0)^log2(18) (n0^2 + 6 n0) - 6 n] u max|A| max|B|
+	// each level multiplies the bound by 18 where Gemm's n u bound doubles,
+	// so small elements of C lose relative accuracy first
+	// the workspace is kept between calls, Reserve sizes it in advance
+	class StrassenMultiplier {
+	public:
+		// Constructors
+		StrassenMultiplier(long crossover = STRASSEN_CROSSOVER);
+
+		// Destructor
+		~StrassenMultiplier(void) { };
+
+		// Sets and Gets
+		void SetCrossover(long crossover);
+		long Crossover(void) const;
+
+		// grows the workspace for an m x k times k x n product, complex
+		// products need twice the real workspace
+		void Reserve(long m, long n, long k, bool complex = false);
+
+		// c = a b, c may not be a or b
+		void Multiply(const Matrix<double> &a, const Matrix<double> &b, Matrix<double> &c);
+		void Multiply(const ComplexMatrix &a, const ComplexMatrix &b, ComplexMatrix &c);
+
+		// the same on raw row-major storage, C is m x n and not read
+		void Multiply(long m, long n, long k, const double *a, long lda, const double *b, long ldb,
+					  double *c, long ldc);
+		void Multiply(long m, long n, long k, const ComplexNumber *a, long lda, const ComplexNumber *b,
+					  long ldb, ComplexNumber *c, long ldc);
+
+	private:
+		long WorkspaceSize(long m, long n, long k) const;
+
+	private:
+		long mCrossover;
+
+		// in doubles, complex blocks are laid over it
+		Array<double> mWorkspace;
+	};
+
+
+
+	inline long StrassenMultiplier::Crossover() const
+	{
+		return mCrossover;
+	}
+}
+
+#endif // _strassen_h_
@@ -0,0 +1,119 @@
+/*
+ * Copyright (C) 2004-2018 David Bernstein <david.h.bernstein@gmail.com>
+ *
+ * This file is part of utility_cpp.
+ *
+ * utility_cpp is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * utility_cpp is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with utility_cpp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _symmetriceigensystem_h_
+#define _symmetriceigensystem_h_
+
+#include "utility.h"
+#include "realmatrix.h"
+
+namespace utility {
+	// eigenvalues and eigenvectors of a real symmetric matrix, A = Z L Z^T
+	// A is reduced to tridiagonal form T = Q^T A Q with Householder
+	// reflectors, then the whole spectrum comes from divide and conquer on T
+	// and Z = Q Z_T, or only the eigenvalues from QL iteration on T, or just
+	// the k smallest or largest pairs from bisection and inverse iteration on
+	// T, which skips the O(n^3) part after the reduction
+	// only the lower triangle of A is read
+	class SymmetricEigensystem {
+	public:
+		// Constructors
+		SymmetricEigensystem(void);
+		SymmetricEigensystem(const Matrix<double> &a, bool computeEigenvectors = true);
+
+		// Destructor
+		~SymmetricEigensystem(void) { };
+
+		// the full spectrum
+		void Compute(const Matrix<double> &a, bool computeEigenvectors = true);
+
+		// the k smallest eigenpairs, or the k largest if largest is true
+		void ComputeExtreme(const Matrix<double> &a, long k, bool largest, bool computeEigenvectors = true);
+
+		bool Computed(void) const;
+		bool HasEigenvectors(void) const;
+		long Size(void) const;
+		long NumEigenvalues(void) const;
+
+		// in increasing order, column i of Eigenvectors() belongs to
+		// eigenvalue i and has unit length
+		const Array<double>& Eigenvalues(void) const;
+		const Matrix<double>& Eigenvectors(void) const;
+
+	private:
+		void Reduce(const Matrix<double> &a);
+
+	private:
+		long mSize;
+		Array<double> mEigenvalues;
+		Matrix<double> mEigenvectors;
+
+		// the reduction, reflector vectors below the diagonal of mReduced and
+		// their scale factors in mTau, T has diagonal mDiagonal and
+		// off-diagonal mOffDiagonal
+		Matrix<double> mReduced;
+		Array<double> mTau;
+		Array<double> mDiagonal;
+		Array<double> mOffDiagonal;
+	};
+
+
+
+	inline bool SymmetricEigensystem::Computed() const
+	{
+		return mSize > 0;
+	}
+
+
+
+	inline bool SymmetricEigensystem::HasEigenvectors() const
+	{
+		return mEigenvectors.NumRows() > 0;
+	}
+
+
+
+	inline long SymmetricEigensystem::Size() const
+	{
+		return mSize;
+	}
+
+
+
+	inline long SymmetricEigensystem::NumEigenvalues() const
+	{
+		return mEigenvalues.Size();
+	}
+
+
+
+	inline const Array<double>& SymmetricEigensystem::Eigenvalues() const
+	{
+		return mEigenvalues;
+	}
+
+
+
+	inline const Matrix<double>& SymmetricEigensystem::Eigenvectors() const
+	{
+		return mEigenvectors;
+	}
+}
+
+#endif // _symmetriceigensystem_h_
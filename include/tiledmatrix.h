@@ -0,0 +1,230 @@
+/*
+ * Copyright (C) 2004-2018 David Bernstein <david.h.bernstein@gmail.com>
+ *
+ * This file is part of utility_cpp.
+ *
+ * utility_cpp is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * utility_cpp is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with utility_cpp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _tiledmatrix_h_
+#define _tiledmatrix_h_
+
+#include "utility.h"
+#include "realmatrix.h"
+
+#include <stddef.h>
+#include <string>
+
+namespace utility {
+	// default edge of the square tiles, a 1024 x 1024 tile is 8 MB
+	const long TILED_MATRIX_TILE_SIZE = 1024;
+
+	// bytes before the first tile, a page so the tiles are page aligned
+	const long TILED_MATRIX_HEADER_SIZE = 4096;
+
+
+
+	// a matrix of doubles kept in a file that is memory-mapped, for matrices
+	// too big for RAM
+	// the matrix is cut into square tiles, each stored contiguously and row
+	// major, and the tiles of a tile column follow each other in the file,
+	// so a tile column is itself a row-major block with stride TileSize()
+	// tiles on the right and bottom edges are padded with zeros to full size
+	// the operating system pages tiles in and out, PrefetchTile starts reading
+	// a tile in the background and ReleaseTile lets its pages go, which is
+	// how the tiled algorithms below keep their working set bounded
+	class TiledMatrix {
+	public:
+		// Constructors
+		TiledMatrix(void);
+
+		// Destructor
+		~TiledMatrix(void);
+
+		// creates (or truncates) fileName for a numRows x numColumns matrix
+		// of zeros
+		void Create(const std::string &fileName, long numRows, long numColumns,
+					long tileSize = TILED_MATRIX_TILE_SIZE);
+
+		// maps a file written by Create
+		void Open(const std::string &fileName);
+
+		// writes everything back and unmaps the file
+		void Close(void);
+		bool IsOpen(void) const;
+
+		long NumRows(void) const;
+		long NumColumns(void) const;
+		long TileSize(void) const;
+		long NumTileRows(void) const;
+		long NumTileColumns(void) const;
+
+		// rows of tile row I and columns of tile column J that are part of the
+		// matrix, less than TileSize() on the edges
+		long TileRows(long I) const;
+		long TileColumns(long J) const;
+
+		// tile (I, J), TileSize() x TileSize() with stride TileSize()
+		double* Tile(long I, long J);
+		const double* Tile(long I, long J) const;
+
+		// Accessors
+		double& operator()(long i, long j);
+		double operator()(long i, long j) const;
+
+		// residency hints, neither blocks or changes the contents
+		void PrefetchTile(long I, long J) const;
+		void ReleaseTile(long I, long J) const;
+
+		// writes modified tiles to the file
+		void Flush(void);
+
+		// for matrices that do fit in memory
+		void CopyFrom(const Matrix<double> &m);
+		void CopyTo(Matrix<double> &m) const;
+
+	private:
+		// not copyable, the mapping belongs to one object
+		TiledMatrix(const TiledMatrix &m);
+		TiledMatrix& operator=(const TiledMatrix &m);
+
+		void Map(const std::string &fileName, size_t size);
+		void Advise(long I, long J, int advice) const;
+
+	private:
+		int mFile;
+		char *mMap;
+		size_t mMapSize;
+
+		long mRows;
+		long mColumns;
+		long mTileSize;
+		long mTileRows;
+		long mTileColumns;
+	};
+
+
+
+	inline bool TiledMatrix::IsOpen() const
+	{
+		return mMap != NULL;
+	}
+
+
+
+	inline long TiledMatrix::NumRows() const
+	{
+		return mRows;
+	}
+
+
+
+	inline long TiledMatrix::NumColumns() const
+	{
+		return mColumns;
+	}
+
+
+
+	inline long TiledMatrix::TileSize() const
+	{
+		return mTileSize;
+	}
+
+
+
+	inline long TiledMatrix::NumTileRows() const
+	{
+		return mTileRows;
+	}
+
+
+
+	inline long TiledMatrix::NumTileColumns() const
+	{
+		return mTileColumns;
+	}
+
+
+
+	inline long TiledMatrix::TileRows(long I) const
+	{
+		long rows = mRows - I * mTileSize;
+		return (rows < mTileSize) ? rows : mTileSize;
+	}
+
+
+
+	inline long TiledMatrix::TileColumns(long J) const
+	{
+		long columns = mColumns - J * mTileSize;
+		return (columns < mTileSize) ? columns : mTileSize;
+	}
+
+
+
+	inline double* TiledMatrix::Tile(long I, long J)
+	{
+		return (double *) (mMap + TILED_MATRIX_HEADER_SIZE) + (J * mTileRows + I) * mTileSize * mTileSize;
+	}
+
+
+
+	inline const double* TiledMatrix::Tile(long I, long J) const
+	{
+		return (const double *) (mMap + TILED_MATRIX_HEADER_SIZE) + (J * mTileRows + I) * mTileSize * mTileSize;
+	}
+
+
+
+	inline double& TiledMatrix::operator()(long i, long j)
+	{
+		if ((i < 0) || (i >= mRows) || (j < 0) || (j >= mColumns))
+			ThrowException("TiledMatrix::operator() : index out of range");
+
+		return Tile(i / mTileSize, j / mTileSize)[(i % mTileSize) * mTileSize + j % mTileSize];
+	}
+
+
+
+	inline double TiledMatrix::operator()(long i, long j) const
+	{
+		if ((i < 0) || (i >= mRows) || (j < 0) || (j >= mColumns))
+			ThrowException("TiledMatrix::operator() : index out of range");
+
+		return Tile(i / mTileSize, j / mTileSize)[(i % mTileSize) * mTileSize + j % mTileSize];
+	}
+
+
+
+	// c = alpha a b + beta c one tile of c at a time, the next pair of tiles
+	// of a and b is prefetched while the current pair is multiplied
+	// all three need the same tile size
+	void TiledGemm(double alpha, const TiledMatrix &a, const TiledMatrix &b, double beta, TiledMatrix &c);
+
+	// right-looking LU with partial pivoting of the square matrix a in place,
+	// row i was interchanged with row pivot[i] at step i
+	// each tile column is factored as a whole so pivots are chosen from the
+	// full column, and the working set is that column plus the one being
+	// updated, the interchanges of later steps are not applied to the
+	// columns of L already written (that would touch every tile to the left
+	// at every step), TiledLUSolve accounts for it
+	// returns false if a is singular
+	bool TiledLUFactor(TiledMatrix &a, Array<long> &pivot);
+
+	// b = A^-1 b for the factors from TiledLUFactor, b is in memory
+	void TiledLUSolve(const TiledMatrix &lu, const Array<long> &pivot, Matrix<double> &b);
+}
+
+#endif // _tiledmatrix_h_
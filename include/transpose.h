@@ -0,0 +1,46 @@
+/*
+ * Copyright (C) 2004-2018 David Bernstein <david.h.bernstein@gmail.com>
+ *
+ * This file is part of utility_cpp.
+ *
+ * utility_cpp is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * utility_cpp is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with utility_cpp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _transpose_h_
+#define _transpose_h_
+
+#include "utility.h"
+#include "complexnumber.h"
+
+namespace utility {
+	// transposes on raw row-major storage
+	// B = A^T (or A^H) where A is m x n with row stride lda and B is n x m
+	// with row stride ldb, A and B must not overlap
+	void TransposeMatrix(long m, long n, const double *a, long lda, double *b, long ldb);
+	void TransposeMatrix(long m, long n, const float *a, long lda, float *b, long ldb);
+	void TransposeMatrix(long m, long n, const ComplexNumber *a, long lda, ComplexNumber *b, long ldb);
+	void AdjointMatrix(long m, long n, const ComplexNumber *a, long lda, ComplexNumber *b, long ldb);
+	
+	// in place on m x n storage with no padding (stride n), afterwards it
+	// holds the n x m transpose with stride m
+	// square matrices are done by swapping blocks, rectangular ones by
+	// following the cycles of the permutation, which needs only one bit of
+	// extra memory per element
+	void TransposeMatrixInPlace(long m, long n, double *a);
+	void TransposeMatrixInPlace(long m, long n, float *a);
+	void TransposeMatrixInPlace(long m, long n, ComplexNumber *a);
+	void AdjointMatrixInPlace(long m, long n, ComplexNumber *a);
+}
+
+#endif // _transpose_h_
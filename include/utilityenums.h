@@ -29,6 +29,20 @@ namespace utility {
 	
 	enum TimePrintMode{PRINT_SECONDS, PRINT_HOURS_MINUTES_SECONDS};
     
+    // ordered from least to most capable
+    enum SimdInstructionSet{SIMD_SCALAR, SIMD_SSE2, SIMD_AVX2, SIMD_AVX512};
+    
+    // how Matrix<double>::Multiply and ComplexMatrix::Multiply form a
+    // product, see strassen.h
+    enum MatrixMultiplyType{CLASSICAL_MULTIPLY, STRASSEN_MULTIPLY};
+    
+    // what a kernel applies to a matrix operand, A, A^T or A^H
+    enum MatrixOperation{NO_TRANSPOSE, TRANSPOSE, CONJUGATE_TRANSPOSE};
+    
+    // four real multiplies per complex one, or the faster but less accurate
+    // 3M product, see Gemm3M in gemm.h
+    enum ComplexMultiplyMethod{COMPLEX_MULTIPLY_4M, COMPLEX_MULTIPLY_3M};
+    
     enum UnitsType{NO_UNITS, DIMENSIONLESS,
     
                    // length 
@@ -0,0 +1,76 @@
+/*
+ * Copyright (C) 2004-2018 David Bernstein <david.h.bernstein@gmail.com>
+ *
+ * This file is part of utility_cpp.
+ *
+ * utility_cpp is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * utility_cpp is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with utility_cpp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _workspacepool_h_
+#define _workspacepool_h_
+
+#include <stddef.h>
+
+// Matrix<double> and ComplexMatrix take their storage from here and give it
+// back when they are resized or destroyed, so the temporaries of products,
+// adjoints, inverses and so on in a loop reuse the same few blocks instead
+// of going to the heap each iteration.
+// Freed blocks go on per-thread free lists, one list for each size class,
+// with four classes between consecutive powers of two, so a block is at
+// most 25% larger than asked for. A thread keeps at most
+// WorkspaceCacheLimit() bytes on its lists, beyond that freed blocks go
+// back to the heap. The lists need no locking, a block freed on another
+// thread than the one that allocated it simply joins that thread's lists.
+
+namespace utility {
+	// default limit on the bytes cached by each thread
+	const size_t WORKSPACE_CACHE_LIMIT = 256 * 1024 * 1024;
+
+
+
+	// counts for the calling thread since its first allocation or the last
+	// ResetWorkspaceStatistics
+	struct WorkspaceStatistics {
+		// allocations served from a free list and from the heap
+		long hits;
+		long misses;
+
+		// frees kept on a free list and given back to the heap
+		long releases;
+		long discards;
+
+		// on the free lists now
+		size_t cachedBytes;
+	};
+
+
+
+	// at least bytes bytes aligned for any type, never NULL
+	void* WorkspaceAllocate(size_t bytes);
+
+	// p must come from WorkspaceAllocate with the same bytes, NULL is ignored
+	void WorkspaceRelease(void *p, size_t bytes);
+
+	// the per-thread limit, set it before starting threads
+	void SetWorkspaceCacheLimit(size_t bytes);
+	size_t WorkspaceCacheLimit(void);
+
+	// gives every block on the calling thread's lists back to the heap
+	void TrimWorkspaceCache(void);
+
+	WorkspaceStatistics GetWorkspaceStatistics(void);
+	void ResetWorkspaceStatistics(void);
+}
+
+#endif // _workspacepool_h_
@@ -0,0 +1,346 @@
+/*
+ * Copyright (C) 2004-2018 David Bernstein <david.h.bernstein@gmail.com>
+ *
+ * This file is part of utility_cpp.
+ *
+ * utility_cpp is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * utility_cpp is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with utility_cpp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "choleskyfactorization.h"
+#include "gemm.h"
+#include "parallel.h"
+
+#include <math.h>
+
+using namespace utility;
+using namespace std;
+
+// Blocked right-looking Cholesky. Each step factors a CHOLESKY_BLOCK square
+// diagonal block, computes the block column below it one row at a time (the
+// rows are independent so they go to different threads), and subtracts
+// L21 L21^T from the lower triangle of the trailing matrix with GEMMs.
+
+namespace {
+	const long CHOLESKY_BLOCK = 128;
+
+	// columns of a right hand side block handled by one thread
+	const long CHOLESKY_COLUMN_CHUNK = 256;
+
+
+
+	inline long Min(long a, long b)
+	{
+		return (a < b) ? a : b;
+	}
+
+
+
+	// t = the transpose of the m x n block at a
+	void CopyTranspose(long m, long n, const double *a, long lda, double *t, long ldt)
+	{
+		for (long i = 0; i < m; ++i) {
+			for (long j = 0; j < n; ++j)
+				t[j * ldt + i] = a[i * lda + j];
+		}
+
+		return;
+	}
+
+
+
+	// unblocked Cholesky of the kb x kb diagonal block at row and column k,
+	// row by row, returns false if the block is not positive definite
+	bool FactorDiagonalBlock(long k, long kb, double *l, long ld)
+	{
+		for (long i = k; i < k + kb; ++i) {
+			double *rowI = l + i * ld;
+
+			for (long j = k; j <= i; ++j) {
+				const double *rowJ = l + j * ld;
+				double sum = rowI[j];
+				for (long p = k; p < j; ++p)
+					sum -= rowI[p] * rowJ[p];
+
+				if (i == j) {
+					if (sum <= 0.0)
+						return false;
+					rowI[i] = sqrt(sum);
+				}
+				else {
+					rowI[j] = sum / rowJ[j];
+				}
+			}
+		}
+
+		return true;
+	}
+
+
+
+	// x = L^-1 x for the rows i0 to i0 + ib - 1 of x, using the diagonal block
+	// of L there, the columns of x are split among the threads
+	void SolveLowerBlock(long i0, long ib, const double *l, long ld, long m, double *x, long ldx)
+	{
+		long numChunks = (m + CHOLESKY_COLUMN_CHUNK - 1) / CHOLESKY_COLUMN_CHUNK;
+
+		#pragma omp parallel for num_threads(NumThreads()) if (UseThreads((double) ib * ib * m))
+		for (long chunk = 0; chunk < numChunks; ++chunk) {
+			long j0 = chunk * CHOLESKY_COLUMN_CHUNK;
+			long jb = Min(CHOLESKY_COLUMN_CHUNK, m - j0);
+
+			for (long i = i0; i < i0 + ib; ++i) {
+				double *rowI = x + i * ldx + j0;
+				for (long p = i0; p < i; ++p) {
+					double lip = l[i * ld + p];
+					const double *rowP = x + p * ldx + j0;
+					for (long j = 0; j < jb; ++j)
+						rowI[j] -= lip * rowP[j];
+				}
+
+				double diagonalInverse = 1.0 / l[i * ld + i];
+				for (long j = 0; j < jb; ++j)
+					rowI[j] *= diagonalInverse;
+			}
+		}
+
+		return;
+	}
+
+
+
+	// x = L^-T x for the rows i0 to i0 + ib - 1 of x, using the diagonal
+	// block of L there
+	void SolveLowerTransposeBlock(long i0, long ib, const double *l, long ld, long m, double *x, long ldx)
+	{
+		long numChunks = (m + CHOLESKY_COLUMN_CHUNK - 1) / CHOLESKY_COLUMN_CHUNK;
+
+		#pragma omp parallel for num_threads(NumThreads()) if (UseThreads((double) ib * ib * m))
+		for (long chunk = 0; chunk < numChunks; ++chunk) {
+			long j0 = chunk * CHOLESKY_COLUMN_CHUNK;
+			long jb = Min(CHOLESKY_COLUMN_CHUNK, m - j0);
+
+			for (long i = i0 + ib - 1; i >= i0; --i) {
+				double *rowI = x + i * ldx + j0;
+				double diagonalInverse = 1.0 / l[i * ld + i];
+				for (long j = 0; j < jb; ++j)
+					rowI[j] *= diagonalInverse;
+
+				// row i of L is column i of L^T
+				for (long p = i0; p < i; ++p) {
+					double lip = l[i * ld + p];
+					double *rowP = x + p * ldx + j0;
+					for (long j = 0; j < jb; ++j)
+						rowP[j] -= lip * rowI[j];
+				}
+			}
+		}
+
+		return;
+	}
+}
+
+
+
+CholeskyFactorization::CholeskyFactorization()
+{
+	mPositiveDefinite = false;
+	return;
+}
+
+
+
+CholeskyFactorization::CholeskyFactorization(const Matrix<double> &a)
+{
+	mPositiveDefinite = false;
+	Factor(a);
+	return;
+}
+
+
+
+void CholeskyFactorization::Factor(const Matrix<double> &a)
+{
+	if (a.NumRows() != a.NumColumns())
+		ThrowException("CholeskyFactorization::Factor : matrix is not square");
+
+	long n = a.NumRows();
+
+	mL = a;
+	mPositiveDefinite = true;
+
+	double *l = mL.Data();
+	long ld = mL.Stride();
+
+	Array<double> transpose;
+
+	for (long k = 0; k < n; k += CHOLESKY_BLOCK) {
+		long kb = Min(CHOLESKY_BLOCK, n - k);
+		long trailing = n - k - kb;
+
+		if (!FactorDiagonalBlock(k, kb, l, ld)) {
+			mPositiveDefinite = false;
+			return;
+		}
+
+		if (trailing == 0)
+			continue;
+
+		// L21 = A21 L11^-T, each row is an independent triangular solve
+		const double *l11 = l + k * ld + k;
+		double *l21 = l + (k + kb) * ld + k;
+
+		#pragma omp parallel for num_threads(NumThreads()) if (UseThreads((double) trailing * kb * kb))
+		for (long i = 0; i < trailing; ++i) {
+			double *row = l21 + i * ld;
+			for (long j = 0; j < kb; ++j) {
+				double sum = row[j];
+				for (long p = 0; p < j; ++p)
+					sum -= row[p] * l11[j * ld + p];
+				row[j] = sum / l11[j * ld + j];
+			}
+		}
+
+		// A22 -= L21 L21^T on and below the diagonal, a block row at a time
+		// (the few elements of each diagonal block above the diagonal are
+		// updated as well, but that part of mL is never read)
+		transpose.SetSize(kb * trailing);
+		CopyTranspose(trailing, kb, l21, ld, transpose.Begin(), trailing);
+
+		double *a22 = l + (k + kb) * ld + k + kb;
+		for (long i0 = 0; i0 < trailing; i0 += CHOLESKY_BLOCK) {
+			long ib = Min(CHOLESKY_BLOCK, trailing - i0);
+			Gemm(ib, i0 + ib, kb, -1.0, l21 + i0 * ld, ld, transpose.Begin(), trailing,
+				 1.0, a22 + i0 * ld, ld);
+		}
+	}
+
+	return;
+}
+
+
+
+void CholeskyFactorization::Solve(Matrix<double> &b) const
+{
+	CheckSolvable();
+
+	long n = Size();
+	if (b.NumRows() != n)
+		ThrowException("CholeskyFactorization::Solve : right hand side has the wrong number of rows");
+
+	long m = b.NumColumns();
+	double *x = b.Data();
+	long ldx = b.Stride();
+	const double *l = mL.Data();
+	long ld = mL.Stride();
+
+	// L y = b a block row at a time
+	for (long i0 = 0; i0 < n; i0 += CHOLESKY_BLOCK) {
+		long ib = Min(CHOLESKY_BLOCK, n - i0);
+		if (i0 > 0)
+			Gemm(ib, m, i0, -1.0, l + i0 * ld, ld, x, ldx, 1.0, x + i0 * ldx, ldx);
+		SolveLowerBlock(i0, ib, l, ld, m, x, ldx);
+	}
+
+	// L^T x = y from the bottom, the coupling to the rows already solved
+	// is the transpose of a block column of L
+	Array<double> transpose;
+	long lastBlock = ((n - 1) / CHOLESKY_BLOCK) * CHOLESKY_BLOCK;
+	for (long i0 = lastBlock; i0 >= 0; i0 -= CHOLESKY_BLOCK) {
+		long ib = Min(CHOLESKY_BLOCK, n - i0);
+		long end = i0 + ib;
+		if (end < n) {
+			transpose.SetSize(ib * (n - end));
+			CopyTranspose(n - end, ib, l + end * ld + i0, ld, transpose.Begin(), n - end);
+			Gemm(ib, m, n - end, -1.0, transpose.Begin(), n - end, x + end * ldx, ldx, 1.0, x + i0 * ldx, ldx);
+		}
+		SolveLowerTransposeBlock(i0, ib, l, ld, m, x, ldx);
+	}
+
+	return;
+}
+
+
+
+void CholeskyFactorization::Solve(const Matrix<double> &b, Matrix<double> &x) const
+{
+	x = b;
+	Solve(x);
+	return;
+}
+
+
+
+double CholeskyFactorization::LogDeterminant() const
+{
+	CheckSolvable();
+
+	double logDet = 0.0;
+	for (long i = 0; i < Size(); ++i)
+		logDet += log(mL(i, i));
+
+	return 2.0 * logDet;
+}
+
+
+
+double CholeskyFactorization::Determinant() const
+{
+	return exp(LogDeterminant());
+}
+
+
+
+void CholeskyFactorization::Inverse(Matrix<double> &inv) const
+{
+	CheckSolvable();
+
+	long n = Size();
+	inv.SetSize(n, n);
+	inv.MakeZero();
+	for (long i = 0; i < n; ++i)
+		inv(i, i) = 1.0;
+
+	Solve(inv);
+
+	return;
+}
+
+
+
+void CholeskyFactorization::GetL(Matrix<double> &l) const
+{
+	CheckSolvable();
+
+	long n = Size();
+	l.SetSize(n, n);
+	for (long i = 0; i < n; ++i) {
+		for (long j = 0; j < n; ++j)
+			l(i, j) = (j <= i) ? mL(i, j) : 0.0;
+	}
+
+	return;
+}
+
+
+
+void CholeskyFactorization::CheckSolvable() const
+{
+	if (!Factored())
+		ThrowException("CholeskyFactorization : no matrix has been factored");
+
+	if (!mPositiveDefinite)
+		ThrowException("CholeskyFactorization : matrix is not positive definite");
+
+	return;
+}
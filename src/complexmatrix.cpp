@@ -21,17 +21,63 @@
 #include <math.h>
 
 #include "complexmatrix.h"
+#include "gemm.h"
+#include "simd.h"
+#include "transpose.h"
+#include "matrixexponential.h"
+#include "strassen.h"
+#include "parallel.h"
 
 
 using namespace std;
 using namespace utility;
 
+// The reductions below run straight over the storage, which is one
+// contiguous block since the stride is the number of columns, a chunk at a
+// time so that large matrices can be split across threads.
+
+namespace {
+    // complex numbers per chunk of a reduction
+    const long REDUCTION_CHUNK = 4096;
+    
+    // edge of the blocks of B transposed by TraceOfProduct, 16 KB of stack
+    const long TRACE_BLOCK = 32;
+    
+    
+    
+    inline long Min(long a, long b)
+    {
+        return (a < b) ? a : b;
+    }
+    
+    
+    
+    // kernel(2n, x, y) summed over chunks, for VectorDot and
+    // VectorDistanceSquared on n interleaved complex numbers
+    double ChunkedSum(long n, double (*kernel)(long, const double*, const double*),
+                      const ComplexNumber *x, const ComplexNumber *y)
+    {
+        long numChunks = (n + REDUCTION_CHUNK - 1) / REDUCTION_CHUNK;
+        
+        double sum = 0.0;
+        #pragma omp parallel for reduction(+:sum) num_threads(NumThreads()) if (UseThreads(4.0 * n))
+        for (long c = 0; c < numChunks; ++c) {
+            long start = c * REDUCTION_CHUNK;
+            sum += kernel(2 * Min(REDUCTION_CHUNK, n - start), reinterpret_cast<const double*>(x + start),
+                          reinterpret_cast<const double*>(y + start));
+        }
+        
+        return sum;
+    }
+}
+
+
+
 ComplexMatrix& ComplexMatrix::operator*=(ComplexNumber a)
 {
 	for (long i = 0; i < mRows; ++i) {
-		for (long j = 0; j < mColumns; ++j) {
-			mpData[i][j] *= a;
-		}
+		double *row = reinterpret_cast<double*>(mpData + i * mStride);
+		VectorComplexScale(mColumns, a.RealPart(), a.ImaginaryPart(), row);
 	}
 	
 	return *this;
@@ -47,11 +93,11 @@ ComplexMatrix& ComplexMatrix::operator+=(const ComplexMatrix &m)
 	if (mColumns != m.mColumns)
 		ThrowException("ComplexMatrix::operator+= : unequal number of columns");
     
+	// a complex row is just twice as many doubles as far as adding goes
 	for (long i = 0; i < mRows; ++i) {
-		for (long j = 0; j < mColumns; ++j) {
-			mpData[i][j] += m.mpData[i][j];
-		}
-	}	
+		const double *mRow = reinterpret_cast<const double*>(m.mpData + i * m.mStride);
+		VectorAdd(2 * mColumns, mRow, reinterpret_cast<double*>(mpData + i * mStride));
+	}
 	
 	return *this;
 }
@@ -64,55 +110,93 @@ ComplexMatrix ComplexMatrix::operator*(const ComplexMatrix &m) const
     
     ComplexMatrix p(mRows, m.mColumns);
     
-    for (short i = 0; i < p.mRows; ++i) {
-        for (short j = 0; j < p.mColumns; ++j) {
-            p(i, j).Set(0.0, 0.0);
-            for (short k = 0; k < mColumns; ++k)
-                p(i, j) += (*this)(i, k) * m(k, j);
-        }
-        
-    }
+    Gemm(mRows, m.mColumns, mColumns, ComplexNumber(1.0, 0.0), mpData, mStride, 
+         m.mpData, m.mStride, ComplexNumber(0.0, 0.0), p.mpData, p.mStride);
     
     return p;
 }
 
 
 
+ComplexMatrix ComplexMatrix::Multiply(const ComplexMatrix &m, MatrixMultiplyType type) const
+{
+    if (type == CLASSICAL_MULTIPLY)
+        return (*this) * m;
+    
+    StrassenMultiplier strassen;
+    ComplexMatrix p;
+    strassen.Multiply(*this, m, p);
+    
+    return p;
+}
+
+
+
+void ComplexMatrix::MakeZero()
+{
+    for (long i = 0; i < mRows; ++i) 
+        VectorZero(2 * mColumns, reinterpret_cast<double*>(mpData + i * mStride));
+    
+    return;
+}
+
+
+
 ComplexMatrix ComplexMatrix::Transpose() const
 {
     ComplexMatrix result(mColumns, mRows);
-    for (short i = 0; i < mRows; ++i) {
-        for (short j = 0; j < mColumns; ++j) {
-            result(j, i) = mpData[i][j];
-        }
-        
-    }
+    TransposeMatrix(mRows, mColumns, mpData, mStride, result.mpData, result.mStride);
     
     return result;
 }
 
 
 
-ComplexMatrix ComplexMatrix::Conjugate() const
+ComplexMatrix ComplexMatrix::Adjoint() const
 {
-    ComplexMatrix result(mRows, mColumns);
-    for (short i = 0; i < mRows; ++i) {
-        for (short j = 0; j < mColumns; ++j) {
-            result(i, j) = mpData[i][j].Conjugate();
-        }
-        
-    }
+    // conjugated on the way through rather than in a second pass
+    ComplexMatrix result(mColumns, mRows);
+    AdjointMatrix(mRows, mColumns, mpData, mStride, result.mpData, result.mStride);
     
     return result;
 }
 
 
 
-ComplexMatrix ComplexMatrix::Adjoint() const
+void ComplexMatrix::TransposeInPlace()
 {
-    ComplexMatrix result(mRows, mColumns);
-    result = this->Transpose();
-    result = result.Conjugate();
+    TransposeMatrixInPlace(mRows, mColumns, mpData);
+    
+    long tmp = mRows;
+    mRows = mColumns;
+    mColumns = tmp;
+    mStride = mColumns;
+    
+    return;
+}
+
+
+
+void ComplexMatrix::AdjointInPlace()
+{
+    AdjointMatrixInPlace(mRows, mColumns, mpData);
+    
+    long tmp = mRows;
+    mRows = mColumns;
+    mColumns = tmp;
+    mStride = mColumns;
+    
+    return;
+}
+
+
+
+ComplexMatrix ComplexMatrix::Exponential() const
+{
+    MatrixExponential<ComplexMatrix> exponential;
+    ComplexMatrix result;
+    exponential.Compute(*this, result);
+    
     return result;
 }
 
@@ -120,9 +204,27 @@ ComplexMatrix ComplexMatrix::Adjoint() const
 
 ComplexNumber ComplexMatrix::InnerProduct(const ComplexMatrix &m) const
 {
-    ComplexMatrix tmp;
-    tmp = (this->Adjoint()) * m;
-    return tmp.Trace();
+    // tr(A^H B) is the sum of conj(a) b over the elements
+    if (mRows != m.mRows or mColumns != m.mColumns) {
+        ThrowException("ComplexMatrix::InnerProduct : matrices are different dimensions");
+    }
+    
+    long n = mRows * mColumns;
+    long numChunks = (n + REDUCTION_CHUNK - 1) / REDUCTION_CHUNK;
+    
+    double re = 0.0;
+    double im = 0.0;
+    #pragma omp parallel for reduction(+:re, im) num_threads(NumThreads()) if (UseThreads(8.0 * n))
+    for (long c = 0; c < numChunks; ++c) {
+        long start = c * REDUCTION_CHUNK;
+        double dot[2];
+        VectorComplexDot(Min(REDUCTION_CHUNK, n - start), reinterpret_cast<const double*>(mpData + start),
+                         reinterpret_cast<const double*>(m.mpData + start), dot);
+        re += dot[0];
+        im += dot[1];
+    }
+    
+    return ComplexNumber(re, im);
 }
 
 
@@ -134,14 +236,18 @@ ComplexMatrix ComplexMatrix::TensorProduct(const ComplexMatrix &a) const
     long n = a.NumRows();
     long nPrime = a.NumColumns();
     
-    for (long j = 0; j < b.NumRows(); ++j) {
-        for (long k = 0; k < b.NumColumns(); ++k) {
-            long x1 = j / n;
-            long x2 = k / nPrime;
-            long x3 = j % n;
-            long x4 = k % nPrime;
+    // row x1 * n + x3 of b is row x1 of this times row x3 of a, block by
+    // block, see KroneckerOperator to apply products without forming them
+    for (long x1 = 0; x1 < mRows; ++x1) {
+        for (long x3 = 0; x3 < n; ++x3) {
+            const ComplexNumber *aRow = a.mpData + x3 * a.mStride;
+            ComplexNumber *bRow = b.mpData + (x1 * n + x3) * b.mStride;
             
-            b(j, k) = (*this)(x1, x2) * a(x3, x4);
+            for (long x2 = 0; x2 < mColumns; ++x2) {
+                ComplexNumber s = mpData[x1 * mStride + x2];
+                for (long x4 = 0; x4 < nPrime; ++x4)
+                    bRow[x2 * nPrime + x4] = s * aRow[x4];
+            }
         }
     }
     
@@ -158,7 +264,7 @@ ComplexNumber ComplexMatrix::Trace(void) const
     
     ComplexNumber trace;
     for (long i = 0; i < mRows; ++i) {
-        trace += mpData[i][i];
+        trace += mpData[i * mStride + i];
     }
     
     return trace;
@@ -166,10 +272,53 @@ ComplexNumber ComplexMatrix::Trace(void) const
 
 
 
+ComplexNumber ComplexMatrix::TraceOfProduct(const ComplexMatrix &m) const
+{
+    if (mColumns != m.mRows or mRows != m.mColumns) {
+        ThrowException("ComplexMatrix::TraceOfProduct : matrices are wrong size");
+    }
+    
+    // tr(A B) is the sum of A(i, j) B(j, i), so each row of A meets a column
+    // of B, which is read a block at a time into rows of bt
+    long numBlocks = (mRows + TRACE_BLOCK - 1) / TRACE_BLOCK;
+    
+    double re = 0.0;
+    double im = 0.0;
+    #pragma omp parallel for reduction(+:re, im) num_threads(NumThreads()) if (UseThreads(8.0 * mRows * mColumns))
+    for (long block = 0; block < numBlocks; ++block) {
+        double bt[2 * TRACE_BLOCK * TRACE_BLOCK];
+        long ib = block * TRACE_BLOCK;
+        long ni = Min(TRACE_BLOCK, mRows - ib);
+        
+        for (long jb = 0; jb < mColumns; jb += TRACE_BLOCK) {
+            long nj = Min(TRACE_BLOCK, mColumns - jb);
+            
+            for (long j = 0; j < nj; ++j) {
+                const double *bRow = reinterpret_cast<const double*>(m.mpData + (jb + j) * m.mStride + ib);
+                for (long i = 0; i < ni; ++i) {
+                    bt[2 * (i * TRACE_BLOCK + j)] = bRow[2 * i];
+                    bt[2 * (i * TRACE_BLOCK + j) + 1] = bRow[2 * i + 1];
+                }
+            }
+            
+            for (long i = 0; i < ni; ++i) {
+                double dot[2];
+                VectorComplexDotUnconjugated(nj, reinterpret_cast<const double*>(mpData + (ib + i) * mStride + jb),
+                                             bt + 2 * i * TRACE_BLOCK, dot);
+                re += dot[0];
+                im += dot[1];
+            }
+        }
+    }
+    
+    return ComplexNumber(re, im);
+}
+
+
+
 double ComplexMatrix::Norm(void) const
 {
-    ComplexNumber tmp = this->InnerProduct(*this);
-    return sqrt(tmp.RealPart());
+    return sqrt(ChunkedSum(mRows * mColumns, VectorDot, mpData, mpData));
 }
 
 
@@ -181,8 +330,7 @@ double ComplexMatrix::Distance(const ComplexMatrix &m) const
         ThrowException("ComplexMatrix::Distance: matrices are different dimensions");
     }
     
-    ComplexMatrix tmp = *this - m;
-    return tmp.Norm();
+    return sqrt(ChunkedSum(mRows * mColumns, VectorDistanceSquared, mpData, m.mpData));
 }
 
 
@@ -200,7 +348,7 @@ void ComplexMatrix::Print(void) const
 void ComplexMatrix::PrintRow(long i) const
 {
     for (long j = 0; j < mColumns; ++j) {
-        mpData[i][j].Print();
+        mpData[i * mStride + j].Print();
         cout << "  ";
     }
     cout << "\n";
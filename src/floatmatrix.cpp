@@ -0,0 +1,180 @@
+/*
+ * Copyright (C) 2004-2018 David Bernstein <david.h.bernstein@gmail.com>
+ *
+ * This file is part of utility_cpp.
+ *
+ * utility_cpp is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * utility_cpp is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with utility_cpp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "floatmatrix.h"
+#include "randomnumbergenerator.h"
+#include "gemm.h"
+#include "simd.h"
+#include "lufactorization.h"
+#include "transpose.h"
+
+#include <iostream>
+
+using namespace utility;
+using namespace std;
+
+// The single precision counterpart of realmatrix.cpp. Products and the LU
+// behind Inverse and Determinant go through the float GEMM, whose kernels
+// work on twice as many elements per instruction as the double ones.
+
+Matrix<float>& Matrix<float>::operator*=(float a)
+{
+	for (long i = 0; i < mRows; ++i) 
+		VectorScale(mColumns, a, mpData + i * mStride);
+	
+	return *this;
+}
+
+
+
+Matrix<float>& Matrix<float>::operator+=(const Matrix<float> &m)
+{
+	if (mRows != m.mRows)
+		ThrowException("Matrix<float>::operator+= : unequal number of rows");
+	
+	if (mColumns != m.mColumns)
+		ThrowException("Matrix<float>::operator+= : unequal number of columns");
+		
+	for (long i = 0; i < mRows; ++i) 
+		VectorAdd(mColumns, m.mpData + i * m.mStride, mpData + i * mStride);
+	
+	return *this;
+}
+
+
+
+void Matrix<float>::Inverse(Matrix<float> &inv) const
+{
+    if (mRows != mColumns)
+        ThrowException("Matrix<float>::Inverse : matrix is not square");
+    
+    Matrix<float> lu(*this);
+    Array<long> pivot;
+    double sign;
+    if (!FactorLU(lu, pivot, sign))
+        ThrowException("Matrix<float>::Inverse : matrix is singular");
+    
+    inv.SetSize(mRows, mRows);
+    inv.MakeZero();
+    for (long i = 0; i < mRows; ++i)
+        inv.mpData[i * inv.mStride + i] = 1.0f;
+    
+    SolveLU(lu, pivot, inv);
+    
+    return;
+}
+
+
+
+// the product of the pivots is accumulated in double, it leaves the range
+// of a float long before that of a double
+double Matrix<float>::Determinant() const
+{
+    if (mRows != mColumns)
+        ThrowException("Matrix<float>::Determinant : matrix is not square");
+    
+    Matrix<float> lu(*this);
+    Array<long> pivot;
+    double d;
+    if (!FactorLU(lu, pivot, d))
+        return 0.0;
+    
+    for (long i = 0; i < mRows; ++i)
+        d *= lu.mpData[i * lu.mStride + i];
+    
+    return d;
+}
+
+
+
+Matrix<float> Matrix<float>::operator*(const Matrix<float> &m) const
+{
+    if (mColumns != m.mRows)
+        ThrowException("Matrix<float>::operator* : matrices are wrong size");
+        
+    Matrix<float> p(mRows, m.mColumns);
+
+    Gemm(mRows, m.mColumns, mColumns, 1.0f, mpData, mStride, m.mpData, m.mStride, 0.0f, p.mpData, p.mStride);
+    
+    return p;
+}
+
+
+
+Matrix<float> Matrix<float>::Transpose() const
+{
+    Matrix<float> result(mColumns, mRows);
+    TransposeMatrix(mRows, mColumns, mpData, mStride, result.mpData, result.mStride);
+    
+    return result;
+}
+
+
+
+void Matrix<float>::TransposeInPlace()
+{
+    TransposeMatrixInPlace(mRows, mColumns, mpData);
+    
+    long tmp = mRows;
+    mRows = mColumns;
+    mColumns = tmp;
+    mStride = mColumns;
+    
+    return;
+}
+
+
+
+void Matrix<float>::MakeZero()
+{
+    for (long i = 0; i < mRows; ++i) 
+        VectorZero(mColumns, mpData + i * mStride);
+    
+    return;
+}
+
+
+
+void Matrix<float>::MakeRandom(long seed)
+{
+    RandomNumberGenerator rng;
+    rng.Reset(seed);
+    
+    for (long i = 0; i < mRows; ++i) {
+        for (long j = 0; j < mColumns; ++j) {
+            mpData[i * mStride + j] = (float) rng.Random01();
+        }
+    }
+    
+    return;
+}
+
+
+
+void Matrix<float>::Print() const
+{
+    for (long i = 0; i < mRows; ++i) {
+        for (long j = 0; j < mColumns; ++j) {
+            cout << mpData[i * mStride + j] << " ";
+        }
+        cout << endl;
+    }
+    
+    return;
+}
@@ -0,0 +1,723 @@
+/*
+ * Copyright (C) 2004-2018 David Bernstein <david.h.bernstein@gmail.com>
+ *
+ * This file is part of utility_cpp.
+ *
+ * utility_cpp is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * utility_cpp is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with utility_cpp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "gemm.h"
+#include "parallel.h"
+#include "simd.h"
+#include "workspacepool.h"
+
+using namespace utility;
+using namespace std;
+
+// The multiply follows the usual Goto/BLIS layering. B is copied a KC x NC
+// block at a time into NR wide column panels (sized to live in L3), A is
+// copied an MC x KC block at a time into MR tall row panels (sized to live
+// in L2), and the micro-kernel keeps an MR x NR block of C in registers while
+// it streams one panel of each through L1. The register block MR x NR and
+// the micro-kernel come from simd.h and depend on the instruction set and
+// the precision, the rest is shared by double and float. A transposed
+// operand only changes the strides the packing routines read it with, and
+// the packing buffers come from the workspace pool, so a product in a loop
+// does not allocate.
+
+namespace {
+	// cache blocks, MC and NC must be multiples of every MR and NR in simd.cpp
+	const long GEMM_MC = 96;
+	const long GEMM_KC = 256;
+	const long GEMM_NC = 4096;
+
+	// below this many multiply-adds packing costs more than it saves
+	const long GEMM_SMALL_SIZE = 32 * 32 * 32;
+
+
+
+	inline long Min(long a, long b)
+	{
+		return (a < b) ? a : b;
+	}
+
+
+
+	// copies the mc x kc block of A starting at a into MR tall panels, each
+	// stored column by column, zero padding the last panel
+	// element (i, p) of the block is a[i * rsA + p * csA]
+	template<class T>
+	void PackA(long mc, long kc, const T *a, long rsA, long csA, long MR, T *buffer)
+	{
+		for (long ir = 0; ir < mc; ir += MR) {
+			long mr = Min(MR, mc - ir);
+			const T *panel = a + ir * rsA;
+
+			for (long p = 0; p < kc; ++p) {
+				for (long i = 0; i < mr; ++i)
+					buffer[i] = panel[i * rsA + p * csA];
+				for (long i = mr; i < MR; ++i)
+					buffer[i] = 0.0;
+				buffer += MR;
+			}
+		}
+
+		return;
+	}
+
+
+
+	// copies the kc x nr panel of B starting at b into buffer row by row,
+	// zero padding it out to NR columns
+	// element (p, j) of the panel is b[p * rsB + j * csB]
+	template<class T>
+	void PackBPanel(long kc, long nr, const T *b, long rsB, long csB, long NR, T *buffer)
+	{
+		for (long p = 0; p < kc; ++p) {
+			const T *row = b + p * rsB;
+			if (csB == 1) {
+				for (long j = 0; j < nr; ++j)
+					buffer[j] = row[j];
+			}
+			else {
+				for (long j = 0; j < nr; ++j)
+					buffer[j] = row[j * csB];
+			}
+			for (long j = nr; j < NR; ++j)
+				buffer[j] = 0.0;
+			buffer += NR;
+		}
+
+		return;
+	}
+
+
+
+	// C = alpha * ab + beta * C on the mr x nr corner of an MR x NR block
+	template<class T>
+	void UpdateC(long mr, long nr, long NR, T alpha, const T *ab, T beta, T *c, long ldc)
+	{
+		if (beta == 0.0) {
+			for (long i = 0; i < mr; ++i) {
+				for (long j = 0; j < nr; ++j)
+					c[i * ldc + j] = alpha * ab[i * NR + j];
+			}
+		}
+		else {
+			for (long i = 0; i < mr; ++i) {
+				for (long j = 0; j < nr; ++j)
+					c[i * ldc + j] = alpha * ab[i * NR + j] + beta * c[i * ldc + j];
+			}
+		}
+
+		return;
+	}
+
+
+
+	// K is GemmMicroKernel or GemmMicroKernelFloat to match T
+	template<class T, class K>
+	void MacroKernel(const K &kernel, long mc, long nc, long kc, T alpha,
+					 const T *packedA, const T *packedB, T beta, T *c, long ldc)
+	{
+		T ab[GEMM_MAX_MR * GEMM_MAX_NR];
+
+		for (long jr = 0; jr < nc; jr += kernel.nr) {
+			long nr = Min(kernel.nr, nc - jr);
+			const T *b = packedB + jr * kc;
+
+			for (long ir = 0; ir < mc; ir += kernel.mr) {
+				long mr = Min(kernel.mr, mc - ir);
+				const T *a = packedA + ir * kc;
+
+				kernel.function(kc, a, b, ab);
+				UpdateC(mr, nr, kernel.nr, alpha, ab, beta, c + ir * ldc + jr, ldc);
+			}
+		}
+
+		return;
+	}
+
+
+
+	// C = beta * C, used when there is nothing to multiply
+	template<class T>
+	void ScaleC(long m, long n, T beta, T *c, long ldc)
+	{
+		for (long i = 0; i < m; ++i) {
+			for (long j = 0; j < n; ++j)
+				c[i * ldc + j] = (beta == 0.0) ? 0.0 : beta * c[i * ldc + j];
+		}
+
+		return;
+	}
+
+
+
+	// straightforward i-p-j loop for products too small to be worth packing,
+	// element (i, p) of op(A) is a[i * rsA + p * csA] and likewise for B
+	template<class T>
+	void SmallGemm(long m, long n, long k, T alpha, const T *a, long rsA, long csA,
+				   const T *b, long rsB, long csB, T beta, T *c, long ldc)
+	{
+		ScaleC(m, n, beta, c, ldc);
+
+		for (long i = 0; i < m; ++i) {
+			T *cRow = c + i * ldc;
+			for (long p = 0; p < k; ++p) {
+				T aip = alpha * a[i * rsA + p * csA];
+				const T *bRow = b + p * rsB;
+				if (csB == 1) {
+					for (long j = 0; j < n; ++j)
+						cRow[j] += aip * bRow[j];
+				}
+				else {
+					for (long j = 0; j < n; ++j)
+						cRow[j] += aip * bRow[j * csB];
+				}
+			}
+		}
+
+		return;
+	}
+
+
+
+	// for real matrices CONJUGATE_TRANSPOSE is the same as TRANSPOSE
+	template<class T, class K>
+	void BlockedGemm(const K &kernel, MatrixOperation opA, MatrixOperation opB, long m, long n, long k,
+					 T alpha, const T *a, long lda, const T *b, long ldb, T beta, T *c, long ldc)
+	{
+		if ((m < 0) || (n < 0) || (k < 0))
+			ThrowException("Gemm : negative size");
+
+		if ((m == 0) || (n == 0))
+			return;
+
+		if ((k == 0) || (alpha == 0.0)) {
+			ScaleC(m, n, beta, c, ldc);
+			return;
+		}
+
+		// strides of op(A) and op(B) in the stored matrices
+		long rsA = (opA == NO_TRANSPOSE) ? lda : 1;
+		long csA = (opA == NO_TRANSPOSE) ? 1 : lda;
+		long rsB = (opB == NO_TRANSPOSE) ? ldb : 1;
+		long csB = (opB == NO_TRANSPOSE) ? 1 : ldb;
+
+		if (m * n * k <= GEMM_SMALL_SIZE) {
+			SmallGemm(m, n, k, alpha, a, rsA, csA, b, rsB, csB, beta, c, ldc);
+			return;
+		}
+
+		long MR = kernel.mr;
+		long NR = kernel.nr;
+
+		// the threads share the packed block of B and each packs its own
+		// blocks of A, so the rows of C are what gets divided up
+		long numThreads = UseThreads((double) m * n * k) ? NumThreads() : 1;
+
+		// with several threads shrink MC if need be so every thread gets rows
+		long mcBlock = GEMM_MC;
+		if (numThreads > 1) {
+			long rowsPerThread = (m + numThreads - 1) / numThreads;
+			rowsPerThread = MR * ((rowsPerThread + MR - 1) / MR);
+			mcBlock = Min(GEMM_MC, rowsPerThread);
+		}
+		long numRowBlocks = (m + mcBlock - 1) / mcBlock;
+
+		long kcMax = Min(GEMM_KC, k);
+		long ncMax = Min(GEMM_NC, n) + NR;
+		long packedBSize = kcMax * ncMax * sizeof(T);
+		T *packedB = static_cast<T*>(WorkspaceAllocate(packedBSize));
+
+		#pragma omp parallel num_threads(numThreads) if (numThreads > 1)
+		{
+			long packedASize = (mcBlock + MR) * kcMax * sizeof(T);
+			T *packedA = static_cast<T*>(WorkspaceAllocate(packedASize));
+
+			for (long jc = 0; jc < n; jc += GEMM_NC) {
+				long nc = Min(GEMM_NC, n - jc);
+				long numPanels = (nc + NR - 1) / NR;
+
+				for (long pc = 0; pc < k; pc += GEMM_KC) {
+					long kc = Min(GEMM_KC, k - pc);
+
+					// only the first pass over k applies the caller's beta
+					T betaBlock = (pc == 0) ? beta : 1.0;
+
+					#pragma omp for
+					for (long panel = 0; panel < numPanels; ++panel) {
+						long jr = panel * NR;
+						PackBPanel(kc, Min(NR, nc - jr), b + pc * rsB + (jc + jr) * csB, rsB, csB, NR,
+								   packedB + jr * kc);
+					}
+
+					#pragma omp for schedule(dynamic)
+					for (long block = 0; block < numRowBlocks; ++block) {
+						long ic = block * mcBlock;
+						long mc = Min(mcBlock, m - ic);
+
+						PackA(mc, kc, a + ic * rsA + pc * csA, rsA, csA, MR, packedA);
+						MacroKernel(kernel, mc, nc, kc, alpha, packedA, packedB, betaBlock, c + ic * ldc + jc, ldc);
+					}
+				}
+			}
+
+			WorkspaceRelease(packedA, packedASize);
+		}
+
+		WorkspaceRelease(packedB, packedBSize);
+
+		return;
+	}
+}
+
+
+
+namespace utility {
+void Gemm(long m, long n, long k, double alpha, const double *a, long lda,
+		  const double *b, long ldb, double beta, double *c, long ldc)
+{
+	BlockedGemm(CurrentGemmMicroKernel(), NO_TRANSPOSE, NO_TRANSPOSE, m, n, k, alpha, a, lda, b, ldb, beta, c, ldc);
+	return;
+}
+
+
+
+void Gemm(MatrixOperation opA, MatrixOperation opB, long m, long n, long k, double alpha, const double *a, long lda,
+		  const double *b, long ldb, double beta, double *c, long ldc)
+{
+	BlockedGemm(CurrentGemmMicroKernel(), opA, opB, m, n, k, alpha, a, lda, b, ldb, beta, c, ldc);
+	return;
+}
+
+
+
+void Gemm(long m, long n, long k, float alpha, const float *a, long lda,
+		  const float *b, long ldb, float beta, float *c, long ldc)
+{
+	BlockedGemm(CurrentGemmMicroKernelFloat(), NO_TRANSPOSE, NO_TRANSPOSE, m, n, k, alpha, a, lda, b, ldb, beta,
+				c, ldc);
+	return;
+}
+
+
+
+void Gemm(MatrixOperation opA, MatrixOperation opB, long m, long n, long k, float alpha, const float *a, long lda,
+		  const float *b, long ldb, float beta, float *c, long ldc)
+{
+	BlockedGemm(CurrentGemmMicroKernelFloat(), opA, opB, m, n, k, alpha, a, lda, b, ldb, beta, c, ldc);
+	return;
+}
+}
+
+
+
+// The complex multiply works directly on the interleaved storage. C is
+// divided into blocks of rows across the threads and B is walked in
+// KC x NB blocks so the rows of B being reused stay in cache. When op(B) is
+// B^T or B^H its rows are columns of B, so each block is first copied out
+// (and conjugated) into a row-major buffer, while the elements of op(A) are
+// read one at a time anyway and are just fetched from wherever they are.
+// The 3M product instead splits the operands into real and imaginary planes
+// and hands three real products to the blocked multiply above.
+
+namespace {
+	const long ZGEMM_KC = 128;
+	const long ZGEMM_NB = 512;
+	
+	// below this many multiply-adds splitting the operands costs more than
+	// the 3M product saves
+	const double GEMM_3M_MIN_SIZE = 64.0 * 64.0 * 64.0;
+	
+	// see SetComplexMultiplyMethod
+	ComplexMultiplyMethod complexMultiplyMethodSetting = COMPLEX_MULTIPLY_4M;
+	
+	
+	
+	// c += a * b over n interleaved complex numbers, a = ar + i ai
+	inline void ComplexAxpy(long n, double ar, double ai, const double *b, double *c)
+	{
+		for (long j = 0; j < n; ++j) {
+			double br = b[2 * j];
+			double bi = b[2 * j + 1];
+			c[2 * j] += ar * br - ai * bi;
+			c[2 * j + 1] += ar * bi + ai * br;
+		}
+		
+		return;
+	}
+	
+	
+	
+	// row = beta * row over n interleaved complex numbers
+	inline void ComplexScale(long n, double betaR, double betaI, double *row)
+	{
+		if ((betaR == 1.0) && (betaI == 0.0))
+			return;
+		
+		for (long j = 0; j < n; ++j) {
+			double re = row[2 * j];
+			double im = row[2 * j + 1];
+			if ((betaR == 0.0) && (betaI == 0.0)) {
+				row[2 * j] = 0.0;
+				row[2 * j + 1] = 0.0;
+			}
+			else {
+				row[2 * j] = betaR * re - betaI * im;
+				row[2 * j + 1] = betaR * im + betaI * re;
+			}
+		}
+		
+		return;
+	}
+	
+	
+	
+	// row = the nb elements of row p of op(B) from column jb, for op(B) = B^T
+	// or B^H, so read down column p of B
+	void PackComplexBRow(double sign, long nb, long p, long jb, const double *b, long ldb, double *row)
+	{
+		for (long j = 0; j < nb; ++j) {
+			const double *bjp = b + 2 * ((jb + j) * ldb + p);
+			row[2 * j] = bjp[0];
+			row[2 * j + 1] = sign * bjp[1];
+		}
+		
+		return;
+	}
+	
+	
+	
+	void ComplexGemm(MatrixOperation opA, MatrixOperation opB, long m, long n, long k, const ComplexNumber &alpha,
+					 const ComplexNumber *a, long lda, const ComplexNumber *b, long ldb, const ComplexNumber &beta,
+					 ComplexNumber *c, long ldc)
+	{
+		if ((m < 0) || (n < 0) || (k < 0))
+			ThrowException("Gemm : negative size");
+		
+		if ((m == 0) || (n == 0))
+			return;
+		
+		// ComplexNumber is two doubles, real part first
+		const double *aD = reinterpret_cast<const double*>(a);
+		const double *bD = reinterpret_cast<const double*>(b);
+		double *cD = reinterpret_cast<double*>(c);
+		
+		double alphaR = alpha.RealPart();
+		double alphaI = alpha.ImaginaryPart();
+		
+		// a complex multiply-add is four real ones
+		#pragma omp parallel for num_threads(NumThreads()) if (UseThreads(4.0 * m * n * k))
+		for (long i = 0; i < m; ++i)
+			ComplexScale(n, beta.RealPart(), beta.ImaginaryPart(), cD + 2 * i * ldc);
+		
+		if ((alphaR == 0.0) && (alphaI == 0.0))
+			return;
+		
+		// element (i, p) of op(A) is at aD + 2 * (i * rsA + p * csA), with
+		// its imaginary part times signA
+		long rsA = (opA == NO_TRANSPOSE) ? lda : 1;
+		long csA = (opA == NO_TRANSPOSE) ? 1 : lda;
+		double signA = (opA == CONJUGATE_TRANSPOSE) ? -1.0 : 1.0;
+		double signB = (opB == CONJUGATE_TRANSPOSE) ? -1.0 : 1.0;
+		
+		double *packedB = NULL;
+		long packedBSize = 2 * Min(ZGEMM_KC, k) * Min(ZGEMM_NB, n) * sizeof(double);
+		if (opB != NO_TRANSPOSE)
+			packedB = static_cast<double*>(WorkspaceAllocate(packedBSize));
+		
+		for (long jb = 0; jb < n; jb += ZGEMM_NB) {
+			long nb = Min(ZGEMM_NB, n - jb);
+			
+			for (long pb = 0; pb < k; pb += ZGEMM_KC) {
+				long kb = Min(ZGEMM_KC, k - pb);
+				
+				// row p of the block of op(B) is at bBlock + 2 * p * ldBlock
+				const double *bBlock = bD + 2 * (pb * ldb + jb);
+				long ldBlock = ldb;
+				if (opB != NO_TRANSPOSE) {
+					#pragma omp parallel for num_threads(NumThreads()) if (UseThreads(4.0 * m * n * k))
+					for (long p = 0; p < kb; ++p)
+						PackComplexBRow(signB, nb, pb + p, jb, bD, ldb, packedB + 2 * p * nb);
+					
+					bBlock = packedB;
+					ldBlock = nb;
+				}
+				
+				#pragma omp parallel for schedule(static) num_threads(NumThreads()) if (UseThreads(4.0 * m * n * k))
+				for (long i = 0; i < m; ++i) {
+					double *cRow = cD + 2 * (i * ldc + jb);
+					
+					for (long p = 0; p < kb; ++p) {
+						// fold alpha into the element of A
+						const double *aip = aD + 2 * (i * rsA + (pb + p) * csA);
+						double re = aip[0];
+						double im = signA * aip[1];
+						double ar = alphaR * re - alphaI * im;
+						double ai = alphaR * im + alphaI * re;
+						ComplexAxpy(nb, ar, ai, bBlock + 2 * p * ldBlock, cRow);
+					}
+				}
+			}
+		}
+		
+		if (packedB != NULL)
+			WorkspaceRelease(packedB, packedBSize);
+		
+		return;
+	}
+	
+	
+	
+	// row i of the planes re, im and sum = re + im of a complex matrix, from
+	// its row a of n complex numbers with the imaginary parts times sign
+	void SplitComplexRow(long n, const double *a, double sign, double *re, double *im, double *sum)
+	{
+		for (long j = 0; j < n; ++j) {
+			double x = a[2 * j];
+			double y = sign * a[2 * j + 1];
+			re[j] = x;
+			im[j] = y;
+			sum[j] = x + y;
+		}
+		
+		return;
+	}
+	
+	
+	
+	// one row of n elements of c = alpha * (t1 - t2 + i (t3 - t1 - t2)) + beta * c,
+	// c is not read when beta is zero
+	void Combine3MRow(long n, const ComplexNumber &alpha, const double *t1, const double *t2, const double *t3,
+					  const ComplexNumber &beta, double *c)
+	{
+		double alphaR = alpha.RealPart();
+		double alphaI = alpha.ImaginaryPart();
+		double betaR = beta.RealPart();
+		double betaI = beta.ImaginaryPart();
+		bool readC = (betaR != 0.0) || (betaI != 0.0);
+		
+		for (long j = 0; j < n; ++j) {
+			double re = t1[j] - t2[j];
+			double im = t3[j] - t1[j] - t2[j];
+			double cr = alphaR * re - alphaI * im;
+			double ci = alphaR * im + alphaI * re;
+			if (readC) {
+				cr += betaR * c[2 * j] - betaI * c[2 * j + 1];
+				ci += betaR * c[2 * j + 1] + betaI * c[2 * j];
+			}
+			c[2 * j] = cr;
+			c[2 * j + 1] = ci;
+		}
+		
+		return;
+	}
+	
+	
+	
+	// the 3M product, op(A) op(B) = T1 - T2 + i (T3 - T1 - T2) with the
+	// real products T1 = Ar Br, T2 = Ai Bi and T3 = (Ar + Ai)(Br + Bi)
+	// the operands are split into planes in their stored shape, so the
+	// transposes are left to the real GEMM and only conjugation is applied
+	// while splitting
+	void ComplexGemm3M(MatrixOperation opA, MatrixOperation opB, long m, long n, long k, const ComplexNumber &alpha,
+					   const ComplexNumber *a, long lda, const ComplexNumber *b, long ldb, const ComplexNumber &beta,
+					   ComplexNumber *c, long ldc)
+	{
+		if ((m < 0) || (n < 0) || (k < 0))
+			ThrowException("Gemm3M : negative size");
+		
+		if ((m == 0) || (n == 0))
+			return;
+		
+		// nothing to split, only C to scale
+		if ((k == 0) || ((alpha.RealPart() == 0.0) && (alpha.ImaginaryPart() == 0.0))) {
+			ComplexGemm(opA, opB, m, n, k, alpha, a, lda, b, ldb, beta, c, ldc);
+			return;
+		}
+		
+		long aRows = (opA == NO_TRANSPOSE) ? m : k;
+		long aColumns = (opA == NO_TRANSPOSE) ? k : m;
+		long bRows = (opB == NO_TRANSPOSE) ? k : n;
+		long bColumns = (opB == NO_TRANSPOSE) ? n : k;
+		MatrixOperation realOpA = (opA == NO_TRANSPOSE) ? NO_TRANSPOSE : TRANSPOSE;
+		MatrixOperation realOpB = (opB == NO_TRANSPOSE) ? NO_TRANSPOSE : TRANSPOSE;
+		double signA = (opA == CONJUGATE_TRANSPOSE) ? -1.0 : 1.0;
+		double signB = (opB == CONJUGATE_TRANSPOSE) ? -1.0 : 1.0;
+		const double *aD = reinterpret_cast<const double*>(a);
+		const double *bD = reinterpret_cast<const double*>(b);
+		double *cD = reinterpret_cast<double*>(c);
+		
+		// three planes each of A, B and the products in one block
+		long size = 3 * (m * k + k * n + m * n) * sizeof(double);
+		double *workspace = static_cast<double*>(WorkspaceAllocate(size));
+		double *aRe = workspace;
+		double *aIm = aRe + m * k;
+		double *aSum = aIm + m * k;
+		double *bRe = aSum + m * k;
+		double *bIm = bRe + k * n;
+		double *bSum = bIm + k * n;
+		double *t1 = bSum + k * n;
+		double *t2 = t1 + m * n;
+		double *t3 = t2 + m * n;
+		
+		// the planes have stride the number of columns
+		#pragma omp parallel for num_threads(NumThreads()) if (UseThreads(3.0 * m * n * k))
+		for (long i = 0; i < aRows; ++i) {
+			long offset = i * aColumns;
+			SplitComplexRow(aColumns, aD + 2 * i * lda, signA, aRe + offset, aIm + offset, aSum + offset);
+		}
+		
+		#pragma omp parallel for num_threads(NumThreads()) if (UseThreads(3.0 * m * n * k))
+		for (long i = 0; i < bRows; ++i) {
+			long offset = i * bColumns;
+			SplitComplexRow(bColumns, bD + 2 * i * ldb, signB, bRe + offset, bIm + offset, bSum + offset);
+		}
+		
+		Gemm(realOpA, realOpB, m, n, k, 1.0, aRe, aColumns, bRe, bColumns, 0.0, t1, n);
+		Gemm(realOpA, realOpB, m, n, k, 1.0, aIm, aColumns, bIm, bColumns, 0.0, t2, n);
+		Gemm(realOpA, realOpB, m, n, k, 1.0, aSum, aColumns, bSum, bColumns, 0.0, t3, n);
+		
+		#pragma omp parallel for num_threads(NumThreads()) if (UseThreads(3.0 * m * n * k))
+		for (long i = 0; i < m; ++i)
+			Combine3MRow(n, alpha, t1 + i * n, t2 + i * n, t3 + i * n, beta, cD + 2 * i * ldc);
+		
+		WorkspaceRelease(workspace, size);
+		
+		return;
+	}
+	
+	
+	
+	// the complex Gemm entry points go through here
+	void DispatchComplexGemm(MatrixOperation opA, MatrixOperation opB, long m, long n, long k,
+							 const ComplexNumber &alpha, const ComplexNumber *a, long lda, const ComplexNumber *b,
+							 long ldb, const ComplexNumber &beta, ComplexNumber *c, long ldc)
+	{
+		if ((complexMultiplyMethodSetting == COMPLEX_MULTIPLY_3M) &&
+			(static_cast<double>(m) * n * k >= GEMM_3M_MIN_SIZE))
+			ComplexGemm3M(opA, opB, m, n, k, alpha, a, lda, b, ldb, beta, c, ldc);
+		else
+			ComplexGemm(opA, opB, m, n, k, alpha, a, lda, b, ldb, beta, c, ldc);
+		
+		return;
+	}
+	
+	
+	
+	// the sizes m x k of op(A) and k x n of op(B), checked against each other
+	void CheckOperands(MatrixOperation opA, MatrixOperation opB, long aRows, long aColumns, long bRows,
+					   long bColumns, long &m, long &n, long &k)
+	{
+		m = (opA == NO_TRANSPOSE) ? aRows : aColumns;
+		k = (opA == NO_TRANSPOSE) ? aColumns : aRows;
+		long kB = (opB == NO_TRANSPOSE) ? bRows : bColumns;
+		n = (opB == NO_TRANSPOSE) ? bColumns : bRows;
+		
+		if (k != kB)
+			ThrowException("Gemm : matrices are wrong size");
+		
+		return;
+	}
+}
+
+
+
+namespace utility {
+void Gemm(long m, long n, long k, const ComplexNumber &alpha, const ComplexNumber *a, long lda,
+		  const ComplexNumber *b, long ldb, const ComplexNumber &beta, ComplexNumber *c, long ldc)
+{
+	DispatchComplexGemm(NO_TRANSPOSE, NO_TRANSPOSE, m, n, k, alpha, a, lda, b, ldb, beta, c, ldc);
+	return;
+}
+
+
+
+void Gemm(MatrixOperation opA, MatrixOperation opB, long m, long n, long k, const ComplexNumber &alpha,
+		  const ComplexNumber *a, long lda, const ComplexNumber *b, long ldb, const ComplexNumber &beta,
+		  ComplexNumber *c, long ldc)
+{
+	DispatchComplexGemm(opA, opB, m, n, k, alpha, a, lda, b, ldb, beta, c, ldc);
+	return;
+}
+
+
+
+void Gemm3M(MatrixOperation opA, MatrixOperation opB, long m, long n, long k, const ComplexNumber &alpha,
+			const ComplexNumber *a, long lda, const ComplexNumber *b, long ldb, const ComplexNumber &beta,
+			ComplexNumber *c, long ldc)
+{
+	ComplexGemm3M(opA, opB, m, n, k, alpha, a, lda, b, ldb, beta, c, ldc);
+	return;
+}
+
+
+
+void SetComplexMultiplyMethod(ComplexMultiplyMethod method)
+{
+	complexMultiplyMethodSetting = method;
+	return;
+}
+
+
+
+ComplexMultiplyMethod CurrentComplexMultiplyMethod()
+{
+	return complexMultiplyMethodSetting;
+}
+
+
+
+void Gemm(MatrixOperation opA, MatrixOperation opB, double alpha, const Matrix<double> &a,
+		  const Matrix<double> &b, double beta, Matrix<double> &c)
+{
+	if ((&c == &a) || (&c == &b))
+		ThrowException("Gemm : C overwrites A or B");
+	
+	long m, n, k;
+	CheckOperands(opA, opB, a.NumRows(), a.NumColumns(), b.NumRows(), b.NumColumns(), m, n, k);
+	
+	if (beta == 0.0)
+		c.SetSize(m, n);
+	else if ((c.NumRows() != m) || (c.NumColumns() != n))
+		ThrowException("Gemm : C is the wrong size");
+	
+	Gemm(opA, opB, m, n, k, alpha, a.Data(), a.Stride(), b.Data(), b.Stride(), beta, c.Data(), c.Stride());
+	
+	return;
+}
+
+
+
+void Gemm(MatrixOperation opA, MatrixOperation opB, const ComplexNumber &alpha, const ComplexMatrix &a,
+		  const ComplexMatrix &b, const ComplexNumber &beta, ComplexMatrix &c)
+{
+	if ((&c == &a) || (&c == &b))
+		ThrowException("Gemm : C overwrites A or B");
+	
+	long m, n, k;
+	CheckOperands(opA, opB, a.NumRows(), a.NumColumns(), b.NumRows(), b.NumColumns(), m, n, k);
+	
+	if ((beta.RealPart() == 0.0) && (beta.ImaginaryPart() == 0.0))
+		c.SetSize(m, n);
+	else if ((c.NumRows() != m) || (c.NumColumns() != n))
+		ThrowException("Gemm : C is the wrong size");
+	
+	Gemm(opA, opB, m, n, k, alpha, a.Data(), a.Stride(), b.Data(), b.Stride(), beta, c.Data(), c.Stride());
+	
+	return;
+}
+}
@@ -0,0 +1,414 @@
+/*
+ * Copyright (C) 2004-2018 David Bernstein <david.h.bernstein@gmail.com>
+ *
+ * This file is part of utility_cpp.
+ *
+ * utility_cpp is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * utility_cpp is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with utility_cpp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "gemv.h"
+#include "parallel.h"
+
+using namespace utility;
+using namespace std;
+
+// A matrix-vector product reads every element of A once, so it runs at the
+// speed A comes in from memory and the kernels are about reading A in
+// order with as little else as possible. With A row major, A x is a dot
+// product per row, done four rows at a time so every element of x that is
+// loaded is used four times. A^T x adds a multiple of each row of A into y,
+// four rows at a time so y is loaded and stored once per four rows; y is
+// cut into blocks that stay in L1, and the blocks are what the threads
+// share out. The complex kernels work on the interleaved storage.
+
+namespace {
+	// elements of y per block for the transposed products
+	const long GEMV_BLOCK = 1024;
+
+
+
+	template<class T>
+	inline void Store(T alpha, T sum, T beta, T *y)
+	{
+		if (beta == 0.0)
+			*y = alpha * sum;
+		else
+			*y = alpha * sum + beta * (*y);
+
+		return;
+	}
+
+
+
+	// y = alpha A x + beta y
+	template<class T>
+	void GemvNoTranspose(long m, long n, T alpha, const T *a, long lda, const T *x, T beta, T *y)
+	{
+		long numBlocks = (m + 3) / 4;
+
+		#pragma omp parallel for num_threads(NumThreads()) if (UseThreads((double) m * n))
+		for (long block = 0; block < numBlocks; ++block) {
+			long i = 4 * block;
+			if (i + 4 <= m) {
+				const T *a0 = a + i * lda;
+				const T *a1 = a0 + lda;
+				const T *a2 = a1 + lda;
+				const T *a3 = a2 + lda;
+				T s0 = 0.0;
+				T s1 = 0.0;
+				T s2 = 0.0;
+				T s3 = 0.0;
+				for (long j = 0; j < n; ++j) {
+					T xj = x[j];
+					s0 += a0[j] * xj;
+					s1 += a1[j] * xj;
+					s2 += a2[j] * xj;
+					s3 += a3[j] * xj;
+				}
+
+				Store(alpha, s0, beta, y + i);
+				Store(alpha, s1, beta, y + i + 1);
+				Store(alpha, s2, beta, y + i + 2);
+				Store(alpha, s3, beta, y + i + 3);
+			}
+			else {
+				for (; i < m; ++i) {
+					const T *a0 = a + i * lda;
+					T s0 = 0.0;
+					for (long j = 0; j < n; ++j)
+						s0 += a0[j] * x[j];
+					Store(alpha, s0, beta, y + i);
+				}
+			}
+		}
+
+		return;
+	}
+
+
+
+	// the block size that gives every thread some of y
+	long BlockSize(long n, long numThreads)
+	{
+		long size = (n + numThreads - 1) / numThreads;
+		size = 8 * ((size + 7) / 8);
+		if (size > GEMV_BLOCK)
+			size = GEMV_BLOCK;
+
+		return size;
+	}
+
+
+
+	// y = alpha A^T x + beta y
+	template<class T>
+	void GemvTranspose(long m, long n, T alpha, const T *a, long lda, const T *x, T beta, T *y)
+	{
+		long numThreads = UseThreads((double) m * n) ? NumThreads() : 1;
+		long blockSize = BlockSize(n, numThreads);
+		long numBlocks = (n + blockSize - 1) / blockSize;
+
+		#pragma omp parallel for num_threads(numThreads) if (numThreads > 1)
+		for (long block = 0; block < numBlocks; ++block) {
+			long j0 = block * blockSize;
+			long nb = (n - j0 < blockSize) ? n - j0 : blockSize;
+			T *yb = y + j0;
+
+			if (beta == 0.0) {
+				for (long j = 0; j < nb; ++j)
+					yb[j] = 0.0;
+			}
+			else if (beta != 1.0) {
+				for (long j = 0; j < nb; ++j)
+					yb[j] *= beta;
+			}
+
+			long i = 0;
+			for (; i + 4 <= m; i += 4) {
+				const T *a0 = a + i * lda + j0;
+				const T *a1 = a0 + lda;
+				const T *a2 = a1 + lda;
+				const T *a3 = a2 + lda;
+				T c0 = alpha * x[i];
+				T c1 = alpha * x[i + 1];
+				T c2 = alpha * x[i + 2];
+				T c3 = alpha * x[i + 3];
+				for (long j = 0; j < nb; ++j)
+					yb[j] += c0 * a0[j] + c1 * a1[j] + c2 * a2[j] + c3 * a3[j];
+			}
+
+			for (; i < m; ++i) {
+				const T *a0 = a + i * lda + j0;
+				T c0 = alpha * x[i];
+				for (long j = 0; j < nb; ++j)
+					yb[j] += c0 * a0[j];
+			}
+		}
+
+		return;
+	}
+
+
+
+	// y = alpha * (sr + i si) + beta * y for one complex y
+	inline void ComplexStore(double alphaR, double alphaI, double sr, double si, double betaR, double betaI,
+							 double *y)
+	{
+		double re = alphaR * sr - alphaI * si;
+		double im = alphaR * si + alphaI * sr;
+		if ((betaR != 0.0) || (betaI != 0.0)) {
+			re += betaR * y[0] - betaI * y[1];
+			im += betaR * y[1] + betaI * y[0];
+		}
+
+		y[0] = re;
+		y[1] = im;
+
+		return;
+	}
+
+
+
+	// y = alpha A x + beta y on interleaved complex numbers, two rows at a
+	// time, which already keeps four sums going
+	void ComplexGemvNoTranspose(long m, long n, double alphaR, double alphaI, const double *a, long lda,
+								const double *x, double betaR, double betaI, double *y)
+	{
+		long numBlocks = (m + 1) / 2;
+
+		#pragma omp parallel for num_threads(NumThreads()) if (UseThreads(4.0 * m * n))
+		for (long block = 0; block < numBlocks; ++block) {
+			long i = 2 * block;
+			const double *a0 = a + 2 * i * lda;
+			if (i + 2 <= m) {
+				const double *a1 = a0 + 2 * lda;
+				double r0 = 0.0;
+				double i0 = 0.0;
+				double r1 = 0.0;
+				double i1 = 0.0;
+				for (long j = 0; j < n; ++j) {
+					double xr = x[2 * j];
+					double xi = x[2 * j + 1];
+					r0 += a0[2 * j] * xr - a0[2 * j + 1] * xi;
+					i0 += a0[2 * j] * xi + a0[2 * j + 1] * xr;
+					r1 += a1[2 * j] * xr - a1[2 * j + 1] * xi;
+					i1 += a1[2 * j] * xi + a1[2 * j + 1] * xr;
+				}
+
+				ComplexStore(alphaR, alphaI, r0, i0, betaR, betaI, y + 2 * i);
+				ComplexStore(alphaR, alphaI, r1, i1, betaR, betaI, y + 2 * i + 2);
+			}
+			else {
+				double r0 = 0.0;
+				double i0 = 0.0;
+				for (long j = 0; j < n; ++j) {
+					double xr = x[2 * j];
+					double xi = x[2 * j + 1];
+					r0 += a0[2 * j] * xr - a0[2 * j + 1] * xi;
+					i0 += a0[2 * j] * xi + a0[2 * j + 1] * xr;
+				}
+
+				ComplexStore(alphaR, alphaI, r0, i0, betaR, betaI, y + 2 * i);
+			}
+		}
+
+		return;
+	}
+
+
+
+	// y = alpha A^T x + beta y, or alpha A^H x + beta y if conjugate is true
+	void ComplexGemvTranspose(bool conjugate, long m, long n, double alphaR, double alphaI, const double *a,
+							  long lda, const double *x, double betaR, double betaI, double *y)
+	{
+		// the imaginary part of every element of A is multiplied by this
+		double sign = conjugate ? -1.0 : 1.0;
+
+		long numThreads = UseThreads(4.0 * m * n) ? NumThreads() : 1;
+		long blockSize = BlockSize(n, numThreads);
+		long numBlocks = (n + blockSize - 1) / blockSize;
+
+		#pragma omp parallel for num_threads(numThreads) if (numThreads > 1)
+		for (long block = 0; block < numBlocks; ++block) {
+			long j0 = block * blockSize;
+			long nb = (n - j0 < blockSize) ? n - j0 : blockSize;
+			double *yb = y + 2 * j0;
+
+			for (long j = 0; j < nb; ++j) {
+				double re = yb[2 * j];
+				double im = yb[2 * j + 1];
+				if ((betaR == 0.0) && (betaI == 0.0)) {
+					yb[2 * j] = 0.0;
+					yb[2 * j + 1] = 0.0;
+				}
+				else {
+					yb[2 * j] = betaR * re - betaI * im;
+					yb[2 * j + 1] = betaR * im + betaI * re;
+				}
+			}
+
+			long i = 0;
+			for (; i + 2 <= m; i += 2) {
+				const double *a0 = a + 2 * (i * lda + j0);
+				const double *a1 = a0 + 2 * lda;
+
+				// c = alpha x_i, with the conjugation sign folded into the
+				// imaginary parts of A
+				double c0r = alphaR * x[2 * i] - alphaI * x[2 * i + 1];
+				double c0i = alphaR * x[2 * i + 1] + alphaI * x[2 * i];
+				double c1r = alphaR * x[2 * i + 2] - alphaI * x[2 * i + 3];
+				double c1i = alphaR * x[2 * i + 3] + alphaI * x[2 * i + 2];
+				for (long j = 0; j < nb; ++j) {
+					double a0r = a0[2 * j];
+					double a0i = sign * a0[2 * j + 1];
+					double a1r = a1[2 * j];
+					double a1i = sign * a1[2 * j + 1];
+					yb[2 * j] += c0r * a0r - c0i * a0i + c1r * a1r - c1i * a1i;
+					yb[2 * j + 1] += c0r * a0i + c0i * a0r + c1r * a1i + c1i * a1r;
+				}
+			}
+
+			for (; i < m; ++i) {
+				const double *a0 = a + 2 * (i * lda + j0);
+				double c0r = alphaR * x[2 * i] - alphaI * x[2 * i + 1];
+				double c0i = alphaR * x[2 * i + 1] + alphaI * x[2 * i];
+				for (long j = 0; j < nb; ++j) {
+					double a0r = a0[2 * j];
+					double a0i = sign * a0[2 * j + 1];
+					yb[2 * j] += c0r * a0r - c0i * a0i;
+					yb[2 * j + 1] += c0r * a0i + c0i * a0r;
+				}
+			}
+		}
+
+		return;
+	}
+
+
+
+	// the lengths of x and y for op(A) with A m x n
+	void CheckSizes(MatrixOperation op, long m, long n, long xSize, long &ySize, bool readsY)
+	{
+		long columns = (op == NO_TRANSPOSE) ? n : m;
+		long rows = (op == NO_TRANSPOSE) ? m : n;
+
+		if (xSize != columns)
+			ThrowException("Gemv : x has the wrong size");
+
+		if (readsY && (ySize != rows))
+			ThrowException("Gemv : y has the wrong size");
+
+		ySize = rows;
+		return;
+	}
+}
+
+
+
+namespace utility {
+void Gemv(MatrixOperation op, long m, long n, double alpha, const double *a, long lda,
+		  const double *x, double beta, double *y)
+{
+	if (op == NO_TRANSPOSE)
+		GemvNoTranspose(m, n, alpha, a, lda, x, beta, y);
+	else
+		GemvTranspose(m, n, alpha, a, lda, x, beta, y);
+
+	return;
+}
+
+
+
+void Gemv(MatrixOperation op, long m, long n, float alpha, const float *a, long lda,
+		  const float *x, float beta, float *y)
+{
+	if (op == NO_TRANSPOSE)
+		GemvNoTranspose(m, n, alpha, a, lda, x, beta, y);
+	else
+		GemvTranspose(m, n, alpha, a, lda, x, beta, y);
+
+	return;
+}
+
+
+
+void Gemv(MatrixOperation op, long m, long n, const ComplexNumber &alpha, const ComplexNumber *a, long lda,
+		  const ComplexNumber *x, const ComplexNumber &beta, ComplexNumber *y)
+{
+	const double *ad = reinterpret_cast<const double*>(a);
+	const double *xd = reinterpret_cast<const double*>(x);
+	double *yd = reinterpret_cast<double*>(y);
+
+	if (op == NO_TRANSPOSE)
+		ComplexGemvNoTranspose(m, n, alpha.RealPart(), alpha.ImaginaryPart(), ad, lda, xd,
+							   beta.RealPart(), beta.ImaginaryPart(), yd);
+	else
+		ComplexGemvTranspose(op == CONJUGATE_TRANSPOSE, m, n, alpha.RealPart(), alpha.ImaginaryPart(), ad, lda, xd,
+							 beta.RealPart(), beta.ImaginaryPart(), yd);
+
+	return;
+}
+
+
+
+void Gemv(MatrixOperation op, double alpha, const Matrix<double> &a, const DenseVector<double> &x,
+		  double beta, DenseVector<double> &y)
+{
+	if (&x == &y)
+		ThrowException("Gemv : y overwrites x");
+
+	long ySize = y.Size();
+	CheckSizes(op, a.NumRows(), a.NumColumns(), x.Size(), ySize, beta != 0.0);
+	y.SetSize(ySize);
+
+	Gemv(op, a.NumRows(), a.NumColumns(), alpha, a.Data(), a.Stride(), x.Data(), beta, y.Data());
+
+	return;
+}
+
+
+
+void Gemv(MatrixOperation op, float alpha, const Matrix<float> &a, const DenseVector<float> &x,
+		  float beta, DenseVector<float> &y)
+{
+	if (&x == &y)
+		ThrowException("Gemv : y overwrites x");
+
+	long ySize = y.Size();
+	CheckSizes(op, a.NumRows(), a.NumColumns(), x.Size(), ySize, beta != 0.0f);
+	y.SetSize(ySize);
+
+	Gemv(op, a.NumRows(), a.NumColumns(), alpha, a.Data(), a.Stride(), x.Data(), beta, y.Data());
+
+	return;
+}
+
+
+
+void Gemv(MatrixOperation op, const ComplexNumber &alpha, const ComplexMatrix &a,
+		  const DenseVector<ComplexNumber> &x, const ComplexNumber &beta, DenseVector<ComplexNumber> &y)
+{
+	if (&x == &y)
+		ThrowException("Gemv : y overwrites x");
+
+	long ySize = y.Size();
+	bool readsY = (beta.RealPart() != 0.0) || (beta.ImaginaryPart() != 0.0);
+	CheckSizes(op, a.NumRows(), a.NumColumns(), x.Size(), ySize, readsY);
+	y.SetSize(ySize);
+
+	Gemv(op, a.NumRows(), a.NumColumns(), alpha, a.Data(), a.Stride(), x.Data(), beta, y.Data());
+
+	return;
+}
+}
@@ -0,0 +1,232 @@
+/*
+ * Copyright (C) 2004-2018 David Bernstein <david.h.bernstein@gmail.com>
+ *
+ * This file is part of utility_cpp.
+ *
+ * utility_cpp is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * utility_cpp is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with utility_cpp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "kroneckeroperator.h"
+#include "gemm.h"
+#include "parallel.h"
+#include "workspacepool.h"
+
+using namespace utility;
+using namespace std;
+
+// With factors A_1 ... A_n, A_f p_f x q_f, the input is a tensor with
+// indices (j_1, ..., j_n, c), j_f < q_f, where c runs over the columns of X
+// (just one for a vector), stored row major. Contracting factor f takes the
+// tensor
+//     (i_1 .. i_{f-1}) x j_f x (j_{f+1} .. j_n c) = left x q_f x right
+// to left x p_f x right, which is left separate products of A_f with a
+// q_f x right block. When right is 1 the blocks are the rows of a
+// left x q_f matrix and the whole stage is one product with A_f^T instead.
+// When the blocks are small, as for the middle factors of a chain of 2 x 2
+// factors, the call and packing overhead of a GEMM per block is far more
+// than the arithmetic, and the stage is contracted directly instead.
+
+namespace {
+	// stages whose blocks need fewer complex multiply-adds than this skip
+	// Gemm
+	const long KRONECKER_DIRECT_SIZE = 4096;
+
+
+
+	// out = A in for a p x q factor A and a q x right block, all row major
+	// with in and out contiguous
+	void ContractBlock(long p, long q, long right, const ComplexNumber *a, long lda, const ComplexNumber *in,
+					   ComplexNumber *out)
+	{
+		const double *ad = reinterpret_cast<const double*>(a);
+		const double *x = reinterpret_cast<const double*>(in);
+		double *y = reinterpret_cast<double*>(out);
+
+		for (long i = 0; i < p; ++i) {
+			double *yRow = y + 2 * i * right;
+			const double *aRow = ad + 2 * i * lda;
+
+			double ar = aRow[0];
+			double ai = aRow[1];
+			for (long r = 0; r < right; ++r) {
+				yRow[2 * r] = ar * x[2 * r] - ai * x[2 * r + 1];
+				yRow[2 * r + 1] = ar * x[2 * r + 1] + ai * x[2 * r];
+			}
+
+			for (long j = 1; j < q; ++j) {
+				const double *xRow = x + 2 * j * right;
+				ar = aRow[2 * j];
+				ai = aRow[2 * j + 1];
+				for (long r = 0; r < right; ++r) {
+					yRow[2 * r] += ar * xRow[2 * r] - ai * xRow[2 * r + 1];
+					yRow[2 * r + 1] += ar * xRow[2 * r + 1] + ai * xRow[2 * r];
+				}
+			}
+		}
+
+		return;
+	}
+}
+
+KroneckerOperator::KroneckerOperator()
+{
+	mRows = 0;
+	mColumns = 0;
+
+	return;
+}
+
+
+
+void KroneckerOperator::AddFactor(const ComplexMatrix &m)
+{
+	if ((m.NumRows() == 0) || (m.NumColumns() == 0))
+		ThrowException("KroneckerOperator::AddFactor : empty factor");
+
+	if (mFactors.empty()) {
+		mRows = 1;
+		mColumns = 1;
+	}
+
+	mFactors.push_back(m);
+	mRows *= m.NumRows();
+	mColumns *= m.NumColumns();
+
+	return;
+}
+
+
+
+void KroneckerOperator::Clear()
+{
+	mFactors.clear();
+	mRows = 0;
+	mColumns = 0;
+
+	return;
+}
+
+
+
+const ComplexMatrix& KroneckerOperator::Factor(long i) const
+{
+	if ((i < 0) || (i >= NumFactors()))
+		ThrowException("KroneckerOperator::Factor : index out of range");
+
+	return mFactors[i];
+}
+
+
+
+void KroneckerOperator::Apply(const DenseVector<ComplexNumber> &x, DenseVector<ComplexNumber> &y) const
+{
+	if (&x == &y)
+		ThrowException("KroneckerOperator::Apply : y overwrites x");
+
+	if (x.Size() != mColumns)
+		ThrowException("KroneckerOperator::Apply : vector is wrong size");
+
+	y.SetSize(mRows);
+	Apply(1, x.Data(), y.Data());
+
+	return;
+}
+
+
+
+void KroneckerOperator::Apply(const ComplexMatrix &x, ComplexMatrix &y) const
+{
+	if (&x == &y)
+		ThrowException("KroneckerOperator::Apply : Y overwrites X");
+
+	if (x.NumRows() != mColumns)
+		ThrowException("KroneckerOperator::Apply : matrix is wrong size");
+
+	// the storage of both is contiguous, with stride the number of columns
+	y.SetSize(mRows, x.NumColumns());
+	Apply(x.NumColumns(), x.Data(), y.Data());
+
+	return;
+}
+
+
+
+void KroneckerOperator::Apply(long numVectors, const ComplexNumber *x, ComplexNumber *y) const
+{
+	long n = NumFactors();
+	if (n == 0)
+		ThrowException("KroneckerOperator::Apply : no factors");
+
+	if (numVectors == 0)
+		return;
+
+	// the largest tensor passed between two factors
+	long maxSize = 0;
+	long size = mColumns * numVectors;
+	for (long f = 0; f < n - 1; ++f) {
+		size = (size / mFactors[f].NumColumns()) * mFactors[f].NumRows();
+		if (size > maxSize)
+			maxSize = size;
+	}
+
+	long bufferSize = maxSize * sizeof(ComplexNumber);
+	ComplexNumber *buffer[2] = {NULL, NULL};
+	if (maxSize > 0) {
+		buffer[0] = static_cast<ComplexNumber*>(WorkspaceAllocate(bufferSize));
+		buffer[1] = static_cast<ComplexNumber*>(WorkspaceAllocate(bufferSize));
+	}
+
+	ComplexNumber one(1.0, 0.0);
+	ComplexNumber zero(0.0, 0.0);
+
+	const ComplexNumber *in = x;
+	long left = 1;
+	long right = mColumns * numVectors;
+	for (long f = 0; f < n; ++f) {
+		const ComplexMatrix &a = mFactors[f];
+		long p = a.NumRows();
+		long q = a.NumColumns();
+		right /= q;
+
+		ComplexNumber *out = (f == n - 1) ? y : buffer[f % 2];
+
+		if (right == 1) {
+			Gemm(NO_TRANSPOSE, TRANSPOSE, left, p, q, one, in, q, a.Data(), a.Stride(), zero, out, p);
+		}
+		else if (p * q * right < KRONECKER_DIRECT_SIZE) {
+			#pragma omp parallel for num_threads(NumThreads()) if (UseThreads(4.0 * left * p * q * right))
+			for (long l = 0; l < left; ++l)
+				ContractBlock(p, q, right, a.Data(), a.Stride(), in + l * q * right, out + l * p * right);
+		}
+		else {
+			// each product is threaded by Gemm itself unless there are
+			// enough of them to go round
+			#pragma omp parallel for num_threads(NumThreads()) if ((left >= NumThreads()) && UseThreads(4.0 * left * p * q * right))
+			for (long l = 0; l < left; ++l) {
+				Gemm(p, right, q, one, a.Data(), a.Stride(), in + l * q * right, right, zero,
+					 out + l * p * right, right);
+			}
+		}
+
+		in = out;
+		left *= p;
+	}
+
+	if (maxSize > 0) {
+		WorkspaceRelease(buffer[0], bufferSize);
+		WorkspaceRelease(buffer[1], bufferSize);
+	}
+
+	return;
+}
@@ -0,0 +1,735 @@
+/*
+ * Copyright (C) 2004-2018 David Bernstein <david.h.bernstein@gmail.com>
+ *
+ * This file is part of utility_cpp.
+ *
+ * utility_cpp is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * utility_cpp is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with utility_cpp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "lufactorization.h"
+
+#include "gemm.h"
+#include "parallel.h"
+
+#include <math.h>
+#include <float.h>
+
+using namespace utility;
+using namespace std;
+
+// The factorization is the blocked right-looking algorithm. Each step
+// factors a panel of LU_BLOCK columns with partial pivoting, solves for the
+// matching block row of U, and then updates the trailing matrix with one
+// GEMM, which is where nearly all of the flops are and which runs in
+// parallel. Row interchanges swap whole rows, which are contiguous in
+// row-major storage.
+
+namespace {
+	const long LU_BLOCK = 128;
+
+	// columns of a right hand side block handled by one thread
+	const long LU_COLUMN_CHUNK = 256;
+
+
+
+	inline long Min(long a, long b)
+	{
+		return (a < b) ? a : b;
+	}
+
+
+
+	// the scalar operations the LU needs, for double and float, and for
+	// ComplexNumber below
+	template<class T>
+	struct LUScalar {
+		static double Magnitude(T x) { return fabs(x); }
+		static T Reciprocal(T x) { return 1.0 / x; }
+		static bool IsZero(T x) { return x == 0.0; }
+		static T Real(double x) { return (T) x; }
+	};
+
+	// pivots are chosen by |re| + |im| as in LAPACK, cheaper than the modulus
+	// and as good for the purpose
+	template<>
+	struct LUScalar<ComplexNumber> {
+		static double Magnitude(const ComplexNumber &x) { return fabs(x.RealPart()) + fabs(x.ImaginaryPart()); }
+		static ComplexNumber Reciprocal(const ComplexNumber &x) { return ComplexNumber(1.0, 0.0) / x; }
+		static bool IsZero(const ComplexNumber &x) { return (x.RealPart() == 0.0) && (x.ImaginaryPart() == 0.0); }
+		static ComplexNumber Real(double x) { return ComplexNumber(x, 0.0); }
+	};
+
+
+
+	template<class T>
+	void SwapRows(long n, T *rowA, T *rowB)
+	{
+		for (long j = 0; j < n; ++j) {
+			T tmp = rowA[j];
+			rowA[j] = rowB[j];
+			rowB[j] = tmp;
+		}
+
+		return;
+	}
+
+
+
+	// unblocked LU of the panel made of rows k to m - 1 and columns k to
+	// k + kb - 1, interchanging whole rows (n elements) of a
+	// returns false if a zero pivot was found
+	template<class T>
+	bool FactorPanel(long m, long n, long k, long kb, T *a, long lda, long *pivot, double &sign)
+	{
+		bool nonsingular = true;
+
+		for (long j = k; j < k + kb; ++j) {
+			long p = j;
+			double big = LUScalar<T>::Magnitude(a[j * lda + j]);
+			for (long i = j + 1; i < m; ++i) {
+				double x = LUScalar<T>::Magnitude(a[i * lda + j]);
+				if (x > big) {
+					big = x;
+					p = i;
+				}
+			}
+
+			pivot[j] = p;
+			if (p != j) {
+				SwapRows(n, a + j * lda, a + p * lda);
+				sign = -sign;
+			}
+
+			if (big == 0.0) {
+				// nothing to eliminate in this column, keep going so the
+				// determinant still comes out as zero
+				nonsingular = false;
+				continue;
+			}
+
+			const T *rowJ = a + j * lda;
+			T pivotInverse = LUScalar<T>::Reciprocal(rowJ[j]);
+			long end = k + kb;
+
+			#pragma omp parallel for num_threads(NumThreads()) if (UseThreads((double) (m - j) * (end - j)))
+			for (long i = j + 1; i < m; ++i) {
+				T *rowI = a + i * lda;
+				T l = rowI[j] * pivotInverse;
+				rowI[j] = l;
+
+				for (long c = j + 1; c < end; ++c)
+					rowI[c] -= l * rowJ[c];
+			}
+		}
+
+		return nonsingular;
+	}
+
+
+
+	// x = L^-1 x for the rows i0 to i0 + ib - 1 of x, L being the unit
+	// lower triangle of that diagonal block of lu, columns are independent
+	// so they are split among the threads
+	template<class T>
+	void SolveLowerBlock(long i0, long ib, const T *lu, long ld, long m, T *x, long ldx)
+	{
+		long numChunks = (m + LU_COLUMN_CHUNK - 1) / LU_COLUMN_CHUNK;
+
+		#pragma omp parallel for num_threads(NumThreads()) if (UseThreads((double) ib * ib * m))
+		for (long chunk = 0; chunk < numChunks; ++chunk) {
+			long j0 = chunk * LU_COLUMN_CHUNK;
+			long jb = Min(LU_COLUMN_CHUNK, m - j0);
+
+			for (long i = i0 + 1; i < i0 + ib; ++i) {
+				T *rowI = x + i * ldx + j0;
+				for (long p = i0; p < i; ++p) {
+					T l = lu[i * ld + p];
+					if (!LUScalar<T>::IsZero(l)) {
+						const T *rowP = x + p * ldx + j0;
+						for (long j = 0; j < jb; ++j)
+							rowI[j] -= l * rowP[j];
+					}
+				}
+			}
+		}
+
+		return;
+	}
+
+
+
+	// x = U^-1 x for the rows i0 to i0 + ib - 1 of x, U being the upper
+	// triangle of that diagonal block of lu
+	template<class T>
+	void SolveUpperBlock(long i0, long ib, const T *lu, long ld, long m, T *x, long ldx)
+	{
+		long numChunks = (m + LU_COLUMN_CHUNK - 1) / LU_COLUMN_CHUNK;
+
+		#pragma omp parallel for num_threads(NumThreads()) if (UseThreads((double) ib * ib * m))
+		for (long chunk = 0; chunk < numChunks; ++chunk) {
+			long j0 = chunk * LU_COLUMN_CHUNK;
+			long jb = Min(LU_COLUMN_CHUNK, m - j0);
+
+			for (long i = i0 + ib - 1; i >= i0; --i) {
+				T *rowI = x + i * ldx + j0;
+				for (long p = i + 1; p < i0 + ib; ++p) {
+					T u = lu[i * ld + p];
+					if (!LUScalar<T>::IsZero(u)) {
+						const T *rowP = x + p * ldx + j0;
+						for (long j = 0; j < jb; ++j)
+							rowI[j] -= u * rowP[j];
+					}
+				}
+
+				T diagonalInverse = LUScalar<T>::Reciprocal(lu[i * ld + i]);
+				for (long j = 0; j < jb; ++j)
+					rowI[j] *= diagonalInverse;
+			}
+		}
+
+		return;
+	}
+
+
+
+	// factors the m x n matrix a (m >= n) in place, returns false if it is
+	// singular
+	template<class T>
+	bool BlockedLU(long m, long n, T *a, long lda, long *pivot, double &sign)
+	{
+		bool nonsingular = true;
+		sign = 1.0;
+
+		for (long k = 0; k < n; k += LU_BLOCK) {
+			long kb = Min(LU_BLOCK, n - k);
+			long trailingRows = m - k - kb;
+			long trailingColumns = n - k - kb;
+
+			if (!FactorPanel(m, n, k, kb, a, lda, pivot, sign))
+				nonsingular = false;
+
+			if (trailingColumns == 0)
+				continue;
+
+			// U12 = L11^-1 A12
+			SolveLowerBlock(k, kb, a, lda, trailingColumns, a + k + kb, lda);
+
+			// A22 -= L21 U12
+			Gemm(trailingRows, trailingColumns, kb, LUScalar<T>::Real(-1.0), a + (k + kb) * lda + k, lda,
+				 a + k * lda + k + kb, lda, LUScalar<T>::Real(1.0), a + (k + kb) * lda + k + kb, lda);
+		}
+
+		return nonsingular;
+	}
+
+
+
+	// x = A^-1 x for the m columns of x given the factors of A
+	template<class T>
+	void LUSolve(long n, const T *lu, long ld, const long *pivot, long m, T *x, long ldx)
+	{
+		for (long i = 0; i < n; ++i) {
+			if (pivot[i] != i)
+				SwapRows(m, x + i * ldx, x + pivot[i] * ldx);
+		}
+
+		// forward substitution a block row at a time, the part of each row
+		// coming from the blocks already solved is one GEMM
+		for (long i0 = 0; i0 < n; i0 += LU_BLOCK) {
+			long ib = Min(LU_BLOCK, n - i0);
+			if (i0 > 0)
+				Gemm(ib, m, i0, LUScalar<T>::Real(-1.0), lu + i0 * ld, ld, x, ldx, LUScalar<T>::Real(1.0),
+					 x + i0 * ldx, ldx);
+			SolveLowerBlock(i0, ib, lu, ld, m, x, ldx);
+		}
+
+		// and back substitution the same way from the bottom
+		long lastBlock = ((n - 1) / LU_BLOCK) * LU_BLOCK;
+		for (long i0 = lastBlock; i0 >= 0; i0 -= LU_BLOCK) {
+			long ib = Min(LU_BLOCK, n - i0);
+			long end = i0 + ib;
+			if (end < n)
+				Gemm(ib, m, n - end, LUScalar<T>::Real(-1.0), lu + i0 * ld + end, ld, x + end * ldx, ldx,
+					 LUScalar<T>::Real(1.0), x + i0 * ldx, ldx);
+			SolveUpperBlock(i0, ib, lu, ld, m, x, ldx);
+		}
+
+		return;
+	}
+}
+
+
+
+namespace utility {
+bool FactorLU(long m, long n, double *a, long lda, long *pivot, double &sign)
+{
+	if ((n < 0) || (m < n))
+		ThrowException("FactorLU : panel must have at least as many rows as columns");
+
+	return BlockedLU(m, n, a, lda, pivot, sign);
+}
+
+
+
+void SolveUnitLower(long n, const double *l, long ldl, long m, double *x, long ldx)
+{
+	for (long i0 = 0; i0 < n; i0 += LU_BLOCK) {
+		long ib = Min(LU_BLOCK, n - i0);
+		if (i0 > 0)
+			Gemm(ib, m, i0, -1.0, l + i0 * ldl, ldl, x, ldx, 1.0, x + i0 * ldx, ldx);
+		SolveLowerBlock(i0, ib, l, ldl, m, x, ldx);
+	}
+
+	return;
+}
+
+
+
+void SolveUpper(long n, const double *u, long ldu, long m, double *x, long ldx)
+{
+	if (n == 0)
+		return;
+
+	long lastBlock = ((n - 1) / LU_BLOCK) * LU_BLOCK;
+	for (long i0 = lastBlock; i0 >= 0; i0 -= LU_BLOCK) {
+		long ib = Min(LU_BLOCK, n - i0);
+		long end = i0 + ib;
+		if (end < n)
+			Gemm(ib, m, n - end, -1.0, u + i0 * ldu + end, ldu, x + end * ldx, ldx, 1.0, x + i0 * ldx, ldx);
+		SolveUpperBlock(i0, ib, u, ldu, m, x, ldx);
+	}
+
+	return;
+}
+
+
+
+void SolveLU(long n, const double *lu, long ldlu, const long *pivot, long m, double *b, long ldb)
+{
+	LUSolve(n, lu, ldlu, pivot, m, b, ldb);
+	return;
+}
+
+
+
+bool FactorLU(Matrix<float> &a, Array<long> &pivot, double &sign)
+{
+	if (a.NumRows() != a.NumColumns())
+		ThrowException("FactorLU : matrix is not square");
+
+	pivot.SetSize(a.NumRows());
+
+	return BlockedLU(a.NumRows(), a.NumRows(), a.Data(), a.Stride(), pivot.Begin(), sign);
+}
+
+
+
+void SolveLU(const Matrix<float> &lu, const Array<long> &pivot, Matrix<float> &b)
+{
+	if (b.NumRows() != lu.NumRows())
+		ThrowException("SolveLU : right hand side has the wrong number of rows");
+
+	LUSolve(lu.NumRows(), lu.Data(), lu.Stride(), pivot.Begin(), b.NumColumns(), b.Data(), b.Stride());
+
+	return;
+}
+
+
+
+bool FactorLU(Matrix<double> &a, Array<long> &pivot, double &sign)
+{
+	if (a.NumRows() != a.NumColumns())
+		ThrowException("FactorLU : matrix is not square");
+
+	pivot.SetSize(a.NumRows());
+
+	return BlockedLU(a.NumRows(), a.NumRows(), a.Data(), a.Stride(), pivot.Begin(), sign);
+}
+
+
+
+void SolveLU(const Matrix<double> &lu, const Array<long> &pivot, Matrix<double> &b)
+{
+	if (b.NumRows() != lu.NumRows())
+		ThrowException("SolveLU : right hand side has the wrong number of rows");
+
+	LUSolve(lu.NumRows(), lu.Data(), lu.Stride(), pivot.Begin(), b.NumColumns(), b.Data(), b.Stride());
+
+	return;
+}
+
+
+
+bool FactorLU(ComplexMatrix &a, Array<long> &pivot, double &sign)
+{
+	if (a.NumRows() != a.NumColumns())
+		ThrowException("FactorLU : matrix is not square");
+
+	pivot.SetSize(a.NumRows());
+
+	return BlockedLU(a.NumRows(), a.NumRows(), a.Data(), a.Stride(), pivot.Begin(), sign);
+}
+
+
+
+void SolveLU(const ComplexMatrix &lu, const Array<long> &pivot, ComplexMatrix &b)
+{
+	if (b.NumRows() != lu.NumRows())
+		ThrowException("SolveLU : right hand side has the wrong number of rows");
+
+	LUSolve(lu.NumRows(), lu.Data(), lu.Stride(), pivot.Begin(), b.NumColumns(), b.Data(), b.Stride());
+
+	return;
+}
+}
+
+
+
+LUFactorization::LUFactorization()
+{
+	mPivotSign = 1.0;
+	mSingular = false;
+
+	return;
+}
+
+
+
+LUFactorization::LUFactorization(const Matrix<double> &a)
+{
+	mPivotSign = 1.0;
+	mSingular = false;
+
+	Factor(a);
+
+	return;
+}
+
+
+
+void LUFactorization::Factor(const Matrix<double> &a)
+{
+	if (a.NumRows() != a.NumColumns())
+		ThrowException("LUFactorization::Factor : matrix is not square");
+
+	long n = a.NumRows();
+
+	mLU = a;
+	mPivot.SetSize(n);
+
+	mSingular = !BlockedLU(n, n, mLU.Data(), mLU.Stride(), mPivot.Begin(), mPivotSign);
+
+	return;
+}
+
+
+
+void LUFactorization::Solve(Matrix<double> &b) const
+{
+	CheckSolvable();
+
+	if (b.NumRows() != Size())
+		ThrowException("LUFactorization::Solve : right hand side has the wrong number of rows");
+
+	LUSolve(Size(), mLU.Data(), mLU.Stride(), mPivot.Begin(), b.NumColumns(), b.Data(), b.Stride());
+
+	return;
+}
+
+
+
+void LUFactorization::Solve(const Matrix<double> &b, Matrix<double> &x) const
+{
+	x = b;
+	Solve(x);
+	return;
+}
+
+
+
+void LUFactorization::Solve(double *b) const
+{
+	CheckSolvable();
+
+	long n = Size();
+	const double *lu = mLU.Data();
+	long ld = mLU.Stride();
+
+	for (long i = 0; i < n; ++i) {
+		long p = mPivot[i];
+		if (p != i) {
+			double tmp = b[i];
+			b[i] = b[p];
+			b[p] = tmp;
+		}
+	}
+
+	for (long i = 1; i < n; ++i) {
+		const double *rowI = lu + i * ld;
+		double sum = b[i];
+		for (long k = 0; k < i; ++k)
+			sum -= rowI[k] * b[k];
+		b[i] = sum;
+	}
+
+	for (long i = n - 1; i >= 0; --i) {
+		const double *rowI = lu + i * ld;
+		double sum = b[i];
+		for (long k = i + 1; k < n; ++k)
+			sum -= rowI[k] * b[k];
+		b[i] = sum / rowI[i];
+	}
+
+	return;
+}
+
+
+
+double LUFactorization::Determinant() const
+{
+	if (!Factored())
+		ThrowException("LUFactorization::Determinant : no matrix has been factored");
+
+	if (mSingular)
+		return 0.0;
+
+	double d = mPivotSign;
+	for (long i = 0; i < Size(); ++i) {
+		// should check for under/over flow
+		d *= mLU(i, i);
+	}
+
+	return d;
+}
+
+
+
+void LUFactorization::Inverse(Matrix<double> &inv) const
+{
+	CheckSolvable();
+
+	long n = Size();
+	inv.SetSize(n, n);
+	inv.MakeZero();
+	for (long i = 0; i < n; ++i)
+		inv(i, i) = 1.0;
+
+	Solve(inv);
+
+	return;
+}
+
+
+
+void LUFactorization::CheckSolvable() const
+{
+	if (!Factored())
+		ThrowException("LUFactorization : no matrix has been factored");
+
+	if (mSingular)
+		ThrowException("LUFactorization : matrix is singular");
+
+	return;
+}
+
+
+
+MixedPrecisionLU::MixedPrecisionLU()
+{
+	mSingleFailed = false;
+	mNorm = 0.0;
+	mNumRefinementSteps = 0;
+	mMaxRefinementSteps = MIXED_PRECISION_MAX_STEPS;
+
+	return;
+}
+
+
+
+MixedPrecisionLU::MixedPrecisionLU(const Matrix<double> &a)
+{
+	mSingleFailed = false;
+	mNorm = 0.0;
+	mNumRefinementSteps = 0;
+	mMaxRefinementSteps = MIXED_PRECISION_MAX_STEPS;
+
+	Factor(a);
+
+	return;
+}
+
+
+
+void MixedPrecisionLU::Factor(const Matrix<double> &a)
+{
+	if (a.NumRows() != a.NumColumns())
+		ThrowException("MixedPrecisionLU::Factor : matrix is not square");
+
+	long n = a.NumRows();
+
+	mA = a;
+	mDoubleLU = LUFactorization();
+	mNumRefinementSteps = 0;
+
+	mLU.SetSize(n, n);
+	mPivot.SetSize(n);
+
+	// a float doesn't have the range of a double
+	mSingleFailed = false;
+	mNorm = 0.0;
+	for (long i = 0; i < n; ++i) {
+		const double *row = a.Data() + i * a.Stride();
+		float *rowLU = mLU.Data() + i * mLU.Stride();
+		double rowSum = 0.0;
+		for (long j = 0; j < n; ++j) {
+			if (fabs(row[j]) > FLT_MAX)
+				mSingleFailed = true;
+			rowLU[j] = (float) row[j];
+			rowSum += fabs(row[j]);
+		}
+		if (rowSum > mNorm)
+			mNorm = rowSum;
+	}
+
+	if (!mSingleFailed) {
+		double sign;
+		mSingleFailed = !BlockedLU(n, n, mLU.Data(), mLU.Stride(), mPivot.Begin(), sign);
+	}
+
+	// no point trying to refine with factors that don't exist
+	if (mSingleFailed)
+		mDoubleLU.Factor(mA);
+
+	return;
+}
+
+
+
+void MixedPrecisionLU::Solve(Matrix<double> &b)
+{
+	if (!Factored())
+		ThrowException("MixedPrecisionLU : no matrix has been factored");
+
+	if (b.NumRows() != Size())
+		ThrowException("MixedPrecisionLU::Solve : right hand side has the wrong number of rows");
+
+	mNumRefinementSteps = 0;
+
+	if (!mDoubleLU.Factored()) {
+		Matrix<double> x;
+		if (RefineSolution(b, x)) {
+			b = x;
+			return;
+		}
+
+		mDoubleLU.Factor(mA);
+	}
+
+	mDoubleLU.Solve(b);
+
+	return;
+}
+
+
+
+void MixedPrecisionLU::Solve(const Matrix<double> &b, Matrix<double> &x)
+{
+	x = b;
+	Solve(x);
+	return;
+}
+
+
+
+// returns false if the iteration didn't converge in mMaxRefinementSteps
+bool MixedPrecisionLU::RefineSolution(const Matrix<double> &b, Matrix<double> &x)
+{
+	long n = Size();
+	long m = b.NumColumns();
+
+	Matrix<float> work;
+	SolveSingle(b, x, work);
+
+	// the test LAPACK uses, every column's residual has to be down to what
+	// a backward stable double solve would leave
+	double tolerance = mNorm * DBL_EPSILON * sqrt((double) n);
+
+	Matrix<double> r, d;
+	Array<double> residualNorm(m), solutionNorm(m);
+
+	for (long step = 0; ; ++step) {
+		// r = b - A x
+		r = b;
+		Gemm(n, m, n, -1.0, mA.Data(), mA.Stride(), x.Data(), x.Stride(), 1.0, r.Data(), r.Stride());
+
+		for (long j = 0; j < m; ++j) {
+			residualNorm[j] = 0.0;
+			solutionNorm[j] = 0.0;
+		}
+		for (long i = 0; i < n; ++i) {
+			const double *rowR = r.Data() + i * r.Stride();
+			const double *rowX = x.Data() + i * x.Stride();
+			for (long j = 0; j < m; ++j) {
+				residualNorm[j] = max(residualNorm[j], fabs(rowR[j]));
+				solutionNorm[j] = max(solutionNorm[j], fabs(rowX[j]));
+			}
+		}
+
+		// written so a NaN counts as not converged
+		bool converged = true;
+		for (long j = 0; j < m; ++j) {
+			if (!(residualNorm[j] <= solutionNorm[j] * tolerance))
+				converged = false;
+		}
+
+		if (converged)
+			return true;
+
+		if (step == mMaxRefinementSteps)
+			return false;
+
+		SolveSingle(r, d, work);
+		x += d;
+		++mNumRefinementSteps;
+	}
+}
+
+
+
+// x = A^-1 b with the single precision factors, work is scratch
+void MixedPrecisionLU::SolveSingle(const Matrix<double> &b, Matrix<double> &x, Matrix<float> &work) const
+{
+	long n = Size();
+	long m = b.NumColumns();
+
+	work.SetSize(n, m);
+	for (long i = 0; i < n; ++i) {
+		const double *rowB = b.Data() + i * b.Stride();
+		float *rowW = work.Data() + i * work.Stride();
+		for (long j = 0; j < m; ++j)
+			rowW[j] = (float) rowB[j];
+	}
+
+	LUSolve(n, mLU.Data(), mLU.Stride(), mPivot.Begin(), m, work.Data(), work.Stride());
+
+	x.SetSize(n, m);
+	for (long i = 0; i < n; ++i) {
+		const float *rowW = work.Data() + i * work.Stride();
+		double *rowX = x.Data() + i * x.Stride();
+		for (long j = 0; j < m; ++j)
+			rowX[j] = rowW[j];
+	}
+
+	return;
+}
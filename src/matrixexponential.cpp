@@ -0,0 +1,376 @@
+/*
+ * Copyright (C) 2004-2018 David Bernstein <david.h.bernstein@gmail.com>
+ *
+ * This file is part of utility_cpp.
+ *
+ * utility_cpp is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * utility_cpp is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with utility_cpp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "matrixexponential.h"
+#include "gemm.h"
+#include "lufactorization.h"
+
+#include <math.h>
+
+using namespace utility;
+using namespace std;
+
+// The degree m approximant is r_m(A) = (V - U)^-1 (V + U), with U the odd and
+// V the even part of the numerator polynomial p_m(A) = sum b_k A^k. Both are
+// built from A^2, A^4 and A^6 only, so degree 13 costs six products and one
+// solve, degree 9 five products (A^8 = A^4 A^4), and so on down to two for
+// degree 3. Everything is done on the raw storage with GEMMs, the sums of
+// powers are single passes over the elements.
+
+namespace {
+	const long PADE_NUM_DEGREES = 5;
+	const long PADE_DEGREES[PADE_NUM_DEGREES] = {3, 5, 7, 9, 13};
+
+	// largest 1-norm of A for which degree m has backward error below the
+	// unit roundoff
+	const double PADE_THETA[PADE_NUM_DEGREES] = {1.495585217958292e-2, 2.539398330063230e-1, 9.504178996162932e-1,
+												 2.097847961257068e0, 5.371920351148152e0};
+
+	const double PADE_3[] = {120.0, 60.0, 12.0, 1.0};
+	const double PADE_5[] = {30240.0, 15120.0, 3360.0, 420.0, 30.0, 1.0};
+	const double PADE_7[] = {17297280.0, 8648640.0, 1995840.0, 277200.0, 25200.0, 1512.0, 56.0, 1.0};
+	const double PADE_9[] = {17643225600.0, 8821612800.0, 2075673600.0, 302702400.0, 30270240.0, 2162160.0,
+							 110880.0, 3960.0, 90.0, 1.0};
+	const double PADE_13[] = {64764752532480000.0, 32382376266240000.0, 7771770303897600.0, 1187353796428800.0,
+							  129060195264000.0, 10559470521600.0, 670442572800.0, 33522128640.0, 1323241920.0,
+							  40840800.0, 960960.0, 16380.0, 182.0, 1.0};
+
+
+
+	template<class M>
+	struct MatrixElement;
+
+	template<>
+	struct MatrixElement<Matrix<double> > {
+		typedef double Type;
+	};
+
+	template<>
+	struct MatrixElement<ComplexMatrix> {
+		typedef ComplexNumber Type;
+	};
+
+
+
+	inline double Magnitude(double x)
+	{
+		return fabs(x);
+	}
+
+
+
+	inline double Magnitude(const ComplexNumber &x)
+	{
+		return x.Modulus();
+	}
+
+
+
+	inline double Scaled(double x, double b)
+	{
+		return b * x;
+	}
+
+
+
+	inline ComplexNumber Scaled(const ComplexNumber &x, double b)
+	{
+		return ComplexNumber(b * x.RealPart(), b * x.ImaginaryPart());
+	}
+
+
+
+	inline void AddReal(double &x, double b)
+	{
+		x += b;
+		return;
+	}
+
+
+
+	inline void AddReal(ComplexNumber &x, double b)
+	{
+		x = ComplexNumber(x.RealPart() + b, x.ImaginaryPart());
+		return;
+	}
+
+
+
+	inline double One(const double *)
+	{
+		return 1.0;
+	}
+
+
+
+	inline ComplexNumber One(const ComplexNumber *)
+	{
+		return ComplexNumber(1.0, 0.0);
+	}
+
+
+
+	inline double Zero(const double *)
+	{
+		return 0.0;
+	}
+
+
+
+	inline ComplexNumber Zero(const ComplexNumber *)
+	{
+		return ComplexNumber(0.0, 0.0);
+	}
+
+
+
+	// largest absolute column sum
+	template<class T>
+	double OneNorm(long n, const T *a, long lda)
+	{
+		Array<double> columnSum(n);
+		double *sum = columnSum.Begin();
+		for (long j = 0; j < n; ++j)
+			sum[j] = 0.0;
+
+		for (long i = 0; i < n; ++i) {
+			const T *row = a + i * lda;
+			for (long j = 0; j < n; ++j)
+				sum[j] += Magnitude(row[j]);
+		}
+
+		double norm = 0.0;
+		for (long j = 0; j < n; ++j) {
+			if (sum[j] > norm)
+				norm = sum[j];
+		}
+
+		return norm;
+	}
+
+
+
+	// c = a b for n x n matrices
+	template<class T>
+	void Multiply(long n, const T *a, long lda, const T *b, long ldb, T *c, long ldc)
+	{
+		Gemm(n, n, n, One(a), a, lda, b, ldb, Zero(a), c, ldc);
+		return;
+	}
+
+
+
+	// out = sum_k coefficient[k] power[k] + identity I, a single pass over
+	// the elements, up to three powers (a null power is skipped)
+	template<class T>
+	void Combine(long n, const double *coefficient, const T *const *power, long ld, double identity, T *out, long ldo)
+	{
+		for (long i = 0; i < n; ++i) {
+			T *row = out + i * ldo;
+			for (long j = 0; j < n; ++j) {
+				T sum = Zero(out);
+				for (long k = 0; k < 3; ++k) {
+					if (power[k] != NULL)
+						sum += Scaled(power[k][i * ld + j], coefficient[k]);
+				}
+				row[j] = sum;
+			}
+
+			AddReal(row[i], identity);
+		}
+
+		return;
+	}
+}
+
+
+
+template<class M>
+void MatrixExponential<M>::Compute(const M &a, M &result)
+{
+	if (a.NumRows() != a.NumColumns())
+		ThrowException("MatrixExponential::Compute : matrix is not square");
+
+	if (&a == &result)
+		ThrowException("MatrixExponential::Compute : result is the argument");
+
+	long n = a.NumRows();
+	mA = a;
+	result.SetSize(n, n);
+	mNumSquarings = 0;
+
+	if (n == 0)
+		return;
+
+	double norm = OneNorm(n, mA.Data(), mA.Stride());
+
+	for (long i = 0; i < PADE_NUM_DEGREES - 1; ++i) {
+		if (norm <= PADE_THETA[i]) {
+			Pade(PADE_DEGREES[i], result);
+			return;
+		}
+	}
+
+	// exp(A) = exp(A / 2^s)^(2^s) with A / 2^s inside the degree 13 bound
+	double ratio = norm / PADE_THETA[PADE_NUM_DEGREES - 1];
+	if (ratio > 1.0) {
+		mNumSquarings = (long) ceil(log(ratio) / log(2.0));
+		double scale = ldexp(1.0, (int) -mNumSquarings);
+		for (long i = 0; i < n; ++i) {
+			typename MatrixElement<M>::Type *row = mA.Data() + i * mA.Stride();
+			for (long j = 0; j < n; ++j)
+				row[j] = Scaled(row[j], scale);
+		}
+	}
+
+	Pade(13, result);
+
+	// the squarings alternate between result and mWork
+	mWork.SetSize(n, n);
+	M *current = &result;
+	M *other = &mWork;
+	for (long s = 0; s < mNumSquarings; ++s) {
+		Multiply(n, current->Data(), current->Stride(), current->Data(), current->Stride(), other->Data(), other->Stride());
+		M *swap = current;
+		current = other;
+		other = swap;
+	}
+
+	if (current != &result)
+		result = *current;
+
+	return;
+}
+
+
+
+template<class M>
+void MatrixExponential<M>::Pade(long degree, M &result)
+{
+	long n = mA.NumRows();
+	mDegree = degree;
+
+	mA2.SetSize(n, n);
+	mU.SetSize(n, n);
+	mV.SetSize(n, n);
+	mWork.SetSize(n, n);
+
+	long ld = mA.Stride();
+	const double *b = NULL;
+	switch (degree) {
+		case 3: b = PADE_3; break;
+		case 5: b = PADE_5; break;
+		case 7: b = PADE_7; break;
+		case 9: b = PADE_9; break;
+		default: b = PADE_13; break;
+	}
+
+	Multiply(n, mA.Data(), ld, mA.Data(), ld, mA2.Data(), ld);
+	if (degree >= 5) {
+		mA4.SetSize(n, n);
+		Multiply(n, mA2.Data(), ld, mA2.Data(), ld, mA4.Data(), ld);
+	}
+	if (degree >= 7) {
+		mA6.SetSize(n, n);
+		Multiply(n, mA2.Data(), ld, mA4.Data(), ld, mA6.Data(), ld);
+	}
+
+	typedef typename MatrixElement<M>::Type T;
+	const T *a2 = mA2.Data();
+	const T *a4 = (degree >= 5) ? mA4.Data() : NULL;
+	const T *a6 = (degree >= 7) ? mA6.Data() : NULL;
+	T *u = mU.Data();
+	T *v = mV.Data();
+	T *work = mWork.Data();
+
+	if (degree == 13) {
+		// U = A [A6 (b13 A6 + b11 A4 + b9 A2) + b7 A6 + b5 A4 + b3 A2 + b1 I]
+		// V = A6 (b12 A6 + b10 A4 + b8 A2) + b6 A6 + b4 A4 + b2 A2 + b0 I
+		const T *powers[3] = {a6, a4, a2};
+		double high[3] = {b[13], b[11], b[9]};
+		double low[3] = {b[7], b[5], b[3]};
+		Combine(n, high, powers, ld, 0.0, work, ld);
+		Combine(n, low, powers, ld, b[1], v, ld);
+		Gemm(n, n, n, One(a2), a6, ld, work, ld, One(a2), v, ld);
+		Multiply(n, mA.Data(), ld, v, ld, u, ld);
+
+		double highEven[3] = {b[12], b[10], b[8]};
+		double lowEven[3] = {b[6], b[4], b[2]};
+		Combine(n, highEven, powers, ld, 0.0, work, ld);
+		Combine(n, lowEven, powers, ld, b[0], v, ld);
+		Gemm(n, n, n, One(a2), a6, ld, work, ld, One(a2), v, ld);
+	}
+	else {
+		// U = A (b_m A^(m-1) + ... + b3 A2 + b1 I)
+		// V = b_m-1 A^(m-1) + ... + b2 A2 + b0 I
+		// powers[k] holds A^(6 - 2k) when the degree needs it
+		const T *powers[3] = {a6, a4, a2};
+		double odd[3] = {0.0, 0.0, 0.0};
+		double even[3] = {0.0, 0.0, 0.0};
+		for (long k = 2; (k < degree) && (k <= 6); k += 2) {
+			odd[3 - k / 2] = b[k + 1];
+			even[3 - k / 2] = b[k];
+		}
+
+		Combine(n, odd, powers, ld, b[1], work, ld);
+		if (degree == 9) {
+			// A8 = A4 A4 is the fifth product, u is free until the end
+			Multiply(n, a4, ld, a4, ld, u, ld);
+			for (long i = 0; i < n; ++i) {
+				for (long j = 0; j < n; ++j)
+					work[i * ld + j] += Scaled(u[i * ld + j], b[9]);
+			}
+		}
+
+		Combine(n, even, powers, ld, b[0], v, ld);
+		if (degree == 9) {
+			for (long i = 0; i < n; ++i) {
+				for (long j = 0; j < n; ++j)
+					v[i * ld + j] += Scaled(u[i * ld + j], b[8]);
+			}
+		}
+
+		Multiply(n, mA.Data(), ld, work, ld, u, ld);
+	}
+
+	// exp(A) ~ (V - U)^-1 (V + U)
+	result.SetSize(n, n);
+	T *p = result.Data();
+	long ldr = result.Stride();
+	for (long i = 0; i < n; ++i) {
+		for (long j = 0; j < n; ++j) {
+			T uij = u[i * ld + j];
+			T vij = v[i * ld + j];
+			p[i * ldr + j] = vij + uij;
+			v[i * ld + j] = vij - uij;
+		}
+	}
+
+	double sign;
+	if (!FactorLU(mV, mPivot, sign))
+		ThrowException("MatrixExponential::Compute : Pade denominator is singular");
+	SolveLU(mV, mPivot, result);
+
+	return;
+}
+
+
+
+template class utility::MatrixExponential<Matrix<double> >;
+template class utility::MatrixExponential<ComplexMatrix>;
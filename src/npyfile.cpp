@@ -0,0 +1,673 @@
+/*
+ * Copyright (C) 2004-2018 David Bernstein <david.h.bernstein@gmail.com>
+ *
+ * This file is part of utility_cpp.
+ *
+ * utility_cpp is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * utility_cpp is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with utility_cpp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "npyfile.h"
+#include "transpose.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace utility;
+using namespace std;
+
+// An .npy file is the magic string "\x93NUMPY", a major and minor version
+// byte, the length of the header (2 bytes little endian in version 1, 4 in
+// versions 2 and 3), and the header, a Python dict literal such as
+//     {'descr': '<f8', 'fortran_order': False, 'shape': (3, 4), }
+// padded with spaces and a newline so the data starts on a 64 byte
+// boundary. The data follows as one block. Only little endian files are
+// read, which is what NumPy writes on the machines we run on.
+
+namespace {
+	const char NPY_MAGIC[6] = {'\x93', 'N', 'U', 'M', 'P', 'Y'};
+	const size_t NPY_MAGIC_SIZE = 6;
+	const size_t NPY_ALIGNMENT = 64;
+
+	// the largest header we write or accept
+	const size_t NPY_MAX_HEADER = 1 << 16;
+
+
+
+	template<class T>
+	struct NpyType;
+
+	template<>
+	struct NpyType<double> {
+		static const char* Description() { return "<f8"; }
+	};
+
+	template<>
+	struct NpyType<float> {
+		static const char* Description() { return "<f4"; }
+	};
+
+	template<>
+	struct NpyType<long> {
+		static const char* Description() { return (sizeof(long) == 8) ? "<i8" : "<i4"; }
+	};
+
+	template<>
+	struct NpyType<ComplexNumber> {
+		static const char* Description() { return "<c16"; }
+	};
+
+
+
+	struct NpyHeader {
+		string description;
+		bool fortranOrder;
+		vector<long> shape;
+
+		// bytes before the data
+		size_t dataOffset;
+	};
+
+
+
+	string SystemError(const string &message)
+	{
+		return message + " : " + strerror(errno);
+	}
+
+
+
+	long NumElements(const vector<long> &shape)
+	{
+		long n = 1;
+		for (size_t i = 0; i < shape.size(); ++i)
+			n *= shape[i];
+
+		return n;
+	}
+
+
+
+	// the version 1 preamble and header for the given type and shape
+	string MakeHeader(const string &description, const vector<long> &shape)
+	{
+		string dict = "{'descr': '" + description + "', 'fortran_order': False, 'shape': (";
+		for (size_t i = 0; i < shape.size(); ++i) {
+			dict += ConvertIntegerToString(shape[i]);
+			if ((i + 1 < shape.size()) || (shape.size() == 1))
+				dict += ",";
+			if (i + 1 < shape.size())
+				dict += " ";
+		}
+		dict += "), }";
+
+		// magic, 2 version bytes, 2 length bytes, the dict and a newline
+		size_t preamble = NPY_MAGIC_SIZE + 4;
+		size_t total = preamble + dict.size() + 1;
+		total = (total + NPY_ALIGNMENT - 1) / NPY_ALIGNMENT * NPY_ALIGNMENT;
+		dict.append(total - preamble - dict.size() - 1, ' ');
+		dict += '\n';
+
+		string header(NPY_MAGIC, NPY_MAGIC_SIZE);
+		header += (char) 1;
+		header += (char) 0;
+		header += (char) (dict.size() & 0xff);
+		header += (char) ((dict.size() >> 8) & 0xff);
+
+		return header + dict;
+	}
+
+
+
+	// the position just past "'key':" and any spaces after it
+	size_t FindValue(const string &dict, const string &key, const string &fileName)
+	{
+		size_t position = dict.find("'" + key + "'");
+		if (position == string::npos)
+			position = dict.find("\"" + key + "\"");
+		if (position == string::npos)
+			ThrowException("ReadNpyHeader : " + fileName + " has no " + key);
+
+		position = dict.find(':', position + key.size() + 2);
+		if (position == string::npos)
+			ThrowException("ReadNpyHeader : " + fileName + " has a malformed header");
+
+		++position;
+		while ((position < dict.size()) && (dict[position] == ' '))
+			++position;
+
+		return position;
+	}
+
+
+
+	void ParseDict(const string &dict, NpyHeader &header, const string &fileName)
+	{
+		size_t position = FindValue(dict, "descr", fileName);
+		char quote = dict[position];
+		size_t end = dict.find(quote, position + 1);
+		if (((quote != '\'') && (quote != '"')) || (end == string::npos))
+			ThrowException("ReadNpyHeader : " + fileName + " has a malformed descr");
+		header.description = dict.substr(position + 1, end - position - 1);
+
+		position = FindValue(dict, "fortran_order", fileName);
+		if (dict.compare(position, 4, "True") == 0)
+			header.fortranOrder = true;
+		else if (dict.compare(position, 5, "False") == 0)
+			header.fortranOrder = false;
+		else
+			ThrowException("ReadNpyHeader : " + fileName + " has a malformed fortran_order");
+
+		position = FindValue(dict, "shape", fileName);
+		end = dict.find(')', position);
+		if ((dict[position] != '(') || (end == string::npos))
+			ThrowException("ReadNpyHeader : " + fileName + " has a malformed shape");
+
+		header.shape.clear();
+		const char *p = dict.c_str() + position + 1;
+		const char *last = dict.c_str() + end;
+		while (p < last) {
+			if ((*p >= '0') && (*p <= '9')) {
+				char *next;
+				header.shape.push_back(strtol(p, &next, 10));
+				p = next;
+			}
+			else if ((*p == ',') || (*p == ' ') || (*p == 'L')) {
+				++p;
+			}
+			else {
+				ThrowException("ReadNpyHeader : " + fileName + " has a malformed shape");
+			}
+		}
+
+		return;
+	}
+
+
+
+	// reads the preamble and header from the first bytes of the file
+	// returns 0 if more than size bytes are needed, otherwise the data offset
+	size_t ParseHeader(const char *bytes, size_t size, NpyHeader &header, const string &fileName)
+	{
+		if (size < NPY_MAGIC_SIZE + 4)
+			return 0;
+
+		if (memcmp(bytes, NPY_MAGIC, NPY_MAGIC_SIZE) != 0)
+			ThrowException("ReadNpyHeader : " + fileName + " is not an .npy file");
+
+		const unsigned char *b = (const unsigned char *) bytes;
+		unsigned char major = b[NPY_MAGIC_SIZE];
+		size_t dictSize, preamble;
+		if (major == 1) {
+			dictSize = b[8] | ((size_t) b[9] << 8);
+			preamble = NPY_MAGIC_SIZE + 4;
+		}
+		else if ((major == 2) || (major == 3)) {
+			if (size < NPY_MAGIC_SIZE + 6)
+				return 0;
+			dictSize = b[8] | ((size_t) b[9] << 8) | ((size_t) b[10] << 16) | ((size_t) b[11] << 24);
+			preamble = NPY_MAGIC_SIZE + 6;
+		}
+		else {
+			ThrowException("ReadNpyHeader : " + fileName + " has an unknown .npy version");
+			return 0;
+		}
+
+		if (dictSize > NPY_MAX_HEADER)
+			ThrowException("ReadNpyHeader : " + fileName + " has an oversized header");
+
+		if (size < preamble + dictSize)
+			return 0;
+
+		ParseDict(string(bytes + preamble, dictSize), header, fileName);
+		header.dataOffset = preamble + dictSize;
+
+		return header.dataOffset;
+	}
+
+
+
+	void ReadHeader(ifstream &file, NpyHeader &header, const string &fileName)
+	{
+		vector<char> bytes(NPY_MAGIC_SIZE + 6);
+		file.read(&bytes[0], bytes.size());
+		size_t got = file.gcount();
+
+		if (ParseHeader(&bytes[0], got, header, fileName) == 0) {
+			// the preamble has been checked, read up to the largest dict
+			size_t needed = NPY_MAGIC_SIZE + 6 + NPY_MAX_HEADER;
+			bytes.resize(needed);
+			file.read(&bytes[got], needed - got);
+			got += file.gcount();
+
+			if (ParseHeader(&bytes[0], got, header, fileName) == 0)
+				ThrowException("ReadNpyHeader : " + fileName + " is truncated");
+		}
+
+		file.clear();
+		file.seekg(header.dataOffset);
+
+		return;
+	}
+
+
+
+	void CheckType(const string &caller, const string &fileDescription, const char *description)
+	{
+		if (fileDescription == description)
+			return;
+
+		// a single byte type has no byte order, NumPy writes '|' for it
+		if ((fileDescription.size() > 1) && (fileDescription[0] == '|') &&
+			(fileDescription.substr(1) == description + 1))
+			return;
+
+		ThrowException(caller + " : file holds " + fileDescription + ", not " + description);
+		return;
+	}
+
+
+
+	template<class T>
+	void WriteFile(const string &fileName, const T *data, const vector<long> &shape)
+	{
+		ofstream file(fileName.c_str(), ios::out | ios::binary | ios::trunc);
+		if (!file.good())
+			ThrowException("SaveNpy : couldn't open " + fileName);
+
+		string header = MakeHeader(NpyType<T>::Description(), shape);
+		file.write(header.data(), header.size());
+		file.write((const char *) data, NumElements(shape) * sizeof(T));
+
+		if (!file.good())
+			ThrowException("SaveNpy : couldn't write " + fileName);
+
+		return;
+	}
+
+
+
+	template<class T>
+	void ReadData(ifstream &file, T *data, long n, const string &fileName)
+	{
+		file.read((char *) data, n * sizeof(T));
+		if (file.gcount() != (streamsize) (n * sizeof(T)))
+			ThrowException("LoadNpy : " + fileName + " is truncated");
+
+		return;
+	}
+
+
+
+	template<class T>
+	void SaveMatrix(const string &fileName, const T *data, long numRows, long numColumns)
+	{
+		vector<long> shape(2);
+		shape[0] = numRows;
+		shape[1] = numColumns;
+		WriteFile(fileName, data, shape);
+		return;
+	}
+
+
+
+	template<class T>
+	void SaveArray(const string &fileName, const Array<T> &a)
+	{
+		vector<long> shape(1, a.Size());
+		WriteFile(fileName, a.Begin(), shape);
+		return;
+	}
+
+
+
+	template<class T, class M>
+	void LoadMatrix(const string &fileName, M &m)
+	{
+		ifstream file(fileName.c_str(), ios::in | ios::binary);
+		if (!file.good())
+			ThrowException("LoadNpy : can't find " + fileName);
+
+		NpyHeader header;
+		ReadHeader(file, header, fileName);
+		CheckType("LoadNpy", header.description, NpyType<T>::Description());
+
+		if (header.shape.size() != 2)
+			ThrowException("LoadNpy : " + fileName + " is not two dimensional");
+
+		long numRows = header.shape[0];
+		long numColumns = header.shape[1];
+		m.SetSize(numRows, numColumns);
+
+		if (!header.fortranOrder) {
+			ReadData(file, m.Data(), numRows * numColumns, fileName);
+		}
+		else {
+			// column major, the file holds the transpose in C order
+			Array<T> transpose(numRows * numColumns);
+			ReadData(file, transpose.Begin(), numRows * numColumns, fileName);
+			TransposeMatrix(numColumns, numRows, transpose.Begin(), numRows, m.Data(), m.Stride());
+		}
+
+		return;
+	}
+
+
+
+	template<class T>
+	void LoadArray(const string &fileName, Array<T> &a)
+	{
+		ifstream file(fileName.c_str(), ios::in | ios::binary);
+		if (!file.good())
+			ThrowException("LoadNpy : can't find " + fileName);
+
+		NpyHeader header;
+		ReadHeader(file, header, fileName);
+		CheckType("LoadNpy", header.description, NpyType<T>::Description());
+
+		if (header.shape.size() != 1)
+			ThrowException("LoadNpy : " + fileName + " is not one dimensional");
+
+		a.SetSize(header.shape[0]);
+		ReadData(file, a.Begin(), a.Size(), fileName);
+
+		return;
+	}
+}
+
+
+
+namespace utility {
+void SaveNpy(const string &fileName, const Matrix<double> &m)
+{
+	SaveMatrix(fileName, m.Data(), m.NumRows(), m.NumColumns());
+	return;
+}
+
+
+
+void SaveNpy(const string &fileName, const Matrix<float> &m)
+{
+	SaveMatrix(fileName, m.Data(), m.NumRows(), m.NumColumns());
+	return;
+}
+
+
+
+void SaveNpy(const string &fileName, const ComplexMatrix &m)
+{
+	SaveMatrix(fileName, m.Data(), m.NumRows(), m.NumColumns());
+	return;
+}
+
+
+
+void SaveNpy(const string &fileName, const Array<double> &a)
+{
+	SaveArray(fileName, a);
+	return;
+}
+
+
+
+void SaveNpy(const string &fileName, const Array<float> &a)
+{
+	SaveArray(fileName, a);
+	return;
+}
+
+
+
+void SaveNpy(const string &fileName, const Array<long> &a)
+{
+	SaveArray(fileName, a);
+	return;
+}
+
+
+
+void SaveNpy(const string &fileName, const Array<ComplexNumber> &a)
+{
+	SaveArray(fileName, a);
+	return;
+}
+
+
+
+void LoadNpy(const string &fileName, Matrix<double> &m)
+{
+	LoadMatrix<double>(fileName, m);
+	return;
+}
+
+
+
+void LoadNpy(const string &fileName, Matrix<float> &m)
+{
+	LoadMatrix<float>(fileName, m);
+	return;
+}
+
+
+
+void LoadNpy(const string &fileName, ComplexMatrix &m)
+{
+	LoadMatrix<ComplexNumber>(fileName, m);
+	return;
+}
+
+
+
+void LoadNpy(const string &fileName, Array<double> &a)
+{
+	LoadArray(fileName, a);
+	return;
+}
+
+
+
+void LoadNpy(const string &fileName, Array<float> &a)
+{
+	LoadArray(fileName, a);
+	return;
+}
+
+
+
+void LoadNpy(const string &fileName, Array<long> &a)
+{
+	LoadArray(fileName, a);
+	return;
+}
+
+
+
+void LoadNpy(const string &fileName, Array<ComplexNumber> &a)
+{
+	LoadArray(fileName, a);
+	return;
+}
+
+
+
+MappedNpyFile::MappedNpyFile()
+{
+	mFile = -1;
+	mMap = NULL;
+	mMapSize = 0;
+	mDataOffset = 0;
+	mFortranOrder = false;
+	return;
+}
+
+
+
+MappedNpyFile::MappedNpyFile(const string &fileName)
+{
+	mFile = -1;
+	mMap = NULL;
+	mMapSize = 0;
+	mDataOffset = 0;
+	mFortranOrder = false;
+	Open(fileName);
+	return;
+}
+
+
+
+MappedNpyFile::~MappedNpyFile()
+{
+	Close();
+	return;
+}
+
+
+
+void MappedNpyFile::Open(const string &fileName)
+{
+	Close();
+
+	try {
+		MapFile(fileName);
+	}
+	catch (...) {
+		Close();
+		throw;
+	}
+
+	return;
+}
+
+
+
+void MappedNpyFile::MapFile(const string &fileName)
+{
+	mFile = open(fileName.c_str(), O_RDONLY);
+	if (mFile < 0)
+		ThrowException(SystemError("MappedNpyFile::Open : can't open " + fileName));
+
+	struct stat status;
+	if (fstat(mFile, &status) != 0)
+		ThrowException(SystemError("MappedNpyFile::Open : can't stat " + fileName));
+
+	if (status.st_size == 0)
+		ThrowException("MappedNpyFile::Open : " + fileName + " is empty");
+
+	void *map = mmap(NULL, status.st_size, PROT_READ, MAP_SHARED, mFile, 0);
+	if (map == MAP_FAILED)
+		ThrowException(SystemError("MappedNpyFile::Open : can't map " + fileName));
+
+	mMap = (char *) map;
+	mMapSize = status.st_size;
+
+	NpyHeader header;
+	if (ParseHeader(mMap, mMapSize, header, fileName) == 0)
+		ThrowException("MappedNpyFile::Open : " + fileName + " is truncated");
+
+	mTypeDescription = header.description;
+	mFortranOrder = header.fortranOrder;
+	mShape = header.shape;
+	mDataOffset = header.dataOffset;
+
+	// the element size is checked when the data is asked for, here only
+	// that the file is at least as long as the smallest element allows
+	if (mDataOffset + (size_t) NumElements() > mMapSize)
+		ThrowException("MappedNpyFile::Open : " + fileName + " is truncated");
+
+	return;
+}
+
+
+
+void MappedNpyFile::Close()
+{
+	if (mMap != NULL) {
+		munmap(mMap, mMapSize);
+		mMap = NULL;
+		mMapSize = 0;
+	}
+
+	if (mFile >= 0) {
+		close(mFile);
+		mFile = -1;
+	}
+
+	mDataOffset = 0;
+	mTypeDescription.clear();
+	mFortranOrder = false;
+	mShape.clear();
+
+	return;
+}
+
+
+
+long MappedNpyFile::Dimension(long i) const
+{
+	if ((i < 0) || (i >= NumDimensions()))
+		ThrowException("MappedNpyFile::Dimension : index out of range");
+
+	return mShape[i];
+}
+
+
+
+long MappedNpyFile::NumElements() const
+{
+	return ::NumElements(mShape);
+}
+
+
+
+long MappedNpyFile::NumRows() const
+{
+	return (mShape.size() > 0) ? mShape[0] : 1;
+}
+
+
+
+long MappedNpyFile::NumColumns() const
+{
+	if (mShape.size() > 2)
+		ThrowException("MappedNpyFile::NumColumns : file has more than two dimensions");
+
+	return (mShape.size() == 2) ? mShape[1] : 1;
+}
+
+
+
+template<class T>
+const T* MappedNpyFile::Data() const
+{
+	if (!IsOpen())
+		ThrowException("MappedNpyFile::Data : no file is open");
+
+	CheckType("MappedNpyFile::Data", mTypeDescription, NpyType<T>::Description());
+
+	if (mDataOffset + (size_t) NumElements() * sizeof(T) > mMapSize)
+		ThrowException("MappedNpyFile::Data : file is truncated");
+
+	return (const T *) (mMap + mDataOffset);
+}
+
+
+
+template const double* MappedNpyFile::Data<double>(void) const;
+template const float* MappedNpyFile::Data<float>(void) const;
+template const long* MappedNpyFile::Data<long>(void) const;
+template const ComplexNumber* MappedNpyFile::Data<ComplexNumber>(void) const;
+}
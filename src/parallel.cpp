@@ -0,0 +1,74 @@
+/*
+ * Copyright (C) 2004-2018 David Bernstein <david.h.bernstein@gmail.com>
+ *
+ * This file is part of utility_cpp.
+ *
+ * utility_cpp is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * utility_cpp is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with utility_cpp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "parallel.h"
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+using namespace utility;
+using namespace std;
+
+namespace {
+	// 0 means use the OpenMP default
+	long numThreadsSetting = 0;
+}
+
+
+
+namespace utility {
+void SetNumThreads(long n)
+{
+	numThreadsSetting = (n > 0) ? n : 0;
+	return;
+}
+
+
+
+long NumThreads()
+{
+#ifdef _OPENMP
+	if (numThreadsSetting > 0)
+		return numThreadsSetting;
+	
+	return omp_get_max_threads();
+#else
+	return 1;
+#endif
+}
+
+
+
+bool UseThreads(double numOperations)
+{
+	return (NumThreads() > 1) && (numOperations >= PARALLEL_MIN_OPERATIONS);
+}
+
+
+
+long ThreadIndex()
+{
+#ifdef _OPENMP
+	return omp_get_thread_num();
+#else
+	return 0;
+#endif
+}
+}
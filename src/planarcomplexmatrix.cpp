@@ -0,0 +1,278 @@
+/*
+ * Copyright (C) 2004-2018 David Bernstein <david.h.bernstein@gmail.com>
+ *
+ * This file is part of utility_cpp.
+ *
+ * utility_cpp is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * utility_cpp is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with utility_cpp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "planarcomplexmatrix.h"
+#include "gemm.h"
+#include "simd.h"
+
+#include <math.h>
+
+using namespace utility;
+using namespace std;
+
+// Both planes are Matrix<double>s of the same size, so each is one
+// contiguous block of NumRows() * NumColumns() doubles and the elementwise
+// operations run over the whole block at once.
+
+
+
+PlanarComplexMatrix::PlanarComplexMatrix(long numRows, long numColumns)
+{
+	SetSize(numRows, numColumns);
+	MakeZero();
+
+	return;
+}
+
+
+
+PlanarComplexMatrix::PlanarComplexMatrix(const ComplexMatrix &m)
+{
+	CopyFrom(m);
+	return;
+}
+
+
+
+void PlanarComplexMatrix::SetSize(long numRows, long numColumns)
+{
+	mReal.SetSize(numRows, numColumns);
+	mImaginary.SetSize(numRows, numColumns);
+
+	return;
+}
+
+
+
+void PlanarComplexMatrix::CopyFrom(const ComplexMatrix &m)
+{
+	long rows = m.NumRows();
+	long columns = m.NumColumns();
+	SetSize(rows, columns);
+
+	double *re = mReal.Data();
+	double *im = mImaginary.Data();
+	for (long i = 0; i < rows; ++i) {
+		const double *row = reinterpret_cast<const double*>(m.Data() + i * m.Stride());
+		for (long j = 0; j < columns; ++j) {
+			re[i * columns + j] = row[2 * j];
+			im[i * columns + j] = row[2 * j + 1];
+		}
+	}
+
+	return;
+}
+
+
+
+void PlanarComplexMatrix::CopyTo(ComplexMatrix &m) const
+{
+	long rows = NumRows();
+	long columns = NumColumns();
+	m.SetSize(rows, columns);
+
+	const double *re = mReal.Data();
+	const double *im = mImaginary.Data();
+	for (long i = 0; i < rows; ++i) {
+		double *row = reinterpret_cast<double*>(m.Data() + i * m.Stride());
+		for (long j = 0; j < columns; ++j) {
+			row[2 * j] = re[i * columns + j];
+			row[2 * j + 1] = im[i * columns + j];
+		}
+	}
+
+	return;
+}
+
+
+
+PlanarComplexMatrix PlanarComplexMatrix::operator*(const PlanarComplexMatrix &m) const
+{
+	PlanarComplexMatrix p;
+	Gemm(NO_TRANSPOSE, NO_TRANSPOSE, 1.0, *this, m, 0.0, p);
+
+	return p;
+}
+
+
+
+PlanarComplexMatrix& PlanarComplexMatrix::operator+=(const PlanarComplexMatrix &m)
+{
+	CheckSameSize(m, "operator+=");
+
+	long n = NumRows() * NumColumns();
+	VectorAdd(n, m.mReal.Data(), mReal.Data());
+	VectorAdd(n, m.mImaginary.Data(), mImaginary.Data());
+
+	return *this;
+}
+
+
+
+PlanarComplexMatrix& PlanarComplexMatrix::operator-=(const PlanarComplexMatrix &m)
+{
+	CheckSameSize(m, "operator-=");
+
+	long n = NumRows() * NumColumns();
+	VectorAxpy(n, -1.0, m.mReal.Data(), mReal.Data());
+	VectorAxpy(n, -1.0, m.mImaginary.Data(), mImaginary.Data());
+
+	return *this;
+}
+
+
+
+PlanarComplexMatrix& PlanarComplexMatrix::operator*=(const ComplexNumber &a)
+{
+	double ar = a.RealPart();
+	double ai = a.ImaginaryPart();
+
+	long n = NumRows() * NumColumns();
+	double *re = mReal.Data();
+	double *im = mImaginary.Data();
+	for (long i = 0; i < n; ++i) {
+		double x = re[i];
+		double y = im[i];
+		re[i] = ar * x - ai * y;
+		im[i] = ar * y + ai * x;
+	}
+
+	return *this;
+}
+
+
+
+void PlanarComplexMatrix::ConjugateInPlace()
+{
+	VectorScale(NumRows() * NumColumns(), -1.0, mImaginary.Data());
+	return;
+}
+
+
+
+void PlanarComplexMatrix::MakeZero()
+{
+	mReal.MakeZero();
+	mImaginary.MakeZero();
+
+	return;
+}
+
+
+
+ComplexNumber PlanarComplexMatrix::InnerProduct(const PlanarComplexMatrix &m) const
+{
+	CheckSameSize(m, "InnerProduct");
+
+	// tr(A^H B) = sum conj(a) b = sum (ar br + ai bi) + i (ar bi - ai br)
+	long n = NumRows() * NumColumns();
+	const double *ar = mReal.Data();
+	const double *ai = mImaginary.Data();
+	const double *br = m.mReal.Data();
+	const double *bi = m.mImaginary.Data();
+
+	double re = VectorDot(n, ar, br) + VectorDot(n, ai, bi);
+	double im = VectorDot(n, ar, bi) - VectorDot(n, ai, br);
+
+	return ComplexNumber(re, im);
+}
+
+
+
+double PlanarComplexMatrix::Norm() const
+{
+	long n = NumRows() * NumColumns();
+	double sum = VectorDot(n, mReal.Data(), mReal.Data()) + VectorDot(n, mImaginary.Data(), mImaginary.Data());
+
+	return sqrt(sum);
+}
+
+
+
+double PlanarComplexMatrix::Distance(const PlanarComplexMatrix &m) const
+{
+	CheckSameSize(m, "Distance");
+
+	long n = NumRows() * NumColumns();
+	double sum = VectorDistanceSquared(n, mReal.Data(), m.mReal.Data()) +
+				 VectorDistanceSquared(n, mImaginary.Data(), m.mImaginary.Data());
+
+	return sqrt(sum);
+}
+
+
+
+void PlanarComplexMatrix::CheckSameSize(const PlanarComplexMatrix &m, const char *method) const
+{
+	if ((NumRows() != m.NumRows()) || (NumColumns() != m.NumColumns()))
+		ThrowException(string("PlanarComplexMatrix::") + method + " : matrices are different dimensions");
+
+	return;
+}
+
+
+
+namespace utility {
+void Gemm(MatrixOperation opA, MatrixOperation opB, double alpha, const PlanarComplexMatrix &a,
+		  const PlanarComplexMatrix &b, double beta, PlanarComplexMatrix &c)
+{
+	if ((&c == &a) || (&c == &b))
+		ThrowException("Gemm : C overwrites A or B");
+
+	long m = (opA == NO_TRANSPOSE) ? a.NumRows() : a.NumColumns();
+	long k = (opA == NO_TRANSPOSE) ? a.NumColumns() : a.NumRows();
+	long kB = (opB == NO_TRANSPOSE) ? b.NumRows() : b.NumColumns();
+	long n = (opB == NO_TRANSPOSE) ? b.NumColumns() : b.NumRows();
+
+	if (k != kB)
+		ThrowException("Gemm : matrices are wrong size");
+
+	if (beta == 0.0)
+		c.SetSize(m, n);
+	else if ((c.NumRows() != m) || (c.NumColumns() != n))
+		ThrowException("Gemm : C is the wrong size");
+
+	// the planes are transposed as real matrices, and conjugation flips the
+	// sign of the imaginary plane, so with sA and sB the signs
+	//     Cr = alpha (Ar Br - sA sB Ai Bi) + beta Cr
+	//     Ci = alpha (sB Ar Bi + sA Ai Br) + beta Ci
+	MatrixOperation realOpA = (opA == NO_TRANSPOSE) ? NO_TRANSPOSE : TRANSPOSE;
+	MatrixOperation realOpB = (opB == NO_TRANSPOSE) ? NO_TRANSPOSE : TRANSPOSE;
+	double sA = (opA == CONJUGATE_TRANSPOSE) ? -1.0 : 1.0;
+	double sB = (opB == CONJUGATE_TRANSPOSE) ? -1.0 : 1.0;
+
+	const Matrix<double> &ar = a.RealPart();
+	const Matrix<double> &ai = a.ImaginaryPart();
+	const Matrix<double> &br = b.RealPart();
+	const Matrix<double> &bi = b.ImaginaryPart();
+	Matrix<double> &cr = c.RealPart();
+	Matrix<double> &ci = c.ImaginaryPart();
+
+	Gemm(realOpA, realOpB, m, n, k, alpha, ar.Data(), ar.Stride(), br.Data(), br.Stride(), beta,
+		 cr.Data(), cr.Stride());
+	Gemm(realOpA, realOpB, m, n, k, -sA * sB * alpha, ai.Data(), ai.Stride(), bi.Data(), bi.Stride(), 1.0,
+		 cr.Data(), cr.Stride());
+	Gemm(realOpA, realOpB, m, n, k, sB * alpha, ar.Data(), ar.Stride(), bi.Data(), bi.Stride(), beta,
+		 ci.Data(), ci.Stride());
+	Gemm(realOpA, realOpB, m, n, k, sA * alpha, ai.Data(), ai.Stride(), br.Data(), br.Stride(), 1.0,
+		 ci.Data(), ci.Stride());
+
+	return;
+}
+}
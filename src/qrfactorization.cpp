@@ -0,0 +1,455 @@
+/*
+ * Copyright (C) 2004-2018 David Bernstein <david.h.bernstein@gmail.com>
+ *
+ * This file is part of utility_cpp.
+ *
+ * utility_cpp is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * utility_cpp is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with utility_cpp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "qrfactorization.h"
+#include "gemm.h"
+#include "parallel.h"
+
+#include <math.h>
+
+using namespace utility;
+using namespace std;
+
+// Blocked Householder QR. A panel of QR_BLOCK columns is factored one
+// reflector at a time, then the panel's reflectors are gathered into the
+// compact WY form H_1 H_2 ... H_kb = I - V T V^T (T upper triangular) so the
+// rest of the matrix is updated with GEMMs instead of kb rank one updates.
+// Applying Q or Q^T to a right hand side works the same way.
+
+namespace {
+	const long QR_BLOCK = 64;
+
+	// columns of a right hand side block handled by one thread
+	const long QR_COLUMN_CHUNK = 256;
+
+
+
+	inline long Min(long a, long b)
+	{
+		return (a < b) ? a : b;
+	}
+
+
+
+	// 2-norm of n elements spaced stride apart, scaled so it can't overflow
+	double ScaledNorm(long n, const double *x, long stride)
+	{
+		double scale = 0.0;
+		for (long i = 0; i < n; ++i) {
+			double absX = fabs(x[i * stride]);
+			if (absX > scale)
+				scale = absX;
+		}
+
+		if (scale == 0.0)
+			return 0.0;
+
+		double sum = 0.0;
+		for (long i = 0; i < n; ++i) {
+			double y = x[i * stride] / scale;
+			sum += y * y;
+		}
+
+		return scale * sqrt(sum);
+	}
+
+
+
+	// unblocked QR of the panel made of rows k to m - 1 and columns k to
+	// k + kb - 1, only the panel itself is updated
+	void FactorPanel(long m, long k, long kb, double *a, long lda, double *tau, double *w)
+	{
+		long end = k + kb;
+
+		for (long j = k; j < end; ++j) {
+			double *rowJ = a + j * lda;
+			double alpha = rowJ[j];
+			double xNorm = ScaledNorm(m - j - 1, a + (j + 1) * lda + j, lda);
+
+			if (xNorm == 0.0) {
+				// already zero below the diagonal, H_j is the identity
+				tau[j] = 0.0;
+				continue;
+			}
+
+			double beta = -copysign(hypot(alpha, xNorm), alpha);
+			tau[j] = (beta - alpha) / beta;
+			double scale = 1.0 / (alpha - beta);
+			for (long i = j + 1; i < m; ++i)
+				a[i * lda + j] *= scale;
+			rowJ[j] = beta;
+
+			// apply H_j to the rest of the panel, w = v^T A then A -= tau v w
+			long nc = end - j - 1;
+			if (nc == 0)
+				continue;
+
+			for (long c = 0; c < nc; ++c)
+				w[c] = rowJ[j + 1 + c];
+			for (long i = j + 1; i < m; ++i) {
+				const double *rowI = a + i * lda;
+				double v = rowI[j];
+				for (long c = 0; c < nc; ++c)
+					w[c] += v * rowI[j + 1 + c];
+			}
+
+			for (long c = 0; c < nc; ++c) {
+				w[c] *= tau[j];
+				rowJ[j + 1 + c] -= w[c];
+			}
+
+			#pragma omp parallel for num_threads(NumThreads()) if (UseThreads((double) (m - j) * nc))
+			for (long i = j + 1; i < m; ++i) {
+				double *rowI = a + i * lda;
+				double v = rowI[j];
+				for (long c = 0; c < nc; ++c)
+					rowI[j + 1 + c] -= v * w[c];
+			}
+		}
+
+		return;
+	}
+
+
+
+	// forms the compact WY representation of the kb reflectors stored below
+	// the diagonal of the rows x kb block at a
+	// v gets V (rows x kb, unit lower trapezoidal), vt its transpose and t
+	// the kb x kb upper triangular T, g is kb x kb workspace
+	void BuildBlockReflector(long rows, long kb, const double *a, long lda, const double *tau,
+							 double *v, double *vt, double *t, double *g)
+	{
+		for (long i = 0; i < rows; ++i) {
+			for (long j = 0; j < kb; ++j) {
+				double x;
+				if (i < j)
+					x = 0.0;
+				else if (i == j)
+					x = 1.0;
+				else
+					x = a[i * lda + j];
+
+				v[i * kb + j] = x;
+				vt[j * rows + i] = x;
+			}
+		}
+
+		// every inner product of two reflectors in one GEMM
+		Gemm(kb, kb, rows, 1.0, vt, rows, v, kb, 0.0, g, kb);
+
+		// T(0:j, j) = -tau_j T(0:j, 0:j) V(:, 0:j)^T v_j
+		for (long j = 0; j < kb; ++j) {
+			for (long i = 0; i < kb; ++i)
+				t[i * kb + j] = 0.0;
+			t[j * kb + j] = tau[j];
+
+			for (long i = 0; i < j; ++i) {
+				double sum = 0.0;
+				for (long p = i; p < j; ++p)
+					sum += t[i * kb + p] * g[p * kb + j];
+				t[i * kb + j] = -tau[j] * sum;
+			}
+		}
+
+		return;
+	}
+
+
+
+	// C = (I - V T V^T) C, or with T^T in place of T if transpose is true,
+	// for the rows x nc block at c, w is kb x nc workspace
+	void ApplyBlockReflector(long rows, long nc, long kb, const double *v, const double *vt, const double *t,
+							 bool transpose, double *c, long ldc, double *w)
+	{
+		// W = V^T C
+		Gemm(kb, nc, rows, 1.0, vt, rows, c, ldc, 0.0, w, nc);
+
+		// W = T W or T^T W in place, the order of the rows keeps every row
+		// that is still needed unchanged
+		if (transpose) {
+			for (long i = kb - 1; i >= 0; --i) {
+				double *rowI = w + i * nc;
+				double tii = t[i * kb + i];
+				for (long j = 0; j < nc; ++j)
+					rowI[j] *= tii;
+				for (long p = 0; p < i; ++p) {
+					double tpi = t[p * kb + i];
+					const double *rowP = w + p * nc;
+					for (long j = 0; j < nc; ++j)
+						rowI[j] += tpi * rowP[j];
+				}
+			}
+		}
+		else {
+			for (long i = 0; i < kb; ++i) {
+				double *rowI = w + i * nc;
+				double tii = t[i * kb + i];
+				for (long j = 0; j < nc; ++j)
+					rowI[j] *= tii;
+				for (long p = i + 1; p < kb; ++p) {
+					double tip = t[i * kb + p];
+					const double *rowP = w + p * nc;
+					for (long j = 0; j < nc; ++j)
+						rowI[j] += tip * rowP[j];
+				}
+			}
+		}
+
+		// C -= V W
+		Gemm(rows, nc, kb, -1.0, v, kb, w, nc, 1.0, c, ldc);
+
+		return;
+	}
+
+
+
+	// x = U^-1 x for the rows i0 to i0 + ib - 1 of x, U being the upper
+	// triangle of that diagonal block of r
+	void SolveUpperBlock(long i0, long ib, const double *r, long ld, long m, double *x, long ldx)
+	{
+		long numChunks = (m + QR_COLUMN_CHUNK - 1) / QR_COLUMN_CHUNK;
+
+		#pragma omp parallel for num_threads(NumThreads()) if (UseThreads((double) ib * ib * m))
+		for (long chunk = 0; chunk < numChunks; ++chunk) {
+			long j0 = chunk * QR_COLUMN_CHUNK;
+			long jb = Min(QR_COLUMN_CHUNK, m - j0);
+
+			for (long i = i0 + ib - 1; i >= i0; --i) {
+				double *rowI = x + i * ldx + j0;
+				for (long p = i + 1; p < i0 + ib; ++p) {
+					double u = r[i * ld + p];
+					const double *rowP = x + p * ldx + j0;
+					for (long j = 0; j < jb; ++j)
+						rowI[j] -= u * rowP[j];
+				}
+
+				double diagonalInverse = 1.0 / r[i * ld + i];
+				for (long j = 0; j < jb; ++j)
+					rowI[j] *= diagonalInverse;
+			}
+		}
+
+		return;
+	}
+}
+
+
+
+QRFactorization::QRFactorization()
+{
+	mFullRank = false;
+	return;
+}
+
+
+
+QRFactorization::QRFactorization(const Matrix<double> &a)
+{
+	mFullRank = false;
+	Factor(a);
+	return;
+}
+
+
+
+void QRFactorization::Factor(const Matrix<double> &a)
+{
+	long m = a.NumRows();
+	long n = a.NumColumns();
+
+	if (m < n)
+		ThrowException("QRFactorization::Factor : matrix has more columns than rows");
+
+	mQR = a;
+	mTau.SetSize(n);
+
+	double *qr = mQR.Data();
+	long ld = mQR.Stride();
+
+	Array<double> w(QR_BLOCK), v, vt, t(QR_BLOCK * QR_BLOCK), g(QR_BLOCK * QR_BLOCK), work;
+
+	for (long k = 0; k < n; k += QR_BLOCK) {
+		long kb = Min(QR_BLOCK, n - k);
+		long rows = m - k;
+		long trailing = n - k - kb;
+
+		FactorPanel(m, k, kb, qr, ld, mTau.Begin(), w.Begin());
+
+		if (trailing == 0)
+			continue;
+
+		v.SetSize(rows * kb);
+		vt.SetSize(kb * rows);
+		work.SetSize(kb * trailing);
+
+		BuildBlockReflector(rows, kb, qr + k * ld + k, ld, mTau.Begin() + k,
+							v.Begin(), vt.Begin(), t.Begin(), g.Begin());
+		ApplyBlockReflector(rows, trailing, kb, v.Begin(), vt.Begin(), t.Begin(), true,
+							qr + k * ld + k + kb, ld, work.Begin());
+	}
+
+	mFullRank = true;
+	for (long i = 0; i < n; ++i) {
+		if (mQR(i, i) == 0.0)
+			mFullRank = false;
+	}
+
+	return;
+}
+
+
+
+void QRFactorization::Solve(const Matrix<double> &b, Matrix<double> &x) const
+{
+	CheckFactored();
+
+	if (!mFullRank)
+		ThrowException("QRFactorization::Solve : matrix is rank deficient");
+
+	long n = NumColumns();
+	long numRhs = b.NumColumns();
+
+	// Q^T b, the first n rows are R x and the rest is the residual
+	Matrix<double> y(b);
+	ApplyQTranspose(y);
+
+	x.SetSize(n, numRhs);
+	for (long i = 0; i < n; ++i) {
+		for (long j = 0; j < numRhs; ++j)
+			x(i, j) = y(i, j);
+	}
+
+	// back substitution a block row at a time from the bottom
+	const double *r = mQR.Data();
+	long ld = mQR.Stride();
+	double *xData = x.Data();
+	long ldx = x.Stride();
+
+	long lastBlock = ((n - 1) / QR_BLOCK) * QR_BLOCK;
+	for (long i0 = lastBlock; i0 >= 0; i0 -= QR_BLOCK) {
+		long ib = Min(QR_BLOCK, n - i0);
+		long end = i0 + ib;
+		if (end < n)
+			Gemm(ib, numRhs, n - end, -1.0, r + i0 * ld + end, ld, xData + end * ldx, ldx, 1.0, xData + i0 * ldx, ldx);
+		SolveUpperBlock(i0, ib, r, ld, numRhs, xData, ldx);
+	}
+
+	return;
+}
+
+
+
+void QRFactorization::ApplyQTranspose(Matrix<double> &b) const
+{
+	ApplyReflectors(b, true);
+	return;
+}
+
+
+
+void QRFactorization::ApplyQ(Matrix<double> &b) const
+{
+	ApplyReflectors(b, false);
+	return;
+}
+
+
+
+void QRFactorization::GetR(Matrix<double> &r) const
+{
+	CheckFactored();
+
+	long n = NumColumns();
+	r.SetSize(n, n);
+	for (long i = 0; i < n; ++i) {
+		for (long j = 0; j < n; ++j)
+			r(i, j) = (j >= i) ? mQR(i, j) : 0.0;
+	}
+
+	return;
+}
+
+
+
+void QRFactorization::GetQ(Matrix<double> &q) const
+{
+	CheckFactored();
+
+	q.SetSize(NumRows(), NumColumns());
+	q.MakeZero();
+	for (long i = 0; i < NumColumns(); ++i)
+		q(i, i) = 1.0;
+
+	ApplyQ(q);
+
+	return;
+}
+
+
+
+void QRFactorization::CheckFactored() const
+{
+	if (!Factored())
+		ThrowException("QRFactorization : no matrix has been factored");
+
+	return;
+}
+
+
+
+// Q = H_0 H_1 ... H_n-1, so Q^T b applies the blocks of reflectors first
+// to last and Q b last to first
+void QRFactorization::ApplyReflectors(Matrix<double> &b, bool transpose) const
+{
+	CheckFactored();
+
+	long m = NumRows();
+	long n = NumColumns();
+
+	if (b.NumRows() != m)
+		ThrowException("QRFactorization::ApplyReflectors : right hand side has the wrong number of rows");
+
+	long numRhs = b.NumColumns();
+	if (numRhs == 0)
+		return;
+
+	const double *qr = mQR.Data();
+	long ld = mQR.Stride();
+	double *c = b.Data();
+	long ldc = b.Stride();
+
+	Array<double> v, vt, t(QR_BLOCK * QR_BLOCK), g(QR_BLOCK * QR_BLOCK), work(QR_BLOCK * numRhs);
+
+	long numBlocks = (n + QR_BLOCK - 1) / QR_BLOCK;
+	for (long block = 0; block < numBlocks; ++block) {
+		long k = transpose ? block * QR_BLOCK : (numBlocks - 1 - block) * QR_BLOCK;
+		long kb = Min(QR_BLOCK, n - k);
+		long rows = m - k;
+
+		v.SetSize(rows * kb);
+		vt.SetSize(kb * rows);
+
+		BuildBlockReflector(rows, kb, qr + k * ld + k, ld, mTau.Begin() + k,
+							v.Begin(), vt.Begin(), t.Begin(), g.Begin());
+		ApplyBlockReflector(rows, numRhs, kb, v.Begin(), vt.Begin(), t.Begin(), transpose,
+							c + k * ldc, ldc, work.Begin());
+	}
+
+	return;
+}
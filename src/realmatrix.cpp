@@ -19,6 +19,12 @@
 
 #include "realmatrix.h"
 #include "randomnumbergenerator.h"
+#include "gemm.h"
+#include "simd.h"
+#include "lufactorization.h"
+#include "transpose.h"
+#include "matrixexponential.h"
+#include "strassen.h"
 
 #include <iostream>
 
@@ -27,11 +33,8 @@ using namespace std;
 
 Matrix<double>& Matrix<double>::operator*=(double a)
 {
-	for (long i = 0; i < mRows; ++i) {
-		for (long j = 0; j < mColumns; ++j) {
-			mpData[i][j] *= a;
-		}
-	}
+	for (long i = 0; i < mRows; ++i) 
+		VectorScale(mColumns, a, mpData + i * mStride);
 	
 	return *this;
 }
@@ -46,11 +49,8 @@ Matrix<double>& Matrix<double>::operator+=(const Matrix<double> &m)
 	if (mColumns != m.mColumns)
 		ThrowException("Matrix<double>::operator+= : unequal number of columns");
 		
-	for (long i = 0; i < mRows; ++i) {
-		for (long j = 0; j < mColumns; ++j) {
-			mpData[i][j] += m.mpData[i][j];
-		}
-	}	
+	for (long i = 0; i < mRows; ++i) 
+		VectorAdd(mColumns, m.mpData + i * m.mStride, mpData + i * mStride);
 	
 	return *this;
 }
@@ -59,30 +59,29 @@ Matrix<double>& Matrix<double>::operator+=(const Matrix<double> &m)
 
 void Matrix<double>::Inverse(Matrix<double> &inv) const
 {
-    double d;
-    int *indx = new int[mRows + 1];
-    
-    Matrix<double> tmp;
-    MakeNRMatrix(tmp);
-    
-    ludcmp(tmp.mpData, mRows, indx, &d);
-    
-    double *col = new double[mRows + 1];
-    
-    inv.SetSize(mRows, mColumns);
-    
-    for (short j = 1; j <= mRows; ++j) {
-        for (short i = 1; i <= mRows; ++i) 
-            col[i] = 0.0;
-        
-        col[j] = 1.0;
-        lubksb(tmp.mpData, mRows, indx, col); 
-        for (short i = 1; i <= mRows; ++i) 
-            inv(i-1, j-1) = col[i];
+    // to solve rather than invert keep an LUFactorization around instead
+    // the factors and pivots are workspace blocks, so inverting in a loop
+    // does not touch the heap
+    if (mRows != mColumns)
+        ThrowException("Matrix<double>::Inverse : matrix is not square");
+    
+    long n = mRows;
+    Matrix<double> lu(*this);
+    long *pivot = static_cast<long*>(WorkspaceAllocate(n * sizeof(long)));
+    
+    double sign;
+    if (!FactorLU(n, n, lu.mpData, lu.mStride, pivot, sign)) {
+        WorkspaceRelease(pivot, n * sizeof(long));
+        ThrowException("Matrix<double>::Inverse : matrix is singular");
     }
     
-    delete [] indx;
-    delete [] col;
+    inv.SetSize(n, n);
+    inv.MakeZero();
+    for (long i = 0; i < n; ++i)
+        inv.mpData[i * inv.mStride + i] = 1.0;
+    
+    SolveLU(n, lu.mpData, lu.mStride, pivot, n, inv.mpData, inv.mStride);
+    WorkspaceRelease(pivot, n * sizeof(long));
     
     return;
 }
@@ -91,22 +90,8 @@ void Matrix<double>::Inverse(Matrix<double> &inv) const
 
 double Matrix<double>::Determinant() const
 {
-    double d = 0.0;
-    int *indx = new int[mRows + 1];
-    
-    Matrix<double> tmp;
-    MakeNRMatrix(tmp);
-    
-    ludcmp(tmp.mpData, mRows, indx, &d);
-    
-    for (short i = 1; i <= mRows; ++i) {
-        // should check for under/over flow
-        d *= tmp(i, i);
-    }
-    
-    delete [] indx;
-    
-    return d;
+    LUFactorization lu(*this);
+    return lu.Determinant();
 }
 
 
@@ -118,158 +103,96 @@ Matrix<double> Matrix<double>::operator*(const Matrix<double> &m) const
         
     Matrix<double> p(mRows, m.mColumns);
 
-    for (short i = 0; i < p.mRows; ++i) {
-        for (short j = 0; j < p.mColumns; ++j) {
-            p(i, j) = 0.0;
-            for (short k = 0; k < p.mColumns; ++k)
-                p(i, j) += (*this)(i, k) * m(k, j);
-        }
-        
-    }
+    Gemm(mRows, m.mColumns, mColumns, 1.0, mpData, mStride, m.mpData, m.mStride, 0.0, p.mpData, p.mStride);
     
     return p;
 }
 
 
 
-void Matrix<double>::MakeZero()
+Matrix<double> Matrix<double>::Multiply(const Matrix<double> &m, MatrixMultiplyType type) const
 {
-    for (short i = 0; i < mRows; ++i) {
-        for (short j = 0; j < mColumns; ++j) {
-            mpData[i][j] = 0.0;
-        }
-    }
+    if (type == CLASSICAL_MULTIPLY)
+        return (*this) * m;
     
-    return;
+    StrassenMultiplier strassen;
+    Matrix<double> p;
+    strassen.Multiply(*this, m, p);
+    
+    return p;
 }
 
 
 
-void Matrix<double>::MakeRandom(long seed)
+Matrix<double> Matrix<double>::Transpose() const
 {
-    RandomNumberGenerator rng;
-    rng.Reset(seed);
-    
-    for (short i = 0; i < mRows; ++i) {
-        for (short j = 0; j < mColumns; ++j) {
-            mpData[i][j] = rng.Random01();
-        }
-    }
+    Matrix<double> result(mColumns, mRows);
+    TransposeMatrix(mRows, mColumns, mpData, mStride, result.mpData, result.mStride);
     
-    return;
+    return result;
 }
 
 
 
-void Matrix<double>::MakeNRMatrix(Matrix<double> &nr) const
+void Matrix<double>::TransposeInPlace()
 {
-    nr.SetSize(mRows + 1, mColumns + 1);
+    TransposeMatrixInPlace(mRows, mColumns, mpData);
     
-    for (short i = 1; i <= mRows; ++i) {
-        for (short j = 1; j <= mColumns; ++j) 
-            nr.mpData[i][j] = mpData[i-1][j-1];
-    }
-    
-    for (short i = 0; i < nr.mRows; ++i) 
-        nr.mpData[i][0] = 0.0;
-    
-    for (short i = 0; i < nr.mColumns; ++i) 
-        nr.mpData[0][i] = 0.0;
+    long tmp = mRows;
+    mRows = mColumns;
+    mColumns = tmp;
+    mStride = mColumns;
     
     return;
 }
 
 
 
-void Matrix<double>::Print() const
+Matrix<double> Matrix<double>::Exponential() const
 {
-    for (short i = 0; i < mRows; ++i) {
-        for (short j = 0; j < mColumns; ++j) {
-            cout << mpData[i][j] << " ";
-        }
-        cout << endl;
-    }
+    MatrixExponential<Matrix<double> > exponential;
+    Matrix<double> result;
+    exponential.Compute(*this, result);
+    
+    return result;
+}
+
+
+
+void Matrix<double>::MakeZero()
+{
+    for (long i = 0; i < mRows; ++i) 
+        VectorZero(mColumns, mpData + i * mStride);
     
     return;
 }
 
 
-// begin NR routine ludcmp
-#define TINY 1.0e-20;
-void Matrix<double>::ludcmp(double **a, int n, int *indx, double *d) const
+
+void Matrix<double>::MakeRandom(long seed)
 {
-	int i,imax,j,k;
-	double big,dum,sum,temp;
+    RandomNumberGenerator rng;
+    rng.Reset(seed);
     
-    Array<double> vv(n+1);
-    //vv=vector(1,n);
+    for (long i = 0; i < mRows; ++i) {
+        for (long j = 0; j < mColumns; ++j) {
+            mpData[i * mStride + j] = rng.Random01();
+        }
+    }
     
-	*d=1.0;
-	for (i=1;i<=n;i++) {
-		big=0.0;
-		for (j=1;j<=n;j++)
-			if ((temp=fabs(a[i][j])) > big) big=temp;
-		if (big == 0.0) ThrowException("Singular matrix in routine ludcmp");
-		vv[i]=1.0/big;
-	}
-	for (j=1;j<=n;j++) {
-		for (i=1;i<j;i++) {
-			sum=a[i][j];
-			for (k=1;k<i;k++) sum -= a[i][k]*a[k][j];
-			a[i][j]=sum;
-		}
-		big=0.0;
-		for (i=j;i<=n;i++) {
-			sum=a[i][j];
-			for (k=1;k<j;k++)
-				sum -= a[i][k]*a[k][j];
-			a[i][j]=sum;
-			if ( (dum=vv[i]*fabs(sum)) >= big) {
-				big=dum;
-				imax=i;
-			}
-		}
-		if (j != imax) {
-			for (k=1;k<=n;k++) {
-				dum=a[imax][k];
-				a[imax][k]=a[j][k];
-				a[j][k]=dum;
-			}
-			*d = -(*d);
-			vv[imax]=vv[j];
-		}
-		indx[j]=imax;
-		if (a[j][j] == 0.0) a[j][j]=TINY;
-		if (j != n) {
-			dum=1.0/(a[j][j]);
-			for (i=j+1;i<=n;i++) a[i][j] *= dum;
-		}
-	}
-	//free_vector(vv,1,n);
+    return;
 }
-#undef TINY
-// End NR routine ludcmp
 
 
-// begin NR routine lubksb
-void Matrix<double>::lubksb(double **a, int n, int *indx, double b[]) const
+
+void Matrix<double>::Print() const
 {
-	int i,ii=0,ip,j;
-	double sum;
-
-	for (i=1;i<=n;i++) {
-		ip=indx[i];
-		sum=b[ip];
-		b[ip]=b[i];
-		if (ii)
-			for (j=ii;j<=i-1;j++) sum -= a[i][j]*b[j];
-		else if (sum) ii=i;
-		b[i]=sum;
-	}
-	for (i=n;i>=1;i--) {
-		sum=b[i];
-		for (j=i+1;j<=n;j++) sum -= a[i][j]*b[j];
-		b[i]=sum/a[i][i];
-	}
+    for (short i = 0; i < mRows; ++i) {
+        for (short j = 0; j < mColumns; ++j) {
+            cout << mpData[i * mStride + j] << " ";
+        }
+        cout << endl;
+    }
+    
+    return;
 }
-// end NR routine lubksb
@@ -0,0 +1,1600 @@
+/*
+ * Copyright (C) 2004-2018 David Bernstein <david.h.bernstein@gmail.com>
+ *
+ * This file is part of utility_cpp.
+ *
+ * utility_cpp is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * utility_cpp is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with utility_cpp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "simd.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define UTILITY_SIMD_X86
+#include <immintrin.h>
+#endif
+
+using namespace utility;
+using namespace std;
+
+// Each instruction set gets its own copy of every kernel. The x86 versions
+// are compiled with gcc/clang target attributes, so this file needs no
+// special compiler flags and the wider instructions are only executed
+// after CPUID says they are there.
+
+namespace {
+	// scalar versions, always available
+	void VectorAddScalar(long n, const double *x, double *y)
+	{
+		for (long i = 0; i < n; ++i)
+			y[i] += x[i];
+
+		return;
+	}
+
+
+
+	void VectorScaleScalar(long n, double a, double *y)
+	{
+		for (long i = 0; i < n; ++i)
+			y[i] *= a;
+
+		return;
+	}
+
+
+
+	void VectorZeroScalar(long n, double *y)
+	{
+		for (long i = 0; i < n; ++i)
+			y[i] = 0.0;
+
+		return;
+	}
+
+
+
+	void VectorComplexScaleScalar(long n, double ar, double ai, double *y)
+	{
+		for (long i = 0; i < n; ++i) {
+			double re = y[2 * i];
+			double im = y[2 * i + 1];
+			y[2 * i] = ar * re - ai * im;
+			y[2 * i + 1] = ar * im + ai * re;
+		}
+
+		return;
+	}
+
+
+
+	void VectorAxpyScalar(long n, double a, const double *x, double *y)
+	{
+		for (long i = 0; i < n; ++i)
+			y[i] += a * x[i];
+
+		return;
+	}
+
+
+
+	double VectorDotScalar(long n, const double *x, const double *y)
+	{
+		// four sums, so the adds don't wait on each other
+		double s0 = 0.0;
+		double s1 = 0.0;
+		double s2 = 0.0;
+		double s3 = 0.0;
+		long i = 0;
+		for (; i + 4 <= n; i += 4) {
+			s0 += x[i] * y[i];
+			s1 += x[i + 1] * y[i + 1];
+			s2 += x[i + 2] * y[i + 2];
+			s3 += x[i + 3] * y[i + 3];
+		}
+		for (; i < n; ++i)
+			s0 += x[i] * y[i];
+
+		return (s0 + s1) + (s2 + s3);
+	}
+
+
+
+	// the four sums of xr yr, xi yi, xr yi and xi yr over n interleaved
+	// complex numbers, from which both sum conj(x) y and sum x y follow
+	void VectorComplexDotScalar(long n, const double *x, const double *y, double *sums)
+	{
+		double s0 = 0.0;
+		double s1 = 0.0;
+		double s2 = 0.0;
+		double s3 = 0.0;
+		for (long i = 0; i < n; ++i) {
+			double xr = x[2 * i];
+			double xi = x[2 * i + 1];
+			double yr = y[2 * i];
+			double yi = y[2 * i + 1];
+			s0 += xr * yr;
+			s1 += xi * yi;
+			s2 += xr * yi;
+			s3 += xi * yr;
+		}
+
+		sums[0] = s0;
+		sums[1] = s1;
+		sums[2] = s2;
+		sums[3] = s3;
+
+		return;
+	}
+
+
+
+	double VectorDistanceSquaredScalar(long n, const double *x, const double *y)
+	{
+		double s0 = 0.0;
+		double s1 = 0.0;
+		long i = 0;
+		for (; i + 2 <= n; i += 2) {
+			double d0 = x[i] - y[i];
+			double d1 = x[i + 1] - y[i + 1];
+			s0 += d0 * d0;
+			s1 += d1 * d1;
+		}
+		for (; i < n; ++i)
+			s0 += (x[i] - y[i]) * (x[i] - y[i]);
+
+		return s0 + s1;
+	}
+
+
+
+	const long SCALAR_MR = 4;
+	const long SCALAR_NR = 8;
+
+	void MicroKernelScalar(long kc, const double *a, const double *b, double *ab)
+	{
+		double c[SCALAR_MR * SCALAR_NR];
+		for (long i = 0; i < SCALAR_MR * SCALAR_NR; ++i)
+			c[i] = 0.0;
+
+		for (long p = 0; p < kc; ++p) {
+			for (long i = 0; i < SCALAR_MR; ++i) {
+				double ai = a[i];
+				for (long j = 0; j < SCALAR_NR; ++j)
+					c[i * SCALAR_NR + j] += ai * b[j];
+			}
+			a += SCALAR_MR;
+			b += SCALAR_NR;
+		}
+
+		for (long i = 0; i < SCALAR_MR * SCALAR_NR; ++i)
+			ab[i] = c[i];
+
+		return;
+	}
+
+
+
+	void VectorAddScalarFloat(long n, const float *x, float *y)
+	{
+		for (long i = 0; i < n; ++i)
+			y[i] += x[i];
+
+		return;
+	}
+
+
+
+	void VectorScaleScalarFloat(long n, float a, float *y)
+	{
+		for (long i = 0; i < n; ++i)
+			y[i] *= a;
+
+		return;
+	}
+
+
+
+	void VectorZeroScalarFloat(long n, float *y)
+	{
+		for (long i = 0; i < n; ++i)
+			y[i] = 0.0f;
+
+		return;
+	}
+
+
+
+	const long SCALAR_FLOAT_MR = 4;
+	const long SCALAR_FLOAT_NR = 8;
+
+	void MicroKernelScalarFloat(long kc, const float *a, const float *b, float *ab)
+	{
+		float c[SCALAR_FLOAT_MR * SCALAR_FLOAT_NR];
+		for (long i = 0; i < SCALAR_FLOAT_MR * SCALAR_FLOAT_NR; ++i)
+			c[i] = 0.0f;
+
+		for (long p = 0; p < kc; ++p) {
+			for (long i = 0; i < SCALAR_FLOAT_MR; ++i) {
+				float ai = a[i];
+				for (long j = 0; j < SCALAR_FLOAT_NR; ++j)
+					c[i * SCALAR_FLOAT_NR + j] += ai * b[j];
+			}
+			a += SCALAR_FLOAT_MR;
+			b += SCALAR_FLOAT_NR;
+		}
+
+		for (long i = 0; i < SCALAR_FLOAT_MR * SCALAR_FLOAT_NR; ++i)
+			ab[i] = c[i];
+
+		return;
+	}
+}
+
+
+
+#ifdef UTILITY_SIMD_X86
+namespace {
+	// SSE2, two doubles per register
+	__attribute__((target("sse2")))
+	void VectorAddSse2(long n, const double *x, double *y)
+	{
+		long i = 0;
+		for (; i + 4 <= n; i += 4) {
+			__m128d y0 = _mm_add_pd(_mm_loadu_pd(y + i), _mm_loadu_pd(x + i));
+			__m128d y1 = _mm_add_pd(_mm_loadu_pd(y + i + 2), _mm_loadu_pd(x + i + 2));
+			_mm_storeu_pd(y + i, y0);
+			_mm_storeu_pd(y + i + 2, y1);
+		}
+		for (; i < n; ++i)
+			y[i] += x[i];
+
+		return;
+	}
+
+
+
+	__attribute__((target("sse2")))
+	void VectorScaleSse2(long n, double a, double *y)
+	{
+		__m128d av = _mm_set1_pd(a);
+		long i = 0;
+		for (; i + 4 <= n; i += 4) {
+			_mm_storeu_pd(y + i, _mm_mul_pd(_mm_loadu_pd(y + i), av));
+			_mm_storeu_pd(y + i + 2, _mm_mul_pd(_mm_loadu_pd(y + i + 2), av));
+		}
+		for (; i < n; ++i)
+			y[i] *= a;
+
+		return;
+	}
+
+
+
+	__attribute__((target("sse2")))
+	void VectorZeroSse2(long n, double *y)
+	{
+		__m128d zero = _mm_setzero_pd();
+		long i = 0;
+		for (; i + 4 <= n; i += 4) {
+			_mm_storeu_pd(y + i, zero);
+			_mm_storeu_pd(y + i + 2, zero);
+		}
+		for (; i < n; ++i)
+			y[i] = 0.0;
+
+		return;
+	}
+
+
+
+	__attribute__((target("sse2")))
+	void VectorComplexScaleSse2(long n, double ar, double ai, double *y)
+	{
+		// (re, im) -> (ar re - ai im, ar im + ai re)
+		__m128d arv = _mm_set1_pd(ar);
+		__m128d aiv = _mm_set_pd(ai, -ai);
+		for (long i = 0; i < n; ++i) {
+			__m128d v = _mm_loadu_pd(y + 2 * i);
+			__m128d swapped = _mm_shuffle_pd(v, v, 1);
+			_mm_storeu_pd(y + 2 * i, _mm_add_pd(_mm_mul_pd(arv, v), _mm_mul_pd(aiv, swapped)));
+		}
+
+		return;
+	}
+
+
+
+	__attribute__((target("sse2")))
+	void VectorAxpySse2(long n, double a, const double *x, double *y)
+	{
+		__m128d av = _mm_set1_pd(a);
+		long i = 0;
+		for (; i + 4 <= n; i += 4) {
+			__m128d y0 = _mm_add_pd(_mm_loadu_pd(y + i), _mm_mul_pd(av, _mm_loadu_pd(x + i)));
+			__m128d y1 = _mm_add_pd(_mm_loadu_pd(y + i + 2), _mm_mul_pd(av, _mm_loadu_pd(x + i + 2)));
+			_mm_storeu_pd(y + i, y0);
+			_mm_storeu_pd(y + i + 2, y1);
+		}
+		for (; i < n; ++i)
+			y[i] += a * x[i];
+
+		return;
+	}
+
+
+
+	__attribute__((target("sse2")))
+	double VectorDotSse2(long n, const double *x, const double *y)
+	{
+		__m128d s0 = _mm_setzero_pd();
+		__m128d s1 = _mm_setzero_pd();
+		long i = 0;
+		for (; i + 4 <= n; i += 4) {
+			s0 = _mm_add_pd(s0, _mm_mul_pd(_mm_loadu_pd(x + i), _mm_loadu_pd(y + i)));
+			s1 = _mm_add_pd(s1, _mm_mul_pd(_mm_loadu_pd(x + i + 2), _mm_loadu_pd(y + i + 2)));
+		}
+
+		double sum[2];
+		_mm_storeu_pd(sum, _mm_add_pd(s0, s1));
+		double dot = sum[0] + sum[1];
+		for (; i < n; ++i)
+			dot += x[i] * y[i];
+
+		return dot;
+	}
+
+
+
+	// one complex number per register, the swapped copy of y gives the
+	// cross terms
+	__attribute__((target("sse2")))
+	void VectorComplexDotSse2(long n, const double *x, const double *y, double *sums)
+	{
+		__m128d direct0 = _mm_setzero_pd();
+		__m128d direct1 = _mm_setzero_pd();
+		__m128d cross0 = _mm_setzero_pd();
+		__m128d cross1 = _mm_setzero_pd();
+		long i = 0;
+		for (; i + 2 <= n; i += 2) {
+			__m128d x0 = _mm_loadu_pd(x + 2 * i);
+			__m128d x1 = _mm_loadu_pd(x + 2 * i + 2);
+			__m128d y0 = _mm_loadu_pd(y + 2 * i);
+			__m128d y1 = _mm_loadu_pd(y + 2 * i + 2);
+			direct0 = _mm_add_pd(direct0, _mm_mul_pd(x0, y0));
+			direct1 = _mm_add_pd(direct1, _mm_mul_pd(x1, y1));
+			cross0 = _mm_add_pd(cross0, _mm_mul_pd(x0, _mm_shuffle_pd(y0, y0, 1)));
+			cross1 = _mm_add_pd(cross1, _mm_mul_pd(x1, _mm_shuffle_pd(y1, y1, 1)));
+		}
+
+		double direct[2], cross[2];
+		_mm_storeu_pd(direct, _mm_add_pd(direct0, direct1));
+		_mm_storeu_pd(cross, _mm_add_pd(cross0, cross1));
+		sums[0] = direct[0];
+		sums[1] = direct[1];
+		sums[2] = cross[0];
+		sums[3] = cross[1];
+		for (; i < n; ++i) {
+			double xr = x[2 * i];
+			double xi = x[2 * i + 1];
+			double yr = y[2 * i];
+			double yi = y[2 * i + 1];
+			sums[0] += xr * yr;
+			sums[1] += xi * yi;
+			sums[2] += xr * yi;
+			sums[3] += xi * yr;
+		}
+
+		return;
+	}
+
+
+
+	__attribute__((target("sse2")))
+	double VectorDistanceSquaredSse2(long n, const double *x, const double *y)
+	{
+		__m128d s0 = _mm_setzero_pd();
+		__m128d s1 = _mm_setzero_pd();
+		long i = 0;
+		for (; i + 4 <= n; i += 4) {
+			__m128d d0 = _mm_sub_pd(_mm_loadu_pd(x + i), _mm_loadu_pd(y + i));
+			__m128d d1 = _mm_sub_pd(_mm_loadu_pd(x + i + 2), _mm_loadu_pd(y + i + 2));
+			s0 = _mm_add_pd(s0, _mm_mul_pd(d0, d0));
+			s1 = _mm_add_pd(s1, _mm_mul_pd(d1, d1));
+		}
+
+		double sum[2];
+		_mm_storeu_pd(sum, _mm_add_pd(s0, s1));
+
+		double distance = sum[0] + sum[1];
+		for (; i < n; ++i)
+			distance += (x[i] - y[i]) * (x[i] - y[i]);
+
+		return distance;
+	}
+
+
+
+	// 4 x 4 block in 8 registers
+	const long SSE2_MR = 4;
+	const long SSE2_NR = 4;
+
+	__attribute__((target("sse2")))
+	void MicroKernelSse2(long kc, const double *a, const double *b, double *ab)
+	{
+		__m128d c00 = _mm_setzero_pd(), c01 = _mm_setzero_pd();
+		__m128d c10 = _mm_setzero_pd(), c11 = _mm_setzero_pd();
+		__m128d c20 = _mm_setzero_pd(), c21 = _mm_setzero_pd();
+		__m128d c30 = _mm_setzero_pd(), c31 = _mm_setzero_pd();
+
+		for (long p = 0; p < kc; ++p) {
+			__m128d b0 = _mm_loadu_pd(b);
+			__m128d b1 = _mm_loadu_pd(b + 2);
+			__m128d ai;
+
+			ai = _mm_set1_pd(a[0]);
+			c00 = _mm_add_pd(c00, _mm_mul_pd(ai, b0));
+			c01 = _mm_add_pd(c01, _mm_mul_pd(ai, b1));
+			ai = _mm_set1_pd(a[1]);
+			c10 = _mm_add_pd(c10, _mm_mul_pd(ai, b0));
+			c11 = _mm_add_pd(c11, _mm_mul_pd(ai, b1));
+			ai = _mm_set1_pd(a[2]);
+			c20 = _mm_add_pd(c20, _mm_mul_pd(ai, b0));
+			c21 = _mm_add_pd(c21, _mm_mul_pd(ai, b1));
+			ai = _mm_set1_pd(a[3]);
+			c30 = _mm_add_pd(c30, _mm_mul_pd(ai, b0));
+			c31 = _mm_add_pd(c31, _mm_mul_pd(ai, b1));
+
+			a += SSE2_MR;
+			b += SSE2_NR;
+		}
+
+		_mm_storeu_pd(ab, c00);
+		_mm_storeu_pd(ab + 2, c01);
+		_mm_storeu_pd(ab + 4, c10);
+		_mm_storeu_pd(ab + 6, c11);
+		_mm_storeu_pd(ab + 8, c20);
+		_mm_storeu_pd(ab + 10, c21);
+		_mm_storeu_pd(ab + 12, c30);
+		_mm_storeu_pd(ab + 14, c31);
+
+		return;
+	}
+
+
+
+	// single precision, four floats per register
+	__attribute__((target("sse2")))
+	void VectorAddSse2Float(long n, const float *x, float *y)
+	{
+		long i = 0;
+		for (; i + 8 <= n; i += 8) {
+			__m128 y0 = _mm_add_ps(_mm_loadu_ps(y + i), _mm_loadu_ps(x + i));
+			__m128 y1 = _mm_add_ps(_mm_loadu_ps(y + i + 4), _mm_loadu_ps(x + i + 4));
+			_mm_storeu_ps(y + i, y0);
+			_mm_storeu_ps(y + i + 4, y1);
+		}
+		for (; i < n; ++i)
+			y[i] += x[i];
+
+		return;
+	}
+
+
+
+	__attribute__((target("sse2")))
+	void VectorScaleSse2Float(long n, float a, float *y)
+	{
+		__m128 av = _mm_set1_ps(a);
+		long i = 0;
+		for (; i + 8 <= n; i += 8) {
+			_mm_storeu_ps(y + i, _mm_mul_ps(_mm_loadu_ps(y + i), av));
+			_mm_storeu_ps(y + i + 4, _mm_mul_ps(_mm_loadu_ps(y + i + 4), av));
+		}
+		for (; i < n; ++i)
+			y[i] *= a;
+
+		return;
+	}
+
+
+
+	__attribute__((target("sse2")))
+	void VectorZeroSse2Float(long n, float *y)
+	{
+		__m128 zero = _mm_setzero_ps();
+		long i = 0;
+		for (; i + 8 <= n; i += 8) {
+			_mm_storeu_ps(y + i, zero);
+			_mm_storeu_ps(y + i + 4, zero);
+		}
+		for (; i < n; ++i)
+			y[i] = 0.0f;
+
+		return;
+	}
+
+
+
+	// single precision, 4 x 8 block in 8 registers
+	const long SSE2_FLOAT_MR = 4;
+	const long SSE2_FLOAT_NR = 8;
+
+	__attribute__((target("sse2")))
+	void MicroKernelSse2Float(long kc, const float *a, const float *b, float *ab)
+	{
+		__m128 c00 = _mm_setzero_ps(), c01 = _mm_setzero_ps();
+		__m128 c10 = _mm_setzero_ps(), c11 = _mm_setzero_ps();
+		__m128 c20 = _mm_setzero_ps(), c21 = _mm_setzero_ps();
+		__m128 c30 = _mm_setzero_ps(), c31 = _mm_setzero_ps();
+
+		for (long p = 0; p < kc; ++p) {
+			__m128 b0 = _mm_loadu_ps(b);
+			__m128 b1 = _mm_loadu_ps(b + 4);
+			__m128 ai;
+
+			ai = _mm_set1_ps(a[0]);
+			c00 = _mm_add_ps(c00, _mm_mul_ps(ai, b0));
+			c01 = _mm_add_ps(c01, _mm_mul_ps(ai, b1));
+			ai = _mm_set1_ps(a[1]);
+			c10 = _mm_add_ps(c10, _mm_mul_ps(ai, b0));
+			c11 = _mm_add_ps(c11, _mm_mul_ps(ai, b1));
+			ai = _mm_set1_ps(a[2]);
+			c20 = _mm_add_ps(c20, _mm_mul_ps(ai, b0));
+			c21 = _mm_add_ps(c21, _mm_mul_ps(ai, b1));
+			ai = _mm_set1_ps(a[3]);
+			c30 = _mm_add_ps(c30, _mm_mul_ps(ai, b0));
+			c31 = _mm_add_ps(c31, _mm_mul_ps(ai, b1));
+
+			a += SSE2_FLOAT_MR;
+			b += SSE2_FLOAT_NR;
+		}
+
+		_mm_storeu_ps(ab, c00);
+		_mm_storeu_ps(ab + 4, c01);
+		_mm_storeu_ps(ab + 8, c10);
+		_mm_storeu_ps(ab + 12, c11);
+		_mm_storeu_ps(ab + 16, c20);
+		_mm_storeu_ps(ab + 20, c21);
+		_mm_storeu_ps(ab + 24, c30);
+		_mm_storeu_ps(ab + 28, c31);
+
+		return;
+	}
+
+
+
+	// AVX2 with FMA, four doubles per register
+	__attribute__((target("avx2,fma")))
+	void VectorAddAvx2(long n, const double *x, double *y)
+	{
+		long i = 0;
+		for (; i + 8 <= n; i += 8) {
+			__m256d y0 = _mm256_add_pd(_mm256_loadu_pd(y + i), _mm256_loadu_pd(x + i));
+			__m256d y1 = _mm256_add_pd(_mm256_loadu_pd(y + i + 4), _mm256_loadu_pd(x + i + 4));
+			_mm256_storeu_pd(y + i, y0);
+			_mm256_storeu_pd(y + i + 4, y1);
+		}
+		for (; i < n; ++i)
+			y[i] += x[i];
+
+		return;
+	}
+
+
+
+	__attribute__((target("avx2,fma")))
+	void VectorScaleAvx2(long n, double a, double *y)
+	{
+		__m256d av = _mm256_set1_pd(a);
+		long i = 0;
+		for (; i + 8 <= n; i += 8) {
+			_mm256_storeu_pd(y + i, _mm256_mul_pd(_mm256_loadu_pd(y + i), av));
+			_mm256_storeu_pd(y + i + 4, _mm256_mul_pd(_mm256_loadu_pd(y + i + 4), av));
+		}
+		for (; i < n; ++i)
+			y[i] *= a;
+
+		return;
+	}
+
+
+
+	__attribute__((target("avx2,fma")))
+	void VectorZeroAvx2(long n, double *y)
+	{
+		__m256d zero = _mm256_setzero_pd();
+		long i = 0;
+		for (; i + 8 <= n; i += 8) {
+			_mm256_storeu_pd(y + i, zero);
+			_mm256_storeu_pd(y + i + 4, zero);
+		}
+		for (; i < n; ++i)
+			y[i] = 0.0;
+
+		return;
+	}
+
+
+
+	__attribute__((target("avx2,fma")))
+	void VectorComplexScaleAvx2(long n, double ar, double ai, double *y)
+	{
+		// addsub gives (ar re - ai im, ar im + ai re) from (re, im) and (im, re)
+		__m256d arv = _mm256_set1_pd(ar);
+		__m256d aiv = _mm256_set1_pd(ai);
+		long i = 0;
+		for (; i + 2 <= n; i += 2) {
+			__m256d v = _mm256_loadu_pd(y + 2 * i);
+			__m256d swapped = _mm256_permute_pd(v, 5);
+			_mm256_storeu_pd(y + 2 * i, _mm256_addsub_pd(_mm256_mul_pd(arv, v), _mm256_mul_pd(aiv, swapped)));
+		}
+		if (i < n)
+			VectorComplexScaleScalar(n - i, ar, ai, y + 2 * i);
+
+		return;
+	}
+
+
+
+	__attribute__((target("avx2,fma")))
+	void VectorAxpyAvx2(long n, double a, const double *x, double *y)
+	{
+		__m256d av = _mm256_set1_pd(a);
+		long i = 0;
+		for (; i + 8 <= n; i += 8) {
+			__m256d y0 = _mm256_fmadd_pd(av, _mm256_loadu_pd(x + i), _mm256_loadu_pd(y + i));
+			__m256d y1 = _mm256_fmadd_pd(av, _mm256_loadu_pd(x + i + 4), _mm256_loadu_pd(y + i + 4));
+			_mm256_storeu_pd(y + i, y0);
+			_mm256_storeu_pd(y + i + 4, y1);
+		}
+		for (; i < n; ++i)
+			y[i] += a * x[i];
+
+		return;
+	}
+
+
+
+	__attribute__((target("avx2,fma")))
+	double VectorDotAvx2(long n, const double *x, const double *y)
+	{
+		// four accumulators cover the fma latency
+		__m256d s0 = _mm256_setzero_pd();
+		__m256d s1 = _mm256_setzero_pd();
+		__m256d s2 = _mm256_setzero_pd();
+		__m256d s3 = _mm256_setzero_pd();
+		long i = 0;
+		for (; i + 16 <= n; i += 16) {
+			s0 = _mm256_fmadd_pd(_mm256_loadu_pd(x + i), _mm256_loadu_pd(y + i), s0);
+			s1 = _mm256_fmadd_pd(_mm256_loadu_pd(x + i + 4), _mm256_loadu_pd(y + i + 4), s1);
+			s2 = _mm256_fmadd_pd(_mm256_loadu_pd(x + i + 8), _mm256_loadu_pd(y + i + 8), s2);
+			s3 = _mm256_fmadd_pd(_mm256_loadu_pd(x + i + 12), _mm256_loadu_pd(y + i + 12), s3);
+		}
+
+		double sum[4];
+		_mm256_storeu_pd(sum, _mm256_add_pd(_mm256_add_pd(s0, s1), _mm256_add_pd(s2, s3)));
+		double dot = (sum[0] + sum[1]) + (sum[2] + sum[3]);
+		for (; i < n; ++i)
+			dot += x[i] * y[i];
+
+		return dot;
+	}
+
+
+
+	__attribute__((target("avx2,fma")))
+	void VectorComplexDotAvx2(long n, const double *x, const double *y, double *sums)
+	{
+		__m256d direct0 = _mm256_setzero_pd();
+		__m256d direct1 = _mm256_setzero_pd();
+		__m256d cross0 = _mm256_setzero_pd();
+		__m256d cross1 = _mm256_setzero_pd();
+		long i = 0;
+		for (; i + 4 <= n; i += 4) {
+			__m256d x0 = _mm256_loadu_pd(x + 2 * i);
+			__m256d x1 = _mm256_loadu_pd(x + 2 * i + 4);
+			__m256d y0 = _mm256_loadu_pd(y + 2 * i);
+			__m256d y1 = _mm256_loadu_pd(y + 2 * i + 4);
+			direct0 = _mm256_fmadd_pd(x0, y0, direct0);
+			direct1 = _mm256_fmadd_pd(x1, y1, direct1);
+			cross0 = _mm256_fmadd_pd(x0, _mm256_permute_pd(y0, 0x5), cross0);
+			cross1 = _mm256_fmadd_pd(x1, _mm256_permute_pd(y1, 0x5), cross1);
+		}
+
+		double direct[4], cross[4];
+		_mm256_storeu_pd(direct, _mm256_add_pd(direct0, direct1));
+		_mm256_storeu_pd(cross, _mm256_add_pd(cross0, cross1));
+		sums[0] = direct[0] + direct[2];
+		sums[1] = direct[1] + direct[3];
+		sums[2] = cross[0] + cross[2];
+		sums[3] = cross[1] + cross[3];
+		for (; i < n; ++i) {
+			double xr = x[2 * i];
+			double xi = x[2 * i + 1];
+			double yr = y[2 * i];
+			double yi = y[2 * i + 1];
+			sums[0] += xr * yr;
+			sums[1] += xi * yi;
+			sums[2] += xr * yi;
+			sums[3] += xi * yr;
+		}
+
+		return;
+	}
+
+
+
+	__attribute__((target("avx2,fma")))
+	double VectorDistanceSquaredAvx2(long n, const double *x, const double *y)
+	{
+		__m256d s0 = _mm256_setzero_pd();
+		__m256d s1 = _mm256_setzero_pd();
+		long i = 0;
+		for (; i + 8 <= n; i += 8) {
+			__m256d d0 = _mm256_sub_pd(_mm256_loadu_pd(x + i), _mm256_loadu_pd(y + i));
+			__m256d d1 = _mm256_sub_pd(_mm256_loadu_pd(x + i + 4), _mm256_loadu_pd(y + i + 4));
+			s0 = _mm256_fmadd_pd(d0, d0, s0);
+			s1 = _mm256_fmadd_pd(d1, d1, s1);
+		}
+
+		double sum[4];
+		_mm256_storeu_pd(sum, _mm256_add_pd(s0, s1));
+
+		double distance = (sum[0] + sum[1]) + (sum[2] + sum[3]);
+		for (; i < n; ++i)
+			distance += (x[i] - y[i]) * (x[i] - y[i]);
+
+		return distance;
+	}
+
+
+
+	// 6 x 8 block in 12 registers, leaving room for the two B loads and the
+	// A broadcast
+	const long AVX2_MR = 6;
+	const long AVX2_NR = 8;
+
+	__attribute__((target("avx2,fma")))
+	void MicroKernelAvx2(long kc, const double *a, const double *b, double *ab)
+	{
+		__m256d c00 = _mm256_setzero_pd(), c01 = _mm256_setzero_pd();
+		__m256d c10 = _mm256_setzero_pd(), c11 = _mm256_setzero_pd();
+		__m256d c20 = _mm256_setzero_pd(), c21 = _mm256_setzero_pd();
+		__m256d c30 = _mm256_setzero_pd(), c31 = _mm256_setzero_pd();
+		__m256d c40 = _mm256_setzero_pd(), c41 = _mm256_setzero_pd();
+		__m256d c50 = _mm256_setzero_pd(), c51 = _mm256_setzero_pd();
+
+		for (long p = 0; p < kc; ++p) {
+			__m256d b0 = _mm256_loadu_pd(b);
+			__m256d b1 = _mm256_loadu_pd(b + 4);
+			__m256d ai;
+
+			ai = _mm256_broadcast_sd(a);
+			c00 = _mm256_fmadd_pd(ai, b0, c00);
+			c01 = _mm256_fmadd_pd(ai, b1, c01);
+			ai = _mm256_broadcast_sd(a + 1);
+			c10 = _mm256_fmadd_pd(ai, b0, c10);
+			c11 = _mm256_fmadd_pd(ai, b1, c11);
+			ai = _mm256_broadcast_sd(a + 2);
+			c20 = _mm256_fmadd_pd(ai, b0, c20);
+			c21 = _mm256_fmadd_pd(ai, b1, c21);
+			ai = _mm256_broadcast_sd(a + 3);
+			c30 = _mm256_fmadd_pd(ai, b0, c30);
+			c31 = _mm256_fmadd_pd(ai, b1, c31);
+			ai = _mm256_broadcast_sd(a + 4);
+			c40 = _mm256_fmadd_pd(ai, b0, c40);
+			c41 = _mm256_fmadd_pd(ai, b1, c41);
+			ai = _mm256_broadcast_sd(a + 5);
+			c50 = _mm256_fmadd_pd(ai, b0, c50);
+			c51 = _mm256_fmadd_pd(ai, b1, c51);
+
+			a += AVX2_MR;
+			b += AVX2_NR;
+		}
+
+		_mm256_storeu_pd(ab, c00);
+		_mm256_storeu_pd(ab + 4, c01);
+		_mm256_storeu_pd(ab + 8, c10);
+		_mm256_storeu_pd(ab + 12, c11);
+		_mm256_storeu_pd(ab + 16, c20);
+		_mm256_storeu_pd(ab + 20, c21);
+		_mm256_storeu_pd(ab + 24, c30);
+		_mm256_storeu_pd(ab + 28, c31);
+		_mm256_storeu_pd(ab + 32, c40);
+		_mm256_storeu_pd(ab + 36, c41);
+		_mm256_storeu_pd(ab + 40, c50);
+		_mm256_storeu_pd(ab + 44, c51);
+
+		return;
+	}
+
+
+
+	// single precision, eight floats per register
+	__attribute__((target("avx2,fma")))
+	void VectorAddAvx2Float(long n, const float *x, float *y)
+	{
+		long i = 0;
+		for (; i + 16 <= n; i += 16) {
+			__m256 y0 = _mm256_add_ps(_mm256_loadu_ps(y + i), _mm256_loadu_ps(x + i));
+			__m256 y1 = _mm256_add_ps(_mm256_loadu_ps(y + i + 8), _mm256_loadu_ps(x + i + 8));
+			_mm256_storeu_ps(y + i, y0);
+			_mm256_storeu_ps(y + i + 8, y1);
+		}
+		for (; i < n; ++i)
+			y[i] += x[i];
+
+		return;
+	}
+
+
+
+	__attribute__((target("avx2,fma")))
+	void VectorScaleAvx2Float(long n, float a, float *y)
+	{
+		__m256 av = _mm256_set1_ps(a);
+		long i = 0;
+		for (; i + 16 <= n; i += 16) {
+			_mm256_storeu_ps(y + i, _mm256_mul_ps(_mm256_loadu_ps(y + i), av));
+			_mm256_storeu_ps(y + i + 8, _mm256_mul_ps(_mm256_loadu_ps(y + i + 8), av));
+		}
+		for (; i < n; ++i)
+			y[i] *= a;
+
+		return;
+	}
+
+
+
+	__attribute__((target("avx2,fma")))
+	void VectorZeroAvx2Float(long n, float *y)
+	{
+		__m256 zero = _mm256_setzero_ps();
+		long i = 0;
+		for (; i + 16 <= n; i += 16) {
+			_mm256_storeu_ps(y + i, zero);
+			_mm256_storeu_ps(y + i + 8, zero);
+		}
+		for (; i < n; ++i)
+			y[i] = 0.0f;
+
+		return;
+	}
+
+
+
+	// single precision, 6 x 16 block in 12 registers
+	const long AVX2_FLOAT_MR = 6;
+	const long AVX2_FLOAT_NR = 16;
+
+	__attribute__((target("avx2,fma")))
+	void MicroKernelAvx2Float(long kc, const float *a, const float *b, float *ab)
+	{
+		__m256 c00 = _mm256_setzero_ps(), c01 = _mm256_setzero_ps();
+		__m256 c10 = _mm256_setzero_ps(), c11 = _mm256_setzero_ps();
+		__m256 c20 = _mm256_setzero_ps(), c21 = _mm256_setzero_ps();
+		__m256 c30 = _mm256_setzero_ps(), c31 = _mm256_setzero_ps();
+		__m256 c40 = _mm256_setzero_ps(), c41 = _mm256_setzero_ps();
+		__m256 c50 = _mm256_setzero_ps(), c51 = _mm256_setzero_ps();
+
+		for (long p = 0; p < kc; ++p) {
+			__m256 b0 = _mm256_loadu_ps(b);
+			__m256 b1 = _mm256_loadu_ps(b + 8);
+			__m256 ai;
+
+			ai = _mm256_broadcast_ss(a);
+			c00 = _mm256_fmadd_ps(ai, b0, c00);
+			c01 = _mm256_fmadd_ps(ai, b1, c01);
+			ai = _mm256_broadcast_ss(a + 1);
+			c10 = _mm256_fmadd_ps(ai, b0, c10);
+			c11 = _mm256_fmadd_ps(ai, b1, c11);
+			ai = _mm256_broadcast_ss(a + 2);
+			c20 = _mm256_fmadd_ps(ai, b0, c20);
+			c21 = _mm256_fmadd_ps(ai, b1, c21);
+			ai = _mm256_broadcast_ss(a + 3);
+			c30 = _mm256_fmadd_ps(ai, b0, c30);
+			c31 = _mm256_fmadd_ps(ai, b1, c31);
+			ai = _mm256_broadcast_ss(a + 4);
+			c40 = _mm256_fmadd_ps(ai, b0, c40);
+			c41 = _mm256_fmadd_ps(ai, b1, c41);
+			ai = _mm256_broadcast_ss(a + 5);
+			c50 = _mm256_fmadd_ps(ai, b0, c50);
+			c51 = _mm256_fmadd_ps(ai, b1, c51);
+
+			a += AVX2_FLOAT_MR;
+			b += AVX2_FLOAT_NR;
+		}
+
+		_mm256_storeu_ps(ab, c00);
+		_mm256_storeu_ps(ab + 8, c01);
+		_mm256_storeu_ps(ab + 16, c10);
+		_mm256_storeu_ps(ab + 24, c11);
+		_mm256_storeu_ps(ab + 32, c20);
+		_mm256_storeu_ps(ab + 40, c21);
+		_mm256_storeu_ps(ab + 48, c30);
+		_mm256_storeu_ps(ab + 56, c31);
+		_mm256_storeu_ps(ab + 64, c40);
+		_mm256_storeu_ps(ab + 72, c41);
+		_mm256_storeu_ps(ab + 80, c50);
+		_mm256_storeu_ps(ab + 88, c51);
+
+		return;
+	}
+
+
+
+	// AVX-512, eight doubles per register
+	__attribute__((target("avx512f")))
+	void VectorAddAvx512(long n, const double *x, double *y)
+	{
+		long i = 0;
+		for (; i + 16 <= n; i += 16) {
+			__m512d y0 = _mm512_add_pd(_mm512_loadu_pd(y + i), _mm512_loadu_pd(x + i));
+			__m512d y1 = _mm512_add_pd(_mm512_loadu_pd(y + i + 8), _mm512_loadu_pd(x + i + 8));
+			_mm512_storeu_pd(y + i, y0);
+			_mm512_storeu_pd(y + i + 8, y1);
+		}
+		for (; i < n; ++i)
+			y[i] += x[i];
+
+		return;
+	}
+
+
+
+	__attribute__((target("avx512f")))
+	void VectorScaleAvx512(long n, double a, double *y)
+	{
+		__m512d av = _mm512_set1_pd(a);
+		long i = 0;
+		for (; i + 16 <= n; i += 16) {
+			_mm512_storeu_pd(y + i, _mm512_mul_pd(_mm512_loadu_pd(y + i), av));
+			_mm512_storeu_pd(y + i + 8, _mm512_mul_pd(_mm512_loadu_pd(y + i + 8), av));
+		}
+		for (; i < n; ++i)
+			y[i] *= a;
+
+		return;
+	}
+
+
+
+	__attribute__((target("avx512f")))
+	void VectorZeroAvx512(long n, double *y)
+	{
+		__m512d zero = _mm512_setzero_pd();
+		long i = 0;
+		for (; i + 16 <= n; i += 16) {
+			_mm512_storeu_pd(y + i, zero);
+			_mm512_storeu_pd(y + i + 8, zero);
+		}
+		for (; i < n; ++i)
+			y[i] = 0.0;
+
+		return;
+	}
+
+
+
+	__attribute__((target("avx512f")))
+	void VectorComplexScaleAvx512(long n, double ar, double ai, double *y)
+	{
+		// aiv alternates -ai, +ai so one fma finishes each pair
+		__m512d arv = _mm512_set1_pd(ar);
+		__m512d aiv = _mm512_set_pd(ai, -ai, ai, -ai, ai, -ai, ai, -ai);
+		long i = 0;
+		for (; i + 4 <= n; i += 4) {
+			__m512d v = _mm512_loadu_pd(y + 2 * i);
+			__m512d swapped = _mm512_permute_pd(v, 0x55);
+			_mm512_storeu_pd(y + 2 * i, _mm512_fmadd_pd(arv, v, _mm512_mul_pd(aiv, swapped)));
+		}
+		if (i < n)
+			VectorComplexScaleScalar(n - i, ar, ai, y + 2 * i);
+
+		return;
+	}
+
+
+
+	__attribute__((target("avx512f")))
+	void VectorAxpyAvx512(long n, double a, const double *x, double *y)
+	{
+		__m512d av = _mm512_set1_pd(a);
+		long i = 0;
+		for (; i + 16 <= n; i += 16) {
+			__m512d y0 = _mm512_fmadd_pd(av, _mm512_loadu_pd(x + i), _mm512_loadu_pd(y + i));
+			__m512d y1 = _mm512_fmadd_pd(av, _mm512_loadu_pd(x + i + 8), _mm512_loadu_pd(y + i + 8));
+			_mm512_storeu_pd(y + i, y0);
+			_mm512_storeu_pd(y + i + 8, y1);
+		}
+		for (; i < n; ++i)
+			y[i] += a * x[i];
+
+		return;
+	}
+
+
+
+	__attribute__((target("avx512f")))
+	double VectorDotAvx512(long n, const double *x, const double *y)
+	{
+		__m512d s0 = _mm512_setzero_pd();
+		__m512d s1 = _mm512_setzero_pd();
+		__m512d s2 = _mm512_setzero_pd();
+		__m512d s3 = _mm512_setzero_pd();
+		long i = 0;
+		for (; i + 32 <= n; i += 32) {
+			s0 = _mm512_fmadd_pd(_mm512_loadu_pd(x + i), _mm512_loadu_pd(y + i), s0);
+			s1 = _mm512_fmadd_pd(_mm512_loadu_pd(x + i + 8), _mm512_loadu_pd(y + i + 8), s1);
+			s2 = _mm512_fmadd_pd(_mm512_loadu_pd(x + i + 16), _mm512_loadu_pd(y + i + 16), s2);
+			s3 = _mm512_fmadd_pd(_mm512_loadu_pd(x + i + 24), _mm512_loadu_pd(y + i + 24), s3);
+		}
+
+		double dot = _mm512_reduce_add_pd(_mm512_add_pd(_mm512_add_pd(s0, s1), _mm512_add_pd(s2, s3)));
+		for (; i < n; ++i)
+			dot += x[i] * y[i];
+
+		return dot;
+	}
+
+
+
+	__attribute__((target("avx512f")))
+	void VectorComplexDotAvx512(long n, const double *x, const double *y, double *sums)
+	{
+		__m512d direct0 = _mm512_setzero_pd();
+		__m512d direct1 = _mm512_setzero_pd();
+		__m512d cross0 = _mm512_setzero_pd();
+		__m512d cross1 = _mm512_setzero_pd();
+		long i = 0;
+		for (; i + 8 <= n; i += 8) {
+			__m512d x0 = _mm512_loadu_pd(x + 2 * i);
+			__m512d x1 = _mm512_loadu_pd(x + 2 * i + 8);
+			__m512d y0 = _mm512_loadu_pd(y + 2 * i);
+			__m512d y1 = _mm512_loadu_pd(y + 2 * i + 8);
+			direct0 = _mm512_fmadd_pd(x0, y0, direct0);
+			direct1 = _mm512_fmadd_pd(x1, y1, direct1);
+			cross0 = _mm512_fmadd_pd(x0, _mm512_permute_pd(y0, 0x55), cross0);
+			cross1 = _mm512_fmadd_pd(x1, _mm512_permute_pd(y1, 0x55), cross1);
+		}
+
+		// the real parts are in the even lanes
+		__m512d direct = _mm512_add_pd(direct0, direct1);
+		__m512d cross = _mm512_add_pd(cross0, cross1);
+		sums[0] = _mm512_mask_reduce_add_pd(0x55, direct);
+		sums[1] = _mm512_mask_reduce_add_pd(0xAA, direct);
+		sums[2] = _mm512_mask_reduce_add_pd(0x55, cross);
+		sums[3] = _mm512_mask_reduce_add_pd(0xAA, cross);
+		for (; i < n; ++i) {
+			double xr = x[2 * i];
+			double xi = x[2 * i + 1];
+			double yr = y[2 * i];
+			double yi = y[2 * i + 1];
+			sums[0] += xr * yr;
+			sums[1] += xi * yi;
+			sums[2] += xr * yi;
+			sums[3] += xi * yr;
+		}
+
+		return;
+	}
+
+
+
+	__attribute__((target("avx512f")))
+	double VectorDistanceSquaredAvx512(long n, const double *x, const double *y)
+	{
+		__m512d s0 = _mm512_setzero_pd();
+		__m512d s1 = _mm512_setzero_pd();
+		long i = 0;
+		for (; i + 16 <= n; i += 16) {
+			__m512d d0 = _mm512_sub_pd(_mm512_loadu_pd(x + i), _mm512_loadu_pd(y + i));
+			__m512d d1 = _mm512_sub_pd(_mm512_loadu_pd(x + i + 8), _mm512_loadu_pd(y + i + 8));
+			s0 = _mm512_fmadd_pd(d0, d0, s0);
+			s1 = _mm512_fmadd_pd(d1, d1, s1);
+		}
+
+		double distance = _mm512_reduce_add_pd(_mm512_add_pd(s0, s1));
+		for (; i < n; ++i)
+			distance += (x[i] - y[i]) * (x[i] - y[i]);
+
+		return distance;
+	}
+
+
+
+	// 8 x 16 block in 16 of the 32 registers
+	const long AVX512_MR = 8;
+	const long AVX512_NR = 16;
+
+	__attribute__((target("avx512f")))
+	void MicroKernelAvx512(long kc, const double *a, const double *b, double *ab)
+	{
+		__m512d c00 = _mm512_setzero_pd(), c01 = _mm512_setzero_pd();
+		__m512d c10 = _mm512_setzero_pd(), c11 = _mm512_setzero_pd();
+		__m512d c20 = _mm512_setzero_pd(), c21 = _mm512_setzero_pd();
+		__m512d c30 = _mm512_setzero_pd(), c31 = _mm512_setzero_pd();
+		__m512d c40 = _mm512_setzero_pd(), c41 = _mm512_setzero_pd();
+		__m512d c50 = _mm512_setzero_pd(), c51 = _mm512_setzero_pd();
+		__m512d c60 = _mm512_setzero_pd(), c61 = _mm512_setzero_pd();
+		__m512d c70 = _mm512_setzero_pd(), c71 = _mm512_setzero_pd();
+
+		for (long p = 0; p < kc; ++p) {
+			__m512d b0 = _mm512_loadu_pd(b);
+			__m512d b1 = _mm512_loadu_pd(b + 8);
+			__m512d ai;
+
+			ai = _mm512_set1_pd(a[0]);
+			c00 = _mm512_fmadd_pd(ai, b0, c00);
+			c01 = _mm512_fmadd_pd(ai, b1, c01);
+			ai = _mm512_set1_pd(a[1]);
+			c10 = _mm512_fmadd_pd(ai, b0, c10);
+			c11 = _mm512_fmadd_pd(ai, b1, c11);
+			ai = _mm512_set1_pd(a[2]);
+			c20 = _mm512_fmadd_pd(ai, b0, c20);
+			c21 = _mm512_fmadd_pd(ai, b1, c21);
+			ai = _mm512_set1_pd(a[3]);
+			c30 = _mm512_fmadd_pd(ai, b0, c30);
+			c31 = _mm512_fmadd_pd(ai, b1, c31);
+			ai = _mm512_set1_pd(a[4]);
+			c40 = _mm512_fmadd_pd(ai, b0, c40);
+			c41 = _mm512_fmadd_pd(ai, b1, c41);
+			ai = _mm512_set1_pd(a[5]);
+			c50 = _mm512_fmadd_pd(ai, b0, c50);
+			c51 = _mm512_fmadd_pd(ai, b1, c51);
+			ai = _mm512_set1_pd(a[6]);
+			c60 = _mm512_fmadd_pd(ai, b0, c60);
+			c61 = _mm512_fmadd_pd(ai, b1, c61);
+			ai = _mm512_set1_pd(a[7]);
+			c70 = _mm512_fmadd_pd(ai, b0, c70);
+			c71 = _mm512_fmadd_pd(ai, b1, c71);
+
+			a += AVX512_MR;
+			b += AVX512_NR;
+		}
+
+		_mm512_storeu_pd(ab, c00);
+		_mm512_storeu_pd(ab + 8, c01);
+		_mm512_storeu_pd(ab + 16, c10);
+		_mm512_storeu_pd(ab + 24, c11);
+		_mm512_storeu_pd(ab + 32, c20);
+		_mm512_storeu_pd(ab + 40, c21);
+		_mm512_storeu_pd(ab + 48, c30);
+		_mm512_storeu_pd(ab + 56, c31);
+		_mm512_storeu_pd(ab + 64, c40);
+		_mm512_storeu_pd(ab + 72, c41);
+		_mm512_storeu_pd(ab + 80, c50);
+		_mm512_storeu_pd(ab + 88, c51);
+		_mm512_storeu_pd(ab + 96, c60);
+		_mm512_storeu_pd(ab + 104, c61);
+		_mm512_storeu_pd(ab + 112, c70);
+		_mm512_storeu_pd(ab + 120, c71);
+
+		return;
+	}
+
+
+
+	// single precision, sixteen floats per register
+	__attribute__((target("avx512f")))
+	void VectorAddAvx512Float(long n, const float *x, float *y)
+	{
+		long i = 0;
+		for (; i + 32 <= n; i += 32) {
+			__m512 y0 = _mm512_add_ps(_mm512_loadu_ps(y + i), _mm512_loadu_ps(x + i));
+			__m512 y1 = _mm512_add_ps(_mm512_loadu_ps(y + i + 16), _mm512_loadu_ps(x + i + 16));
+			_mm512_storeu_ps(y + i, y0);
+			_mm512_storeu_ps(y + i + 16, y1);
+		}
+		for (; i < n; ++i)
+			y[i] += x[i];
+
+		return;
+	}
+
+
+
+	__attribute__((target("avx512f")))
+	void VectorScaleAvx512Float(long n, float a, float *y)
+	{
+		__m512 av = _mm512_set1_ps(a);
+		long i = 0;
+		for (; i + 32 <= n; i += 32) {
+			_mm512_storeu_ps(y + i, _mm512_mul_ps(_mm512_loadu_ps(y + i), av));
+			_mm512_storeu_ps(y + i + 16, _mm512_mul_ps(_mm512_loadu_ps(y + i + 16), av));
+		}
+		for (; i < n; ++i)
+			y[i] *= a;
+
+		return;
+	}
+
+
+
+	__attribute__((target("avx512f")))
+	void VectorZeroAvx512Float(long n, float *y)
+	{
+		__m512 zero = _mm512_setzero_ps();
+		long i = 0;
+		for (; i + 32 <= n; i += 32) {
+			_mm512_storeu_ps(y + i, zero);
+			_mm512_storeu_ps(y + i + 16, zero);
+		}
+		for (; i < n; ++i)
+			y[i] = 0.0f;
+
+		return;
+	}
+
+
+
+	// single precision, 8 x 32 block in 16 registers
+	const long AVX512_FLOAT_MR = 8;
+	const long AVX512_FLOAT_NR = 32;
+
+	__attribute__((target("avx512f")))
+	void MicroKernelAvx512Float(long kc, const float *a, const float *b, float *ab)
+	{
+		__m512 c00 = _mm512_setzero_ps(), c01 = _mm512_setzero_ps();
+		__m512 c10 = _mm512_setzero_ps(), c11 = _mm512_setzero_ps();
+		__m512 c20 = _mm512_setzero_ps(), c21 = _mm512_setzero_ps();
+		__m512 c30 = _mm512_setzero_ps(), c31 = _mm512_setzero_ps();
+		__m512 c40 = _mm512_setzero_ps(), c41 = _mm512_setzero_ps();
+		__m512 c50 = _mm512_setzero_ps(), c51 = _mm512_setzero_ps();
+		__m512 c60 = _mm512_setzero_ps(), c61 = _mm512_setzero_ps();
+		__m512 c70 = _mm512_setzero_ps(), c71 = _mm512_setzero_ps();
+
+		for (long p = 0; p < kc; ++p) {
+			__m512 b0 = _mm512_loadu_ps(b);
+			__m512 b1 = _mm512_loadu_ps(b + 16);
+			__m512 ai;
+
+			ai = _mm512_set1_ps(a[0]);
+			c00 = _mm512_fmadd_ps(ai, b0, c00);
+			c01 = _mm512_fmadd_ps(ai, b1, c01);
+			ai = _mm512_set1_ps(a[1]);
+			c10 = _mm512_fmadd_ps(ai, b0, c10);
+			c11 = _mm512_fmadd_ps(ai, b1, c11);
+			ai = _mm512_set1_ps(a[2]);
+			c20 = _mm512_fmadd_ps(ai, b0, c20);
+			c21 = _mm512_fmadd_ps(ai, b1, c21);
+			ai = _mm512_set1_ps(a[3]);
+			c30 = _mm512_fmadd_ps(ai, b0, c30);
+			c31 = _mm512_fmadd_ps(ai, b1, c31);
+			ai = _mm512_set1_ps(a[4]);
+			c40 = _mm512_fmadd_ps(ai, b0, c40);
+			c41 = _mm512_fmadd_ps(ai, b1, c41);
+			ai = _mm512_set1_ps(a[5]);
+			c50 = _mm512_fmadd_ps(ai, b0, c50);
+			c51 = _mm512_fmadd_ps(ai, b1, c51);
+			ai = _mm512_set1_ps(a[6]);
+			c60 = _mm512_fmadd_ps(ai, b0, c60);
+			c61 = _mm512_fmadd_ps(ai, b1, c61);
+			ai = _mm512_set1_ps(a[7]);
+			c70 = _mm512_fmadd_ps(ai, b0, c70);
+			c71 = _mm512_fmadd_ps(ai, b1, c71);
+
+			a += AVX512_FLOAT_MR;
+			b += AVX512_FLOAT_NR;
+		}
+
+		_mm512_storeu_ps(ab, c00);
+		_mm512_storeu_ps(ab + 16, c01);
+		_mm512_storeu_ps(ab + 32, c10);
+		_mm512_storeu_ps(ab + 48, c11);
+		_mm512_storeu_ps(ab + 64, c20);
+		_mm512_storeu_ps(ab + 80, c21);
+		_mm512_storeu_ps(ab + 96, c30);
+		_mm512_storeu_ps(ab + 112, c31);
+		_mm512_storeu_ps(ab + 128, c40);
+		_mm512_storeu_ps(ab + 144, c41);
+		_mm512_storeu_ps(ab + 160, c50);
+		_mm512_storeu_ps(ab + 176, c51);
+		_mm512_storeu_ps(ab + 192, c60);
+		_mm512_storeu_ps(ab + 208, c61);
+		_mm512_storeu_ps(ab + 224, c70);
+		_mm512_storeu_ps(ab + 240, c71);
+
+		return;
+	}
+}
+#endif // UTILITY_SIMD_X86
+
+
+
+namespace {
+	// the kernels in use
+	struct SimdDispatch {
+		SimdInstructionSet instructionSet;
+		void (*vectorAdd)(long, const double*, double*);
+		void (*vectorScale)(long, double, double*);
+		void (*vectorZero)(long, double*);
+		void (*vectorComplexScale)(long, double, double, double*);
+		void (*vectorAxpy)(long, double, const double*, double*);
+		double (*vectorDot)(long, const double*, const double*);
+		void (*vectorComplexDot)(long, const double*, const double*, double*);
+		double (*vectorDistanceSquared)(long, const double*, const double*);
+		void (*vectorAddFloat)(long, const float*, float*);
+		void (*vectorScaleFloat)(long, float, float*);
+		void (*vectorZeroFloat)(long, float*);
+		GemmMicroKernel gemmMicroKernel;
+		GemmMicroKernelFloat gemmMicroKernelFloat;
+	};
+
+
+
+	SimdDispatch MakeDispatch(SimdInstructionSet instructionSet)
+	{
+		SimdDispatch d;
+
+		d.instructionSet = SIMD_SCALAR;
+		d.vectorAdd = VectorAddScalar;
+		d.vectorScale = VectorScaleScalar;
+		d.vectorZero = VectorZeroScalar;
+		d.vectorComplexScale = VectorComplexScaleScalar;
+		d.vectorAxpy = VectorAxpyScalar;
+		d.vectorDot = VectorDotScalar;
+		d.vectorComplexDot = VectorComplexDotScalar;
+		d.vectorDistanceSquared = VectorDistanceSquaredScalar;
+		d.vectorAddFloat = VectorAddScalarFloat;
+		d.vectorScaleFloat = VectorScaleScalarFloat;
+		d.vectorZeroFloat = VectorZeroScalarFloat;
+		d.gemmMicroKernel.mr = SCALAR_MR;
+		d.gemmMicroKernel.nr = SCALAR_NR;
+		d.gemmMicroKernel.function = MicroKernelScalar;
+		d.gemmMicroKernelFloat.mr = SCALAR_FLOAT_MR;
+		d.gemmMicroKernelFloat.nr = SCALAR_FLOAT_NR;
+		d.gemmMicroKernelFloat.function = MicroKernelScalarFloat;
+
+#ifdef UTILITY_SIMD_X86
+		switch (instructionSet) {
+		case SIMD_AVX512:
+			d.instructionSet = SIMD_AVX512;
+			d.vectorAdd = VectorAddAvx512;
+			d.vectorScale = VectorScaleAvx512;
+			d.vectorZero = VectorZeroAvx512;
+			d.vectorComplexScale = VectorComplexScaleAvx512;
+			d.vectorAxpy = VectorAxpyAvx512;
+			d.vectorDot = VectorDotAvx512;
+			d.vectorComplexDot = VectorComplexDotAvx512;
+			d.vectorDistanceSquared = VectorDistanceSquaredAvx512;
+			d.vectorAddFloat = VectorAddAvx512Float;
+			d.vectorScaleFloat = VectorScaleAvx512Float;
+			d.vectorZeroFloat = VectorZeroAvx512Float;
+			d.gemmMicroKernel.mr = AVX512_MR;
+			d.gemmMicroKernel.nr = AVX512_NR;
+			d.gemmMicroKernel.function = MicroKernelAvx512;
+			d.gemmMicroKernelFloat.mr = AVX512_FLOAT_MR;
+			d.gemmMicroKernelFloat.nr = AVX512_FLOAT_NR;
+			d.gemmMicroKernelFloat.function = MicroKernelAvx512Float;
+			break;
+
+		case SIMD_AVX2:
+			d.instructionSet = SIMD_AVX2;
+			d.vectorAdd = VectorAddAvx2;
+			d.vectorScale = VectorScaleAvx2;
+			d.vectorZero = VectorZeroAvx2;
+			d.vectorComplexScale = VectorComplexScaleAvx2;
+			d.vectorAxpy = VectorAxpyAvx2;
+			d.vectorDot = VectorDotAvx2;
+			d.vectorComplexDot = VectorComplexDotAvx2;
+			d.vectorDistanceSquared = VectorDistanceSquaredAvx2;
+			d.vectorAddFloat = VectorAddAvx2Float;
+			d.vectorScaleFloat = VectorScaleAvx2Float;
+			d.vectorZeroFloat = VectorZeroAvx2Float;
+			d.gemmMicroKernel.mr = AVX2_MR;
+			d.gemmMicroKernel.nr = AVX2_NR;
+			d.gemmMicroKernel.function = MicroKernelAvx2;
+			d.gemmMicroKernelFloat.mr = AVX2_FLOAT_MR;
+			d.gemmMicroKernelFloat.nr = AVX2_FLOAT_NR;
+			d.gemmMicroKernelFloat.function = MicroKernelAvx2Float;
+			break;
+
+		case SIMD_SSE2:
+			d.instructionSet = SIMD_SSE2;
+			d.vectorAdd = VectorAddSse2;
+			d.vectorScale = VectorScaleSse2;
+			d.vectorZero = VectorZeroSse2;
+			d.vectorComplexScale = VectorComplexScaleSse2;
+			d.vectorAxpy = VectorAxpySse2;
+			d.vectorDot = VectorDotSse2;
+			d.vectorComplexDot = VectorComplexDotSse2;
+			d.vectorDistanceSquared = VectorDistanceSquaredSse2;
+			d.vectorAddFloat = VectorAddSse2Float;
+			d.vectorScaleFloat = VectorScaleSse2Float;
+			d.vectorZeroFloat = VectorZeroSse2Float;
+			d.gemmMicroKernel.mr = SSE2_MR;
+			d.gemmMicroKernel.nr = SSE2_NR;
+			d.gemmMicroKernel.function = MicroKernelSse2;
+			d.gemmMicroKernelFloat.mr = SSE2_FLOAT_MR;
+			d.gemmMicroKernelFloat.nr = SSE2_FLOAT_NR;
+			d.gemmMicroKernelFloat.function = MicroKernelSse2Float;
+			break;
+
+		default:
+			break;
+		}
+#endif
+
+		return d;
+	}
+
+
+
+	// detection runs once, the first time a kernel is called
+	SimdDispatch& Dispatch()
+	{
+		static SimdDispatch dispatch = MakeDispatch(DetectSimdInstructionSet());
+		return dispatch;
+	}
+}
+
+
+
+namespace utility {
+SimdInstructionSet DetectSimdInstructionSet()
+{
+#ifdef UTILITY_SIMD_X86
+	__builtin_cpu_init();
+
+	if (__builtin_cpu_supports("avx512f"))
+		return SIMD_AVX512;
+
+	if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+		return SIMD_AVX2;
+
+	if (__builtin_cpu_supports("sse2"))
+		return SIMD_SSE2;
+#endif
+
+	return SIMD_SCALAR;
+}
+
+
+
+SimdInstructionSet CurrentSimdInstructionSet()
+{
+	return Dispatch().instructionSet;
+}
+
+
+
+void SetSimdInstructionSet(SimdInstructionSet instructionSet)
+{
+	// never select something the processor can't run
+	SimdInstructionSet supported = DetectSimdInstructionSet();
+	if (instructionSet > supported)
+		instructionSet = supported;
+
+	Dispatch() = MakeDispatch(instructionSet);
+
+	return;
+}
+
+
+
+void VectorAdd(long n, const double *x, double *y)
+{
+	Dispatch().vectorAdd(n, x, y);
+	return;
+}
+
+
+
+void VectorScale(long n, double a, double *y)
+{
+	Dispatch().vectorScale(n, a, y);
+	return;
+}
+
+
+
+void VectorZero(long n, double *y)
+{
+	Dispatch().vectorZero(n, y);
+	return;
+}
+
+
+
+void VectorComplexScale(long n, double ar, double ai, double *y)
+{
+	Dispatch().vectorComplexScale(n, ar, ai, y);
+	return;
+}
+
+
+
+void VectorAxpy(long n, double a, const double *x, double *y)
+{
+	Dispatch().vectorAxpy(n, a, x, y);
+	return;
+}
+
+
+
+double VectorDot(long n, const double *x, const double *y)
+{
+	return Dispatch().vectorDot(n, x, y);
+}
+
+
+
+void VectorComplexDot(long n, const double *x, const double *y, double *dot)
+{
+	double sums[4];
+	Dispatch().vectorComplexDot(n, x, y, sums);
+	dot[0] = sums[0] + sums[1];
+	dot[1] = sums[2] - sums[3];
+
+	return;
+}
+
+
+
+void VectorComplexDotUnconjugated(long n, const double *x, const double *y, double *dot)
+{
+	double sums[4];
+	Dispatch().vectorComplexDot(n, x, y, sums);
+	dot[0] = sums[0] - sums[1];
+	dot[1] = sums[2] + sums[3];
+
+	return;
+}
+
+
+
+double VectorDistanceSquared(long n, const double *x, const double *y)
+{
+	return Dispatch().vectorDistanceSquared(n, x, y);
+}
+
+
+
+void VectorAdd(long n, const float *x, float *y)
+{
+	Dispatch().vectorAddFloat(n, x, y);
+	return;
+}
+
+
+
+void VectorScale(long n, float a, float *y)
+{
+	Dispatch().vectorScaleFloat(n, a, y);
+	return;
+}
+
+
+
+void VectorZero(long n, float *y)
+{
+	Dispatch().vectorZeroFloat(n, y);
+	return;
+}
+
+
+
+GemmMicroKernel CurrentGemmMicroKernel()
+{
+	return Dispatch().gemmMicroKernel;
+}
+
+
+
+GemmMicroKernelFloat CurrentGemmMicroKernelFloat()
+{
+	return Dispatch().gemmMicroKernelFloat;
+}
+}
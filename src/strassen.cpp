@@ -0,0 +1,275 @@
+/*
+ * Copyright (C) 2004-2018 David Bernstein <david.h.bernstein@gmail.com>
+ *
+ * This file is part of utility_cpp.
+ *
+ * utility_cpp is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * utility_cpp is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with utility_cpp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "strassen.h"
+#include "gemm.h"
+#include "parallel.h"
+
+using namespace utility;
+using namespace std;
+
+// One level splits A, B and C into 2 x 2 blocks and computes
+//     S1 = A21 + A22   S2 = S1 - A11   S3 = A11 - A21   S4 = A12 - S2
+//     T1 = B12 - B11   T2 = B22 - T1   T3 = B22 - B12   T4 = T2 - B21
+//     P1 = A11 B11     P2 = A12 B21    P3 = S4 B22      P4 = A22 T4
+//     P5 = S1 T1       P6 = S2 T2      P7 = S3 T3
+//     C11 = P1 + P2                    C12 = P1 + P6 + P5 + P3
+//     C21 = P1 + P6 + P7 - P4          C22 = P1 + P6 + P7 + P5
+// in the order of Douglas, Heroux, Slishman and Smith (1994), which keeps
+// the P's in the quadrants of C and needs only two temporaries per level,
+// X (half rows by half of the larger of k and n) and Y (half k by half n).
+// The recursion below a level uses the workspace after that level's X and Y.
+
+namespace {
+	inline double One(const double *)
+	{
+		return 1.0;
+	}
+
+
+
+	inline ComplexNumber One(const ComplexNumber *)
+	{
+		return ComplexNumber(1.0, 0.0);
+	}
+
+
+
+	inline double Zero(const double *)
+	{
+		return 0.0;
+	}
+
+
+
+	inline ComplexNumber Zero(const ComplexNumber *)
+	{
+		return ComplexNumber(0.0, 0.0);
+	}
+
+
+
+	// c = a + b, c may be a or b
+	template<class T>
+	void Add(long m, long n, const T *a, long lda, const T *b, long ldb, T *c, long ldc)
+	{
+		#pragma omp parallel for num_threads(NumThreads()) if (UseThreads((double) m * n))
+		for (long i = 0; i < m; ++i) {
+			const T *aRow = a + i * lda;
+			const T *bRow = b + i * ldb;
+			T *cRow = c + i * ldc;
+			for (long j = 0; j < n; ++j)
+				cRow[j] = aRow[j] + bRow[j];
+		}
+
+		return;
+	}
+
+
+
+	// c = a - b, c may be a or b
+	template<class T>
+	void Subtract(long m, long n, const T *a, long lda, const T *b, long ldb, T *c, long ldc)
+	{
+		#pragma omp parallel for num_threads(NumThreads()) if (UseThreads((double) m * n))
+		for (long i = 0; i < m; ++i) {
+			const T *aRow = a + i * lda;
+			const T *bRow = b + i * ldb;
+			T *cRow = c + i * ldc;
+			for (long j = 0; j < n; ++j)
+				cRow[j] = aRow[j] - bRow[j];
+		}
+
+		return;
+	}
+
+
+
+	// c = a b for m x k times k x n
+	template<class T>
+	void Winograd(long m, long n, long k, const T *a, long lda, const T *b, long ldb, T *c, long ldc,
+				  T *work, long crossover)
+	{
+		if ((m <= crossover) || (n <= crossover) || (k <= crossover)) {
+			Gemm(m, n, k, One(a), a, lda, b, ldb, Zero(a), c, ldc);
+			return;
+		}
+
+		long hm = m / 2;
+		long hn = n / 2;
+		long hk = k / 2;
+
+		const T *a11 = a;
+		const T *a12 = a + hk;
+		const T *a21 = a + hm * lda;
+		const T *a22 = a21 + hk;
+		const T *b11 = b;
+		const T *b12 = b + hn;
+		const T *b21 = b + hk * ldb;
+		const T *b22 = b21 + hn;
+		T *c11 = c;
+		T *c12 = c + hn;
+		T *c21 = c + hm * ldc;
+		T *c22 = c21 + hn;
+
+		long ldx = (hk > hn) ? hk : hn;
+		T *x = work;
+		T *y = x + hm * ldx;
+		T *next = y + hk * hn;
+
+		Subtract(hm, hk, a11, lda, a21, lda, x, ldx);                 // X = S3
+		Subtract(hk, hn, b22, ldb, b12, ldb, y, hn);                  // Y = T3
+		Winograd(hm, hn, hk, x, ldx, y, hn, c21, ldc, next, crossover);    // C21 = P7
+		Add(hm, hk, a21, lda, a22, lda, x, ldx);                      // X = S1
+		Subtract(hk, hn, b12, ldb, b11, ldb, y, hn);                  // Y = T1
+		Winograd(hm, hn, hk, x, ldx, y, hn, c22, ldc, next, crossover);    // C22 = P5
+		Subtract(hm, hk, x, ldx, a11, lda, x, ldx);                   // X = S2
+		Subtract(hk, hn, b22, ldb, y, hn, y, hn);                     // Y = T2
+		Winograd(hm, hn, hk, x, ldx, y, hn, c12, ldc, next, crossover);    // C12 = P6
+		Subtract(hm, hk, a12, lda, x, ldx, x, ldx);                   // X = S4
+		Winograd(hm, hn, hk, x, ldx, b22, ldb, c11, ldc, next, crossover); // C11 = P3
+		Winograd(hm, hn, hk, a11, lda, b11, ldb, x, ldx, next, crossover); // X = P1
+		Add(hm, hn, x, ldx, c12, ldc, c12, ldc);                      // C12 = P1 + P6
+		Add(hm, hn, c12, ldc, c21, ldc, c21, ldc);                    // C21 = C12 + P7
+		Add(hm, hn, c12, ldc, c22, ldc, c12, ldc);                    // C12 = C12 + P5
+		Add(hm, hn, c21, ldc, c22, ldc, c22, ldc);                    // C22 = C21 + P5
+		Add(hm, hn, c12, ldc, c11, ldc, c12, ldc);                    // C12 = C12 + P3
+		Subtract(hk, hn, y, hn, b21, ldb, y, hn);                     // Y = T4
+		Winograd(hm, hn, hk, a22, lda, y, hn, c11, ldc, next, crossover);  // C11 = P4
+		Subtract(hm, hn, c21, ldc, c11, ldc, c21, ldc);               // C21 = C21 - P4
+		Winograd(hm, hn, hk, a12, lda, b21, ldb, c11, ldc, next, crossover); // C11 = P2
+		Add(hm, hn, x, ldx, c11, ldc, c11, ldc);                      // C11 = P1 + P2
+
+		// an odd dimension leaves a last row of C, a last column of C or a
+		// rank one update of the even part
+		if (k > 2 * hk)
+			Gemm(2 * hm, 2 * hn, 1, One(a), a + 2 * hk, lda, b + 2 * hk * ldb, ldb, One(a), c, ldc);
+
+		if (n > 2 * hn)
+			Gemm(m, 1, k, One(a), a, lda, b + 2 * hn, ldb, Zero(a), c + 2 * hn, ldc);
+
+		if (m > 2 * hm)
+			Gemm(1, 2 * hn, k, One(a), a + 2 * hm * lda, lda, b, ldb, Zero(a), c + 2 * hm * ldc, ldc);
+
+		return;
+	}
+}
+
+
+
+StrassenMultiplier::StrassenMultiplier(long crossover)
+{
+	SetCrossover(crossover);
+	return;
+}
+
+
+
+void StrassenMultiplier::SetCrossover(long crossover)
+{
+	// below a few dozen the additions cost more than the products they save
+	if (crossover < 16)
+		ThrowException("StrassenMultiplier::SetCrossover : crossover must be at least 16");
+
+	mCrossover = crossover;
+	return;
+}
+
+
+
+long StrassenMultiplier::WorkspaceSize(long m, long n, long k) const
+{
+	long size = 0;
+	while ((m > mCrossover) && (n > mCrossover) && (k > mCrossover)) {
+		m /= 2;
+		n /= 2;
+		k /= 2;
+		size += m * ((k > n) ? k : n) + k * n;
+	}
+
+	return size;
+}
+
+
+
+void StrassenMultiplier::Reserve(long m, long n, long k, bool complex)
+{
+	long size = WorkspaceSize(m, n, k);
+	if (complex)
+		size *= 2;
+
+	if (size > mWorkspace.Size())
+		mWorkspace.SetSize(size);
+
+	return;
+}
+
+
+
+void StrassenMultiplier::Multiply(long m, long n, long k, const double *a, long lda, const double *b, long ldb,
+								  double *c, long ldc)
+{
+	Reserve(m, n, k);
+	Winograd(m, n, k, a, lda, b, ldb, c, ldc, mWorkspace.Begin(), mCrossover);
+	return;
+}
+
+
+
+void StrassenMultiplier::Multiply(long m, long n, long k, const ComplexNumber *a, long lda, const ComplexNumber *b,
+								  long ldb, ComplexNumber *c, long ldc)
+{
+	Reserve(m, n, k, true);
+	Winograd(m, n, k, a, lda, b, ldb, c, ldc, reinterpret_cast<ComplexNumber*>(mWorkspace.Begin()), mCrossover);
+	return;
+}
+
+
+
+void StrassenMultiplier::Multiply(const Matrix<double> &a, const Matrix<double> &b, Matrix<double> &c)
+{
+	if (a.NumColumns() != b.NumRows())
+		ThrowException("StrassenMultiplier::Multiply : matrices are wrong size");
+
+	if ((&c == &a) || (&c == &b))
+		ThrowException("StrassenMultiplier::Multiply : product overwrites a factor");
+
+	c.SetSize(a.NumRows(), b.NumColumns());
+	Multiply(a.NumRows(), b.NumColumns(), a.NumColumns(), a.Data(), a.Stride(), b.Data(), b.Stride(),
+			 c.Data(), c.Stride());
+
+	return;
+}
+
+
+
+void StrassenMultiplier::Multiply(const ComplexMatrix &a, const ComplexMatrix &b, ComplexMatrix &c)
+{
+	if (a.NumColumns() != b.NumRows())
+		ThrowException("StrassenMultiplier::Multiply : matrices are wrong size");
+
+	if ((&c == &a) || (&c == &b))
+		ThrowException("StrassenMultiplier::Multiply : product overwrites a factor");
+
+	c.SetSize(a.NumRows(), b.NumColumns());
+	Multiply(a.NumRows(), b.NumColumns(), a.NumColumns(), a.Data(), a.Stride(), b.Data(), b.Stride(),
+			 c.Data(), c.Stride());
+
+	return;
+}
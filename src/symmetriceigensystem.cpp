@@ -0,0 +1,1033 @@
+/*
+ * Copyright (C) 2004-2018 David Bernstein <david.h.bernstein@gmail.com>
+ *
+ * This file is part of utility_cpp.
+ *
+ * utility_cpp is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * utility_cpp is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with utility_cpp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "symmetriceigensystem.h"
+#include "gemm.h"
+#include "parallel.h"
+
+#include <algorithm>
+#include <float.h>
+#include <math.h>
+
+using namespace utility;
+using namespace std;
+
+// The reduction to tridiagonal form is blocked as in LAPACK's dsytrd: the
+// reflectors of a panel of TRIDIAGONAL_BLOCK columns are generated one at a
+// time, keeping the update A - V W^T - W V^T they imply as the two n x kb
+// matrices V and W, and the trailing matrix is updated once per panel with
+// GEMMs. Half of the work is still the symmetric matrix-vector product for
+// each reflector, which is split among the threads by rows.
+//
+// Divide and conquer splits T into two halves coupled by a rank one term,
+// solves the halves recursively and merges them by solving the secular
+// equation 1 + rho sum z_i^2 / (d_i - lambda) = 0. The eigenvectors of the
+// merge are built from z recomputed with the Gu-Eisenstat formula, which
+// keeps them orthogonal without extra precision, and are combined with
+// those of the halves in one GEMM. Nearly all of the O(n^3) work is in
+// these GEMMs and in applying Q, also done with GEMMs in compact WY form.
+
+namespace {
+	// columns of a panel in the reduction, and reflectors applied at once to
+	// the eigenvectors
+	const long TRIDIAGONAL_BLOCK = 32;
+
+	// rows of the trailing matrix updated by one pair of GEMMs
+	const long TRIDIAGONAL_UPDATE_BLOCK = 128;
+
+	// problems up to this size are solved with QL in divide and conquer
+	const long DIVIDE_AND_CONQUER_LEAF = 32;
+
+	// QL sweeps allowed per eigenvalue
+	const long QL_MAX_ITERATIONS = 30;
+
+	// iterations of the secular equation root finder and of inverse iteration
+	const long SECULAR_MAX_ITERATIONS = 100;
+	const long INVERSE_ITERATIONS = 5;
+
+	// eigenvalues closer than this times |T| share a cluster whose vectors
+	// are orthogonalized against each other in inverse iteration
+	const double CLUSTER_TOLERANCE = 1.0e-3;
+
+
+
+	inline long Min(long a, long b)
+	{
+		return (a < b) ? a : b;
+	}
+
+
+
+	inline double Sign(double x)
+	{
+		return (x < 0.0) ? -1.0 : 1.0;
+	}
+
+
+
+	// orders indices by the values they refer to
+	class ValueOrder {
+	public:
+		ValueOrder(const double *values) : mValues(values) { };
+
+		bool operator()(long i, long j) const
+		{
+			return mValues[i] < mValues[j];
+		}
+
+	private:
+		const double *mValues;
+	};
+
+
+
+	// turns x into a Householder vector v with v[0] = 1 so that
+	// (I - tau v v^T) x = (beta, 0, ..., 0)
+	void MakeHouseholder(long n, double *x, double &beta, double &tau)
+	{
+		double alpha = x[0];
+		double sigma = 0.0;
+		for (long i = 1; i < n; ++i)
+			sigma += x[i] * x[i];
+
+		x[0] = 1.0;
+		if (sigma == 0.0) {
+			beta = alpha;
+			tau = 0.0;
+			return;
+		}
+
+		double norm = sqrt(alpha * alpha + sigma);
+		beta = (alpha <= 0.0) ? norm : -norm;
+		tau = (beta - alpha) / beta;
+
+		double scale = 1.0 / (alpha - beta);
+		for (long i = 1; i < n; ++i)
+			x[i] *= scale;
+
+		return;
+	}
+
+
+
+	// p = A u for the symmetric n x n block at a, reading only its lower
+	// triangle so every element is loaded once, each row adds to p[r] (a dot
+	// product) and to p[0:r] (an axpy), the axpys of different threads go to
+	// separate rows of partial which are summed at the end
+	void SymmetricMatrixVector(long n, const double *a, long lda, const double *u, double *p, Array<double> &partial)
+	{
+		bool useThreads = UseThreads((double) n * n);
+		long numThreads = useThreads ? NumThreads() : 1;
+		partial.SetSize(numThreads * n);
+		double *sums = partial.Begin();
+		for (long i = 0; i < numThreads * n; ++i)
+			sums[i] = 0.0;
+
+		#pragma omp parallel num_threads(numThreads) if (useThreads)
+		{
+			double *mine = sums + ThreadIndex() * n;
+
+			#pragma omp for schedule(dynamic, 32)
+			for (long r = 0; r < n; ++r) {
+				const double *row = a + r * lda;
+				double ur = u[r];
+				double s0 = 0.0, s1 = 0.0, s2 = 0.0, s3 = 0.0;
+
+				long c = 0;
+				for (; c + 4 <= r; c += 4) {
+					s0 += row[c] * u[c];
+					s1 += row[c + 1] * u[c + 1];
+					s2 += row[c + 2] * u[c + 2];
+					s3 += row[c + 3] * u[c + 3];
+					mine[c] += row[c] * ur;
+					mine[c + 1] += row[c + 1] * ur;
+					mine[c + 2] += row[c + 2] * ur;
+					mine[c + 3] += row[c + 3] * ur;
+				}
+
+				for (; c < r; ++c) {
+					s0 += row[c] * u[c];
+					mine[c] += row[c] * ur;
+				}
+
+				mine[r] += (s0 + s1) + (s2 + s3) + row[r] * ur;
+			}
+		}
+
+		for (long i = 0; i < n; ++i) {
+			double sum = 0.0;
+			for (long thread = 0; thread < numThreads; ++thread)
+				sum += sums[thread * n + i];
+			p[i] = sum;
+		}
+
+		return;
+	}
+
+
+
+	// reduces the symmetric n x n matrix a (lower triangle) to tridiagonal
+	// form, reflector j acts on rows j + 1 to n - 1 and its vector is left in
+	// column j of a below the diagonal
+	void Tridiagonalize(long n, double *a, long lda, double *d, double *e, double *tau)
+	{
+		const long ldv = TRIDIAGONAL_BLOCK;
+		Array<double> vBuffer(n * ldv), wBuffer(n * ldv);
+		Array<double> x(n), p(n), y1(ldv), y2(ldv), transpose, partial;
+		double *v = vBuffer.Begin();
+		double *w = wBuffer.Begin();
+
+		for (long k = 0; k < n - 1; k += TRIDIAGONAL_BLOCK) {
+			long kb = Min(TRIDIAGONAL_BLOCK, n - 1 - k);
+
+			for (long r = k; r < n; ++r) {
+				for (long q = 0; q < ldv; ++q) {
+					v[r * ldv + q] = 0.0;
+					w[r * ldv + q] = 0.0;
+				}
+			}
+
+			for (long i = 0; i < kb; ++i) {
+				long j = k + i;
+				long length = n - j - 1;
+
+				// bring column j up to date with the reflectors of the panel
+				for (long r = j; r < n; ++r) {
+					double sum = 0.0;
+					for (long q = 0; q < i; ++q)
+						sum += v[r * ldv + q] * w[j * ldv + q] + w[r * ldv + q] * v[j * ldv + q];
+					a[r * lda + j] -= sum;
+				}
+
+				d[j] = a[j * lda + j];
+
+				double *u = x.Begin();
+				for (long r = 0; r < length; ++r)
+					u[r] = a[(j + 1 + r) * lda + j];
+				MakeHouseholder(length, u, e[j], tau[j]);
+
+				for (long r = 0; r < length; ++r) {
+					a[(j + 1 + r) * lda + j] = u[r];
+					v[(j + 1 + r) * ldv + i] = u[r];
+				}
+
+				// p = tau (A v - V W^T v - W V^T v) on the trailing rows, A
+				// being the matrix as of the start of the panel
+				for (long q = 0; q < i; ++q) {
+					double sum1 = 0.0, sum2 = 0.0;
+					for (long r = 0; r < length; ++r) {
+						sum1 += w[(j + 1 + r) * ldv + q] * u[r];
+						sum2 += v[(j + 1 + r) * ldv + q] * u[r];
+					}
+					y1[q] = sum1;
+					y2[q] = sum2;
+				}
+
+				double t = tau[j];
+				double *pj = p.Begin();
+				SymmetricMatrixVector(length, a + (j + 1) * lda + j + 1, lda, u, pj, partial);
+
+				for (long r = 0; r < length; ++r) {
+					double sum = pj[r];
+					for (long q = 0; q < i; ++q)
+						sum -= v[(j + 1 + r) * ldv + q] * y1[q] + w[(j + 1 + r) * ldv + q] * y2[q];
+					pj[r] = t * sum;
+				}
+
+				// w = p - (tau / 2) (p^T v) v
+				double pv = 0.0;
+				for (long r = 0; r < length; ++r)
+					pv += p[r] * u[r];
+
+				double alpha = -0.5 * t * pv;
+				for (long r = 0; r < length; ++r)
+					w[(j + 1 + r) * ldv + i] = p[r] + alpha * u[r];
+			}
+
+			// A22 -= V W^T + W V^T on and below the diagonal, a block row at a
+			// time as in the Cholesky update
+			long t0 = k + kb;
+			long m = n - t0;
+			transpose.SetSize(2 * kb * m);
+			double *wt = transpose.Begin();
+			double *vt = wt + kb * m;
+
+			for (long r = 0; r < m; ++r) {
+				for (long q = 0; q < kb; ++q) {
+					wt[q * m + r] = w[(t0 + r) * ldv + q];
+					vt[q * m + r] = v[(t0 + r) * ldv + q];
+				}
+			}
+
+			double *a22 = a + t0 * lda + t0;
+			for (long i0 = 0; i0 < m; i0 += TRIDIAGONAL_UPDATE_BLOCK) {
+				long ib = Min(TRIDIAGONAL_UPDATE_BLOCK, m - i0);
+				Gemm(ib, i0 + ib, kb, -1.0, v + (t0 + i0) * ldv, ldv, wt, m, 1.0, a22 + i0 * lda, lda);
+				Gemm(ib, i0 + ib, kb, -1.0, w + (t0 + i0) * ldv, ldv, vt, m, 1.0, a22 + i0 * lda, lda);
+			}
+		}
+
+		d[n - 1] = a[(n - 1) * lda + n - 1];
+
+		return;
+	}
+
+
+
+	// z = Q z for the n x m block z, Q being the product of the reflectors
+	// left by Tridiagonalize, applied TRIDIAGONAL_BLOCK reflectors at a time
+	// as I - V T V^T
+	void ApplyReflectors(long n, const double *a, long lda, const double *tau, double *z, long ldz, long m)
+	{
+		if ((n < 2) || (m == 0))
+			return;
+
+		Array<double> vt, vs, t, column, x, y;
+		long lastBlock = ((n - 2) / TRIDIAGONAL_BLOCK) * TRIDIAGONAL_BLOCK;
+
+		for (long k = lastBlock; k >= 0; k -= TRIDIAGONAL_BLOCK) {
+			long kb = Min(TRIDIAGONAL_BLOCK, n - 1 - k);
+			long r0 = k + 1;
+			long length = n - r0;
+
+			// V^T, kb x length, and V
+			vt.SetSize(kb * length);
+			vs.SetSize(length * kb);
+			for (long i = 0; i < kb; ++i) {
+				for (long r = 0; r < length; ++r) {
+					double value = (r >= i) ? a[(r0 + r) * lda + k + i] : 0.0;
+					vt[i * length + r] = value;
+					vs[r * kb + i] = value;
+				}
+			}
+
+			// T column by column, T(0:i, i) = -tau_i T(0:i, 0:i) V(:, 0:i)^T v_i
+			t.SetSize(kb * kb);
+			column.SetSize(kb);
+			for (long i = 0; i < kb * kb; ++i)
+				t[i] = 0.0;
+
+			for (long i = 0; i < kb; ++i) {
+				double taui = tau[k + i];
+				for (long q = 0; q < i; ++q) {
+					double sum = 0.0;
+					for (long r = i; r < length; ++r)
+						sum += vt[q * length + r] * vt[i * length + r];
+					column[q] = -taui * sum;
+				}
+
+				for (long q = 0; q < i; ++q) {
+					double sum = 0.0;
+					for (long s = q; s < i; ++s)
+						sum += t[q * kb + s] * column[s];
+					t[q * kb + i] = sum;
+				}
+
+				t[i * kb + i] = taui;
+			}
+
+			// z = z - V (T (V^T z))
+			x.SetSize(kb * m);
+			y.SetSize(kb * m);
+			double *zBlock = z + r0 * ldz;
+			Gemm(kb, m, length, 1.0, vt.Begin(), length, zBlock, ldz, 0.0, x.Begin(), m);
+			Gemm(kb, m, kb, 1.0, t.Begin(), kb, x.Begin(), m, 0.0, y.Begin(), m);
+			Gemm(length, m, kb, -1.0, vs.Begin(), kb, y.Begin(), m, 1.0, zBlock, ldz);
+		}
+
+		return;
+	}
+
+
+
+	// implicit QL on the tridiagonal matrix with diagonal d and off-diagonal
+	// e (e[i] couples i and i + 1, e[n - 1] is not used), the eigenvalues
+	// replace d in no particular order and the rotations are applied to the
+	// columns of the numRows x n block z if there is one
+	void TridiagonalQL(long n, double *d, double *e, double *z, long ldz, long numRows)
+	{
+		if (n == 0)
+			return;
+
+		e[n - 1] = 0.0;
+
+		for (long l = 0; l < n; ++l) {
+			long iteration = 0;
+			long m;
+
+			do {
+				for (m = l; m < n - 1; ++m) {
+					double dd = fabs(d[m]) + fabs(d[m + 1]);
+					if (fabs(e[m]) <= DBL_EPSILON * dd)
+						break;
+				}
+
+				if (m == l)
+					break;
+
+				if (++iteration > QL_MAX_ITERATIONS)
+					ThrowException("SymmetricEigensystem : QL iteration failed to converge");
+
+				double g = (d[l + 1] - d[l]) / (2.0 * e[l]);
+				double r = hypot(g, 1.0);
+				g = d[m] - d[l] + e[l] / (g + ((g < 0.0) ? -r : r));
+
+				double s = 1.0, c = 1.0, p = 0.0;
+				long i;
+				for (i = m - 1; i >= l; --i) {
+					double f = s * e[i];
+					double b = c * e[i];
+					r = hypot(f, g);
+					e[i + 1] = r;
+					if (r == 0.0) {
+						d[i + 1] -= p;
+						e[m] = 0.0;
+						break;
+					}
+
+					s = f / r;
+					c = g / r;
+					g = d[i + 1] - p;
+					r = (d[i] - g) * s + 2.0 * c * b;
+					p = s * r;
+					d[i + 1] = g + p;
+					g = c * r - b;
+
+					for (long k = 0; k < numRows; ++k) {
+						double *row = z + k * ldz;
+						f = row[i + 1];
+						row[i + 1] = s * row[i] + c * f;
+						row[i] = c * row[i] - s * f;
+					}
+				}
+
+				if ((r == 0.0) && (i >= l))
+					continue;
+
+				d[l] -= p;
+				e[l] = g;
+				e[m] = 0.0;
+			} while (m != l);
+		}
+
+		return;
+	}
+
+
+
+	// sorts the eigenvalues d increasingly along with the columns of q
+	void SortEigenpairs(long n, double *d, double *q, long ldq)
+	{
+		for (long i = 0; i < n - 1; ++i) {
+			long k = i;
+			for (long j = i + 1; j < n; ++j) {
+				if (d[j] < d[k])
+					k = j;
+			}
+
+			if (k == i)
+				continue;
+
+			swap(d[i], d[k]);
+			for (long r = 0; r < n; ++r)
+				swap(q[r * ldq + i], q[r * ldq + k]);
+		}
+
+		return;
+	}
+
+
+
+	// the root of the secular equation 1 + rho sum z2_j / (d_j - lambda) = 0
+	// in (d_i, d_i+1), or in (d_k-1, d_k-1 + rho) for the last one, returned
+	// as lambda = d[origin] + tau with the origin the nearer pole so that
+	// lambda - d_j can be formed accurately later
+	void SecularRoot(long k, const double *d, const double *z2, double rho, long i, long &origin, double &tau)
+	{
+		double lo, hi;
+
+		if (i < k - 1) {
+			double half = 0.5 * (d[i + 1] - d[i]);
+			double f = 1.0;
+			for (long j = 0; j < k; ++j)
+				f += rho * z2[j] / ((d[j] - d[i]) - half);
+
+			if (f >= 0.0) {
+				origin = i;
+				lo = 0.0;
+				hi = half;
+			}
+			else {
+				origin = i + 1;
+				lo = -half;
+				hi = 0.0;
+			}
+		}
+		else {
+			double sum = 0.0;
+			for (long j = 0; j < k; ++j)
+				sum += z2[j];
+
+			origin = k - 1;
+			lo = 0.0;
+			hi = rho * sum;
+		}
+
+		// Newton's method, falling back on bisection whenever a step would
+		// leave the bracket
+		tau = 0.5 * (lo + hi);
+		double dOrigin = d[origin];
+
+		for (long iteration = 0; iteration < SECULAR_MAX_ITERATIONS; ++iteration) {
+			if (hi - lo <= 2.0 * DBL_EPSILON * max(fabs(lo), fabs(hi)))
+				break;
+
+			double f = 1.0, derivative = 0.0, magnitude = 1.0;
+			for (long j = 0; j < k; ++j) {
+				double difference = (d[j] - dOrigin) - tau;
+				double term = rho * z2[j] / difference;
+				f += term;
+				derivative += term / difference;
+				magnitude += fabs(term);
+			}
+
+			if (f < 0.0)
+				lo = tau;
+			else
+				hi = tau;
+
+			if (fabs(f) <= 4.0 * DBL_EPSILON * k * magnitude)
+				break;
+
+			double next = tau - f / derivative;
+			if (!((next > lo) && (next < hi)))
+				next = 0.5 * (lo + hi);
+
+			if (next == tau)
+				break;
+
+			tau = next;
+		}
+
+		return;
+	}
+
+
+
+	// replaces the eigenpairs (d, q) of diag(T1, T2), the n x n q holding the
+	// eigenvectors of the halves in its diagonal blocks, with those of
+	// diag(T1, T2) + rho u u^T, u = e_m-1 + sign e_m, rho >= 0
+	void MergeRankOne(long n, long m, double *d, double rho, double sign, double *q, long ldq)
+	{
+		// z = Q^T u, normalized with its length moved into rho
+		Array<double> z(n);
+		for (long i = 0; i < m; ++i)
+			z[i] = q[(m - 1) * ldq + i];
+		for (long i = m; i < n; ++i)
+			z[i] = sign * q[m * ldq + i];
+
+		double zNorm = 0.0;
+		for (long i = 0; i < n; ++i)
+			zNorm += z[i] * z[i];
+		rho *= zNorm;
+		zNorm = sqrt(zNorm);
+		for (long i = 0; i < n; ++i)
+			z[i] /= zNorm;
+
+		// everything in increasing order of d
+		Array<long> order(n);
+		for (long i = 0; i < n; ++i)
+			order[i] = i;
+		sort(order.Begin(), order.Begin() + n, ValueOrder(d));
+
+		Array<double> ds(n), zs(n), qs(n * n);
+		for (long i = 0; i < n; ++i) {
+			ds[i] = d[order[i]];
+			zs[i] = z[order[i]];
+		}
+
+		for (long r = 0; r < n; ++r) {
+			const double *row = q + r * ldq;
+			double *sortedRow = qs.Begin() + r * n;
+			for (long i = 0; i < n; ++i)
+				sortedRow[i] = row[order[i]];
+		}
+
+		// deflation, a negligible component of z leaves an eigenpair of the
+		// halves as it is, and of two nearly equal d one is made to deflate
+		// with a rotation
+		double dMax = 0.0;
+		for (long i = 0; i < n; ++i)
+			dMax = max(dMax, fabs(ds[i]));
+		double tolerance = 8.0 * DBL_EPSILON * max(dMax, rho);
+
+		Array<bool> deflated(n);
+		long last = -1;
+		for (long j = 0; j < n; ++j) {
+			deflated[j] = false;
+			if (rho * fabs(zs[j]) <= tolerance) {
+				deflated[j] = true;
+				continue;
+			}
+
+			if (last >= 0) {
+				double length = hypot(zs[last], zs[j]);
+				double c = zs[j] / length;
+				double s = zs[last] / length;
+
+				if (fabs(c * s * (ds[last] - ds[j])) <= tolerance) {
+					for (long r = 0; r < n; ++r) {
+						double *row = qs.Begin() + r * n;
+						double qLast = row[last];
+						row[last] = c * qLast - s * row[j];
+						row[j] = s * qLast + c * row[j];
+					}
+
+					double dLast = ds[last];
+					ds[last] = c * c * dLast + s * s * ds[j];
+					ds[j] = s * s * dLast + c * c * ds[j];
+					zs[last] = 0.0;
+					zs[j] = length;
+					deflated[last] = true;
+				}
+			}
+
+			last = j;
+		}
+
+		// the secular equation for the rest
+		Array<long> kept(n);
+		long k = 0;
+		for (long j = 0; j < n; ++j) {
+			if (!deflated[j])
+				kept[k++] = j;
+		}
+
+		Array<double> dk(k), z2(k), zHat(k), tau(k), lambda(n), u(k * k);
+		Array<long> origin(k);
+		for (long j = 0; j < k; ++j) {
+			dk[j] = ds[kept[j]];
+			z2[j] = zs[kept[j]] * zs[kept[j]];
+		}
+
+		#pragma omp parallel for num_threads(NumThreads()) if (UseThreads((double) k * k * 32.0))
+		for (long i = 0; i < k; ++i)
+			SecularRoot(k, dk.Begin(), z2.Begin(), rho, i, origin[i], tau[i]);
+
+		// z recomputed from the roots, so that the eigenvectors built from it
+		// are orthogonal to working precision (Gu and Eisenstat)
+		#pragma omp parallel for num_threads(NumThreads()) if (UseThreads((double) k * k * 32.0))
+		for (long j = 0; j < k; ++j) {
+			double product = ((dk[origin[j]] - dk[j]) + tau[j]) / rho;
+			for (long i = 0; i < k; ++i) {
+				if (i != j)
+					product *= ((dk[origin[i]] - dk[j]) + tau[i]) / (dk[i] - dk[j]);
+			}
+
+			double root = sqrt(max(product, 0.0));
+			zHat[j] = (zs[kept[j]] < 0.0) ? -root : root;
+		}
+
+		#pragma omp parallel for num_threads(NumThreads()) if (UseThreads((double) k * k * 32.0))
+		for (long i = 0; i < k; ++i) {
+			double norm = 0.0;
+			for (long j = 0; j < k; ++j) {
+				double value = zHat[j] / ((dk[j] - dk[origin[i]]) - tau[i]);
+				u[j * k + i] = value;
+				norm += value * value;
+			}
+
+			norm = 1.0 / sqrt(norm);
+			for (long j = 0; j < k; ++j)
+				u[j * k + i] *= norm;
+		}
+
+		// the new eigenvectors are the kept columns of qs times u
+		Array<double> x(n * k), y(n * k);
+		for (long r = 0; r < n; ++r) {
+			for (long j = 0; j < k; ++j)
+				x[r * k + j] = qs[r * n + kept[j]];
+		}
+		Gemm(n, k, k, 1.0, x.Begin(), k, u.Begin(), k, 0.0, y.Begin(), k);
+
+		// put the new and the deflated pairs together in increasing order,
+		// new pair i is numbered i and deflated pair j is numbered k + j
+		Array<long> source(n);
+		long numDeflated = 0;
+		for (long i = 0; i < k; ++i) {
+			lambda[i] = dk[origin[i]] + tau[i];
+			source[i] = i;
+		}
+
+		for (long j = 0; j < n; ++j) {
+			if (deflated[j]) {
+				lambda[k + numDeflated] = ds[j];
+				source[k + numDeflated] = k + numDeflated;
+				kept[numDeflated++] = j;
+			}
+		}
+
+		sort(source.Begin(), source.Begin() + n, ValueOrder(lambda.Begin()));
+
+		for (long i = 0; i < n; ++i)
+			d[i] = lambda[source[i]];
+
+		for (long r = 0; r < n; ++r) {
+			double *row = q + r * ldq;
+			for (long i = 0; i < n; ++i) {
+				long s = source[i];
+				row[i] = (s < k) ? y[r * k + s] : qs[r * n + kept[s - k]];
+			}
+		}
+
+		return;
+	}
+
+
+
+	// eigenvalues d (increasing) and eigenvectors q of the tridiagonal matrix
+	// with diagonal d and off-diagonal e, e is overwritten
+	void DivideAndConquer(long n, double *d, double *e, double *q, long ldq)
+	{
+		if (n <= DIVIDE_AND_CONQUER_LEAF) {
+			Array<double> offDiagonal(n);
+			for (long i = 0; i < n - 1; ++i)
+				offDiagonal[i] = e[i];
+
+			for (long r = 0; r < n; ++r) {
+				for (long c = 0; c < n; ++c)
+					q[r * ldq + c] = (r == c) ? 1.0 : 0.0;
+			}
+
+			TridiagonalQL(n, d, offDiagonal.Begin(), q, ldq, n);
+			SortEigenpairs(n, d, q, ldq);
+			return;
+		}
+
+		// T = diag(T1, T2) + rho u u^T with the coupling taken out of the
+		// diagonal elements next to it
+		long m = n / 2;
+		double rho = fabs(e[m - 1]);
+		double sign = Sign(e[m - 1]);
+		d[m - 1] -= rho;
+		d[m] -= rho;
+
+		DivideAndConquer(m, d, e, q, ldq);
+		DivideAndConquer(n - m, d + m, e + m, q + m * ldq + m, ldq);
+
+		for (long r = 0; r < m; ++r) {
+			for (long c = m; c < n; ++c)
+				q[r * ldq + c] = 0.0;
+		}
+
+		for (long r = m; r < n; ++r) {
+			for (long c = 0; c < m; ++c)
+				q[r * ldq + c] = 0.0;
+		}
+
+		MergeRankOne(n, m, d, rho, sign, q, ldq);
+
+		return;
+	}
+
+
+
+	// the number of eigenvalues of the tridiagonal matrix less than x, from
+	// the signs of the pivots of T - x I (Sturm sequence)
+	long EigenvaluesBelow(long n, const double *d, const double *e, double x)
+	{
+		long count = 0;
+		double pivot = d[0] - x;
+		if (pivot < 0.0)
+			++count;
+
+		for (long i = 1; i < n; ++i) {
+			if (fabs(pivot) < DBL_MIN)
+				pivot = -DBL_MIN;
+			pivot = (d[i] - x) - e[i - 1] * e[i - 1] / pivot;
+			if (pivot < 0.0)
+				++count;
+		}
+
+		return count;
+	}
+
+
+
+	// eigenvalue number index (counting up from 0) of the tridiagonal matrix
+	// by bisection between the Gershgorin bounds lo and hi
+	double BisectEigenvalue(long n, const double *d, const double *e, long index, double lo, double hi)
+	{
+		while (hi - lo > 2.0 * DBL_EPSILON * (fabs(lo) + fabs(hi)) + DBL_MIN) {
+			double middle = 0.5 * (lo + hi);
+			if ((middle == lo) || (middle == hi))
+				break;
+
+			if (EigenvaluesBelow(n, d, e, middle) > index)
+				hi = middle;
+			else
+				lo = middle;
+		}
+
+		return 0.5 * (lo + hi);
+	}
+
+
+
+	// x = (T - lambda I)^-1 x with Gaussian elimination with partial pivoting
+	// on the tridiagonal matrix, a zero pivot is replaced by a tiny one
+	void SolveShiftedTridiagonal(long n, const double *d, const double *e, double lambda, double tiny, double *x,
+								 double *u0, double *u1, double *u2, double *multiplier, bool *swapped)
+	{
+		for (long i = 0; i < n; ++i) {
+			u0[i] = d[i] - lambda;
+			u1[i] = (i < n - 1) ? e[i] : 0.0;
+			u2[i] = 0.0;
+		}
+
+		for (long i = 0; i < n - 1; ++i) {
+			double below = e[i];
+			if (fabs(u0[i]) >= fabs(below)) {
+				if (u0[i] == 0.0)
+					u0[i] = tiny;
+				multiplier[i] = below / u0[i];
+				u0[i + 1] -= multiplier[i] * u1[i];
+				swapped[i] = false;
+			}
+			else {
+				double l = u0[i] / below;
+				double oldU1 = u1[i];
+				double next = (i + 1 < n - 1) ? u1[i + 1] : 0.0;
+				u0[i] = below;
+				u1[i] = u0[i + 1];
+				u2[i] = next;
+				u0[i + 1] = oldU1 - l * u1[i];
+				u1[i + 1] = -l * next;
+				multiplier[i] = l;
+				swapped[i] = true;
+			}
+		}
+
+		if (u0[n - 1] == 0.0)
+			u0[n - 1] = tiny;
+
+		for (long i = 0; i < n - 1; ++i) {
+			if (swapped[i])
+				swap(x[i], x[i + 1]);
+			x[i + 1] -= multiplier[i] * x[i];
+		}
+
+		for (long i = n - 1; i >= 0; --i) {
+			double sum = x[i];
+			if (i + 1 < n)
+				sum -= u1[i] * x[i + 1];
+			if (i + 2 < n)
+				sum -= u2[i] * x[i + 2];
+			x[i] = sum / u0[i];
+		}
+
+		return;
+	}
+
+
+
+	// eigenvectors of the tridiagonal matrix for the increasing eigenvalues
+	// lambda by inverse iteration, into the columns of the n x k block z
+	// vectors of a cluster are orthogonalized against each other, clusters
+	// are independent and go to different threads
+	void InverseIteration(long n, const double *d, const double *e, long k, double *lambda, double *z, long ldz)
+	{
+		double norm = 0.0;
+		for (long i = 0; i < n; ++i)
+			norm = max(norm, fabs(d[i]) + ((i > 0) ? fabs(e[i - 1]) : 0.0) + ((i < n - 1) ? fabs(e[i]) : 0.0));
+		double tiny = DBL_EPSILON * max(norm, DBL_MIN);
+		double separation = CLUSTER_TOLERANCE * norm;
+
+		// equal eigenvalues are pulled apart a little so the solves differ
+		for (long j = 1; j < k; ++j) {
+			double gap = 10.0 * DBL_EPSILON * max(fabs(lambda[j]), norm);
+			if (lambda[j] - lambda[j - 1] < gap)
+				lambda[j] = lambda[j - 1] + gap;
+		}
+
+		Array<long> clusterStart(k + 1);
+		long numClusters = 0;
+		for (long j = 0; j < k; ++j) {
+			if ((j == 0) || (lambda[j] - lambda[j - 1] > separation))
+				clusterStart[numClusters++] = j;
+		}
+		clusterStart[numClusters] = k;
+
+		#pragma omp parallel num_threads(NumThreads()) if (UseThreads((double) n * k * INVERSE_ITERATIONS * 16.0))
+		{
+			Array<double> x(n), u0(n), u1(n), u2(n), multiplier(n);
+			Array<bool> swapped(n);
+
+			#pragma omp for schedule(dynamic)
+			for (long cluster = 0; cluster < numClusters; ++cluster) {
+				for (long j = clusterStart[cluster]; j < clusterStart[cluster + 1]; ++j) {
+					// a start vector that no eigenvector is likely to be
+					// orthogonal to
+					unsigned long seed = 12345 + 7919 * j;
+					for (long i = 0; i < n; ++i) {
+						seed = seed * 6364136223846793005UL + 1442695040888963407UL;
+						x[i] = (double) (seed >> 11) / 9007199254740992.0 - 0.5;
+					}
+
+					for (long iteration = 0; iteration < INVERSE_ITERATIONS; ++iteration) {
+						SolveShiftedTridiagonal(n, d, e, lambda[j], tiny, x.Begin(), u0.Begin(), u1.Begin(),
+												u2.Begin(), multiplier.Begin(), swapped.Begin());
+
+						for (long p = clusterStart[cluster]; p < j; ++p) {
+							double dot = 0.0;
+							for (long i = 0; i < n; ++i)
+								dot += z[i * ldz + p] * x[i];
+							for (long i = 0; i < n; ++i)
+								x[i] -= dot * z[i * ldz + p];
+						}
+
+						double length = 0.0;
+						for (long i = 0; i < n; ++i)
+							length += x[i] * x[i];
+						length = 1.0 / sqrt(length);
+						for (long i = 0; i < n; ++i)
+							x[i] *= length;
+					}
+
+					for (long i = 0; i < n; ++i)
+						z[i * ldz + j] = x[i];
+				}
+			}
+		}
+
+		return;
+	}
+}
+
+
+
+SymmetricEigensystem::SymmetricEigensystem()
+{
+	mSize = 0;
+	return;
+}
+
+
+
+SymmetricEigensystem::SymmetricEigensystem(const Matrix<double> &a, bool computeEigenvectors)
+{
+	mSize = 0;
+	Compute(a, computeEigenvectors);
+	return;
+}
+
+
+
+void SymmetricEigensystem::Reduce(const Matrix<double> &a)
+{
+	if (a.NumRows() != a.NumColumns())
+		ThrowException("SymmetricEigensystem : matrix is not square");
+
+	if (a.NumRows() == 0)
+		ThrowException("SymmetricEigensystem : matrix is empty");
+
+	long n = a.NumRows();
+	mSize = 0;
+	mEigenvectors.SetSize(0, 0);
+
+	mReduced = a;
+
+	mTau.SetSize(n);
+	mDiagonal.SetSize(n);
+	mOffDiagonal.SetSize(n);
+	mOffDiagonal[n - 1] = 0.0;
+	mTau[n - 1] = 0.0;
+
+	Tridiagonalize(n, mReduced.Data(), mReduced.Stride(), mDiagonal.Begin(), mOffDiagonal.Begin(), mTau.Begin());
+
+	return;
+}
+
+
+
+void SymmetricEigensystem::Compute(const Matrix<double> &a, bool computeEigenvectors)
+{
+	Reduce(a);
+
+	long n = a.NumRows();
+	mEigenvalues = mDiagonal;
+	Array<double> offDiagonal;
+	offDiagonal = mOffDiagonal;
+
+	if (computeEigenvectors) {
+		mEigenvectors.SetSize(n, n);
+		DivideAndConquer(n, mEigenvalues.Begin(), offDiagonal.Begin(), mEigenvectors.Data(), mEigenvectors.Stride());
+		ApplyReflectors(n, mReduced.Data(), mReduced.Stride(), mTau.Begin(), mEigenvectors.Data(),
+						mEigenvectors.Stride(), n);
+	}
+	else {
+		TridiagonalQL(n, mEigenvalues.Begin(), offDiagonal.Begin(), NULL, 0, 0);
+		sort(mEigenvalues.Begin(), mEigenvalues.Begin() + n);
+	}
+
+	mSize = n;
+
+	return;
+}
+
+
+
+void SymmetricEigensystem::ComputeExtreme(const Matrix<double> &a, long k, bool largest, bool computeEigenvectors)
+{
+	if ((k < 1) || (k > a.NumRows()))
+		ThrowException("SymmetricEigensystem::ComputeExtreme : k is out of range");
+
+	Reduce(a);
+
+	long n = a.NumRows();
+	const double *d = mDiagonal.Begin();
+	const double *e = mOffDiagonal.Begin();
+
+	double lo = d[0], hi = d[0];
+	for (long i = 0; i < n; ++i) {
+		double radius = ((i > 0) ? fabs(e[i - 1]) : 0.0) + ((i < n - 1) ? fabs(e[i]) : 0.0);
+		lo = min(lo, d[i] - radius);
+		hi = max(hi, d[i] + radius);
+	}
+
+	long first = largest ? n - k : 0;
+	mEigenvalues.SetSize(k);
+
+	#pragma omp parallel for num_threads(NumThreads()) if (UseThreads((double) n * k * 64.0))
+	for (long j = 0; j < k; ++j)
+		mEigenvalues[j] = BisectEigenvalue(n, d, e, first + j, lo, hi);
+
+	if (computeEigenvectors) {
+		Array<double> shifts;
+		shifts = mEigenvalues;
+		mEigenvectors.SetSize(n, k);
+		InverseIteration(n, d, e, k, shifts.Begin(), mEigenvectors.Data(), mEigenvectors.Stride());
+		ApplyReflectors(n, mReduced.Data(), mReduced.Stride(), mTau.Begin(), mEigenvectors.Data(),
+						mEigenvectors.Stride(), k);
+	}
+
+	mSize = n;
+
+	return;
+}
@@ -0,0 +1,523 @@
+/*
+ * Copyright (C) 2004-2018 David Bernstein <david.h.bernstein@gmail.com>
+ *
+ * This file is part of utility_cpp.
+ *
+ * utility_cpp is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * utility_cpp is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with utility_cpp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "tiledmatrix.h"
+#include "gemm.h"
+#include "lufactorization.h"
+#include "simd.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace utility;
+using namespace std;
+
+// The file is a header page followed by the tiles, tile column by tile
+// column. Nothing is read explicitly, the tiles are used where they are
+// mapped and the kernel pages them in on first touch. MADV_WILLNEED starts
+// that read ahead of time so the disk works while the current tiles are
+// multiplied, and MADV_DONTNEED drops a tile from the process once it is no
+// longer needed (for a shared mapping modified pages stay in the page cache
+// and are written back by the kernel, nothing is lost).
+
+namespace {
+	const char TILED_MATRIX_MAGIC[8] = {'U', 'T', 'I', 'L', 'T', 'I', 'L', 'E'};
+
+	struct TiledMatrixHeader {
+		char magic[8];
+		long rows;
+		long columns;
+		long tileSize;
+	};
+
+
+
+	string SystemError(const string &message)
+	{
+		return message + " : " + strerror(errno);
+	}
+
+
+
+	size_t FileSize(long tileRows, long tileColumns, long tileSize)
+	{
+		return (size_t) TILED_MATRIX_HEADER_SIZE + (size_t) tileRows * tileColumns * tileSize * tileSize * sizeof(double);
+	}
+
+
+
+	void SwapRows(long n, double *a, double *b)
+	{
+		for (long j = 0; j < n; ++j) {
+			double t = a[j];
+			a[j] = b[j];
+			b[j] = t;
+		}
+
+		return;
+	}
+
+
+
+	// madvise over the rows r0 to r1 - 1 of a tile column
+	void AdviseRows(const TiledMatrix &a, long J, long r0, long r1, bool willNeed)
+	{
+		if (r1 <= r0)
+			return;
+
+		long tileSize = a.TileSize();
+		long I0 = r0 / tileSize;
+		long I1 = (r1 - 1) / tileSize;
+		for (long I = I0; I <= I1; ++I) {
+			if (willNeed)
+				a.PrefetchTile(I, J);
+			else
+				a.ReleaseTile(I, J);
+		}
+
+		return;
+	}
+}
+
+
+
+TiledMatrix::TiledMatrix()
+{
+	mFile = -1;
+	mMap = NULL;
+	mMapSize = 0;
+	mRows = 0;
+	mColumns = 0;
+	mTileSize = 0;
+	mTileRows = 0;
+	mTileColumns = 0;
+	return;
+}
+
+
+
+TiledMatrix::~TiledMatrix()
+{
+	// no exceptions out of a destructor
+	if (mMap != NULL)
+		munmap(mMap, mMapSize);
+
+	if (mFile >= 0)
+		close(mFile);
+
+	return;
+}
+
+
+
+void TiledMatrix::Create(const string &fileName, long numRows, long numColumns, long tileSize)
+{
+	if ((numRows <= 0) || (numColumns <= 0) || (tileSize <= 0))
+		ThrowException("TiledMatrix::Create : sizes must be positive");
+
+	Close();
+
+	mFile = open(fileName.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (mFile < 0)
+		ThrowException(SystemError("TiledMatrix::Create : can't create " + fileName));
+
+	mRows = numRows;
+	mColumns = numColumns;
+	mTileSize = tileSize;
+	mTileRows = (numRows + tileSize - 1) / tileSize;
+	mTileColumns = (numColumns + tileSize - 1) / tileSize;
+
+	// the file is sparse, tiles read as zeros until they are written
+	size_t size = FileSize(mTileRows, mTileColumns, mTileSize);
+	if (ftruncate(mFile, (off_t) size) != 0)
+		ThrowException(SystemError("TiledMatrix::Create : can't size " + fileName));
+
+	Map(fileName, size);
+
+	TiledMatrixHeader *header = (TiledMatrixHeader *) mMap;
+	memcpy(header->magic, TILED_MATRIX_MAGIC, sizeof(TILED_MATRIX_MAGIC));
+	header->rows = mRows;
+	header->columns = mColumns;
+	header->tileSize = mTileSize;
+
+	return;
+}
+
+
+
+void TiledMatrix::Open(const string &fileName)
+{
+	Close();
+
+	mFile = open(fileName.c_str(), O_RDWR);
+	if (mFile < 0)
+		ThrowException(SystemError("TiledMatrix::Open : can't open " + fileName));
+
+	TiledMatrixHeader header;
+	if (pread(mFile, &header, sizeof(header), 0) != (ssize_t) sizeof(header))
+		ThrowException("TiledMatrix::Open : " + fileName + " is too short");
+
+	if ((memcmp(header.magic, TILED_MATRIX_MAGIC, sizeof(TILED_MATRIX_MAGIC)) != 0) ||
+		(header.rows <= 0) || (header.columns <= 0) || (header.tileSize <= 0))
+		ThrowException("TiledMatrix::Open : " + fileName + " is not a tiled matrix");
+
+	mRows = header.rows;
+	mColumns = header.columns;
+	mTileSize = header.tileSize;
+	mTileRows = (mRows + mTileSize - 1) / mTileSize;
+	mTileColumns = (mColumns + mTileSize - 1) / mTileSize;
+
+	size_t size = FileSize(mTileRows, mTileColumns, mTileSize);
+	struct stat status;
+	if ((fstat(mFile, &status) != 0) || ((size_t) status.st_size < size))
+		ThrowException("TiledMatrix::Open : " + fileName + " is truncated");
+
+	Map(fileName, size);
+
+	return;
+}
+
+
+
+void TiledMatrix::Close()
+{
+	if (mMap != NULL) {
+		Flush();
+		munmap(mMap, mMapSize);
+		mMap = NULL;
+		mMapSize = 0;
+	}
+
+	if (mFile >= 0) {
+		close(mFile);
+		mFile = -1;
+	}
+
+	mRows = 0;
+	mColumns = 0;
+	mTileSize = 0;
+	mTileRows = 0;
+	mTileColumns = 0;
+
+	return;
+}
+
+
+
+void TiledMatrix::Map(const string &fileName, size_t size)
+{
+	void *map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, mFile, 0);
+	if (map == MAP_FAILED)
+		ThrowException(SystemError("TiledMatrix::Map : can't map " + fileName));
+
+	mMap = (char *) map;
+	mMapSize = size;
+
+	// the algorithms say what they need next, the kernel's own read ahead
+	// would guess from the page order instead
+	madvise(mMap, mMapSize, MADV_RANDOM);
+
+	return;
+}
+
+
+
+void TiledMatrix::PrefetchTile(long I, long J) const
+{
+	Advise(I, J, MADV_WILLNEED);
+	return;
+}
+
+
+
+void TiledMatrix::ReleaseTile(long I, long J) const
+{
+	Advise(I, J, MADV_DONTNEED);
+	return;
+}
+
+
+
+void TiledMatrix::Advise(long I, long J, int advice) const
+{
+	if ((I < 0) || (I >= mTileRows) || (J < 0) || (J >= mTileColumns))
+		return;
+
+	// madvise wants a page aligned start, the pages a tile shares with its
+	// neighbours are left alone when releasing
+	static const size_t pageSize = (size_t) sysconf(_SC_PAGESIZE);
+
+	size_t begin = (const char *) Tile(I, J) - mMap;
+	size_t end = begin + (size_t) mTileSize * mTileSize * sizeof(double);
+	if (advice == MADV_DONTNEED) {
+		begin = (begin + pageSize - 1) / pageSize * pageSize;
+		end = end / pageSize * pageSize;
+	}
+	else {
+		begin = begin / pageSize * pageSize;
+	}
+
+	if (end > begin)
+		madvise(mMap + begin, end - begin, advice);
+
+	return;
+}
+
+
+
+void TiledMatrix::Flush()
+{
+	if (mMap == NULL)
+		return;
+
+	if (msync(mMap, mMapSize, MS_SYNC) != 0)
+		ThrowException(SystemError("TiledMatrix::Flush : msync failed"));
+
+	return;
+}
+
+
+
+void TiledMatrix::CopyFrom(const Matrix<double> &m)
+{
+	if ((m.NumRows() != mRows) || (m.NumColumns() != mColumns))
+		ThrowException("TiledMatrix::CopyFrom : matrix has the wrong size");
+
+	for (long J = 0; J < mTileColumns; ++J) {
+		long j0 = J * mTileSize;
+		long columns = TileColumns(J);
+		for (long I = 0; I < mTileRows; ++I) {
+			double *tile = Tile(I, J);
+			for (long i = 0; i < TileRows(I); ++i)
+				memcpy(tile + i * mTileSize, m.Data() + (I * mTileSize + i) * m.Stride() + j0, columns * sizeof(double));
+		}
+	}
+
+	return;
+}
+
+
+
+void TiledMatrix::CopyTo(Matrix<double> &m) const
+{
+	m.SetSize(mRows, mColumns);
+
+	for (long J = 0; J < mTileColumns; ++J) {
+		long j0 = J * mTileSize;
+		long columns = TileColumns(J);
+		for (long I = 0; I < mTileRows; ++I) {
+			const double *tile = Tile(I, J);
+			for (long i = 0; i < TileRows(I); ++i)
+				memcpy(m.Data() + (I * mTileSize + i) * m.Stride() + j0, tile + i * mTileSize, columns * sizeof(double));
+		}
+	}
+
+	return;
+}
+
+
+
+namespace utility {
+void TiledGemm(double alpha, const TiledMatrix &a, const TiledMatrix &b, double beta, TiledMatrix &c)
+{
+	if ((a.NumColumns() != b.NumRows()) || (a.NumRows() != c.NumRows()) || (b.NumColumns() != c.NumColumns()))
+		ThrowException("TiledGemm : matrix sizes don't match");
+
+	if ((a.TileSize() != b.TileSize()) || (a.TileSize() != c.TileSize()))
+		ThrowException("TiledGemm : tile sizes don't match");
+
+	long tileSize = c.TileSize();
+	long tileElements = tileSize * tileSize;
+	long numK = a.NumTileColumns();
+
+	a.PrefetchTile(0, 0);
+	b.PrefetchTile(0, 0);
+
+	for (long I = 0; I < c.NumTileRows(); ++I) {
+		for (long J = 0; J < c.NumTileColumns(); ++J) {
+			c.PrefetchTile(I, J);
+
+			double *cTile = c.Tile(I, J);
+			if (beta == 0.0)
+				VectorZero(tileElements, cTile);
+			else if (beta != 1.0)
+				VectorScale(tileElements, beta, cTile);
+
+			for (long K = 0; K < numK; ++K) {
+				// the next pair is read while this one is multiplied
+				if (K + 1 < numK) {
+					a.PrefetchTile(I, K + 1);
+					b.PrefetchTile(K + 1, J);
+				}
+				else if (J + 1 < c.NumTileColumns()) {
+					a.PrefetchTile(I, 0);
+					b.PrefetchTile(0, J + 1);
+				}
+				else {
+					a.PrefetchTile(I + 1, 0);
+					b.PrefetchTile(0, 0);
+				}
+
+				Gemm(c.TileRows(I), c.TileColumns(J), a.TileColumns(K), alpha, a.Tile(I, K), tileSize,
+					 b.Tile(K, J), tileSize, 1.0, cTile, tileSize);
+
+				// a tile of b comes back once per tile row of c, so it isn't
+				// kept around
+				b.ReleaseTile(K, J);
+			}
+
+			c.ReleaseTile(I, J);
+		}
+
+		// the tile row of a is done with
+		for (long K = 0; K < numK; ++K)
+			a.ReleaseTile(I, K);
+	}
+
+	return;
+}
+
+
+
+bool TiledLUFactor(TiledMatrix &a, Array<long> &pivot)
+{
+	if (a.NumRows() != a.NumColumns())
+		ThrowException("TiledLUFactor : matrix is not square");
+
+	long n = a.NumRows();
+	long tileSize = a.TileSize();
+	long numTiles = a.NumTileColumns();
+	bool nonsingular = true;
+	double sign;
+
+	pivot.SetSize(n);
+
+	for (long K = 0; K < numTiles; ++K) {
+		long k0 = K * tileSize;
+		long kb = a.TileColumns(K);
+		long below = n - k0 - kb;
+
+		// the part of tile column K on and below the diagonal is one
+		// (n - k0) x kb row-major block
+		AdviseRows(a, K, k0, n, true);
+		if (!FactorLU(n - k0, kb, a.Tile(K, K), tileSize, pivot.Begin() + k0, sign))
+			nonsingular = false;
+
+		for (long j = k0; j < k0 + kb; ++j)
+			pivot[j] += k0;
+
+		if (K + 1 < numTiles)
+			AdviseRows(a, K + 1, k0, n, true);
+
+		for (long J = K + 1; J < numTiles; ++J) {
+			// the rows of tile column J from k0 down, while it is updated the
+			// next column is read
+			double *column = a.Tile(0, J);
+			long columns = a.TileColumns(J);
+			if (J + 1 < numTiles)
+				AdviseRows(a, J + 1, k0, n, true);
+
+			for (long j = k0; j < k0 + kb; ++j) {
+				if (pivot[j] != j)
+					SwapRows(columns, column + j * tileSize, column + pivot[j] * tileSize);
+			}
+
+			// U_KJ = L_KK^-1 A_KJ
+			SolveUnitLower(kb, a.Tile(K, K), tileSize, columns, a.Tile(K, J), tileSize);
+
+			// A_IJ -= L_IK U_KJ for all I > K at once
+			if (below > 0)
+				Gemm(below, columns, kb, -1.0, a.Tile(K + 1, K), tileSize, a.Tile(K, J), tileSize,
+					 1.0, a.Tile(K + 1, J), tileSize);
+
+			// column K + 1 is the next panel
+			if (J > K + 1)
+				AdviseRows(a, J, k0, n, false);
+		}
+
+		AdviseRows(a, K, k0, n, false);
+	}
+
+	return nonsingular;
+}
+
+
+
+void TiledLUSolve(const TiledMatrix &lu, const Array<long> &pivot, Matrix<double> &b)
+{
+	long n = lu.NumRows();
+	if ((lu.NumColumns() != n) || (pivot.Size() != n))
+		ThrowException("TiledLUSolve : no factorization");
+
+	if (b.NumRows() != n)
+		ThrowException("TiledLUSolve : right hand side has the wrong number of rows");
+
+	long m = b.NumColumns();
+	double *x = b.Data();
+	long ldx = b.Stride();
+	long tileSize = lu.TileSize();
+	long numTiles = lu.NumTileColumns();
+
+	// L y = P b a tile column at a time, the interchanges of each step are
+	// applied just before the column of L they were made for, which is the
+	// row order that column was stored in
+	for (long K = 0; K < numTiles; ++K) {
+		long k0 = K * tileSize;
+		long kb = lu.TileColumns(K);
+		long below = n - k0 - kb;
+
+		AdviseRows(lu, K, k0, n, true);
+		for (long j = k0; j < k0 + kb; ++j) {
+			if (pivot[j] != j)
+				SwapRows(m, x + j * ldx, x + pivot[j] * ldx);
+		}
+
+		SolveUnitLower(kb, lu.Tile(K, K), tileSize, m, x + k0 * ldx, ldx);
+		if (below > 0)
+			Gemm(below, m, kb, -1.0, lu.Tile(K + 1, K), tileSize, x + k0 * ldx, ldx, 1.0, x + (k0 + kb) * ldx, ldx);
+
+		AdviseRows(lu, K, k0 + kb, n, false);
+	}
+
+	// U x = y from the bottom tile row up
+	for (long K = numTiles - 1; K >= 0; --K) {
+		long k0 = K * tileSize;
+		long kb = lu.TileRows(K);
+
+		for (long J = K + 1; J < numTiles; ++J) {
+			if (J + 1 < numTiles)
+				lu.PrefetchTile(K, J + 1);
+			long j0 = J * tileSize;
+			Gemm(kb, m, lu.TileColumns(J), -1.0, lu.Tile(K, J), tileSize, x + j0 * ldx, ldx, 1.0, x + k0 * ldx, ldx);
+			lu.ReleaseTile(K, J);
+		}
+
+		SolveUpper(kb, lu.Tile(K, K), tileSize, m, x + k0 * ldx, ldx);
+		lu.ReleaseTile(K, K);
+		if (K > 0)
+			lu.PrefetchTile(K - 1, K - 1);
+	}
+
+	return;
+}
+}
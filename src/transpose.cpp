@@ -0,0 +1,269 @@
+/*
+ * Copyright (C) 2004-2018 David Bernstein <david.h.bernstein@gmail.com>
+ *
+ * This file is part of utility_cpp.
+ *
+ * utility_cpp is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * utility_cpp is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with utility_cpp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "transpose.h"
+#include "matrixexpression.h"
+#include "parallel.h"
+
+using namespace utility;
+using namespace std;
+
+// A naive transpose reads rows and writes columns, so once a column of the
+// result no longer fits in cache nearly every store misses. The out of place
+// transpose here halves the longer side of the matrix recursively until the
+// pieces are small enough that a piece of A and of B both sit in L1, which
+// works for every level of cache without knowing its size. Strips of rows
+// are handed out to the threads.
+
+namespace {
+	// side of the pieces transposed directly, 32 x 32 doubles is 8K
+	const long TRANSPOSE_BLOCK = 32;
+
+	// rows of A handed to one thread
+	const long TRANSPOSE_STRIP = 256;
+
+
+
+	inline long Min(long a, long b)
+	{
+		return (a < b) ? a : b;
+	}
+
+
+
+	template<bool CONJUGATE, class T>
+	inline T TransposeElement(const T &x)
+	{
+		return CONJUGATE ? ConjugateElement(x) : x;
+	}
+
+
+
+	template<bool CONJUGATE, class T>
+	void TransposeRecursive(long m, long n, const T *a, long lda, T *b, long ldb)
+	{
+		if ((m <= TRANSPOSE_BLOCK) && (n <= TRANSPOSE_BLOCK)) {
+			for (long i = 0; i < m; ++i) {
+				const T *row = a + i * lda;
+				for (long j = 0; j < n; ++j)
+					b[j * ldb + i] = TransposeElement<CONJUGATE>(row[j]);
+			}
+
+			return;
+		}
+
+		if (m >= n) {
+			long half = m / 2;
+			TransposeRecursive<CONJUGATE>(half, n, a, lda, b, ldb);
+			TransposeRecursive<CONJUGATE>(m - half, n, a + half * lda, lda, b + half, ldb);
+		}
+		else {
+			long half = n / 2;
+			TransposeRecursive<CONJUGATE>(m, half, a, lda, b, ldb);
+			TransposeRecursive<CONJUGATE>(m, n - half, a + half, lda, b + half * ldb, ldb);
+		}
+
+		return;
+	}
+
+
+
+	template<bool CONJUGATE, class T>
+	void OutOfPlaceTranspose(long m, long n, const T *a, long lda, T *b, long ldb)
+	{
+		if ((m < 0) || (n < 0))
+			ThrowException("TransposeMatrix : negative size");
+
+		long numStrips = (m + TRANSPOSE_STRIP - 1) / TRANSPOSE_STRIP;
+
+		#pragma omp parallel for num_threads(NumThreads()) if (UseThreads((double) m * n))
+		for (long strip = 0; strip < numStrips; ++strip) {
+			long i0 = strip * TRANSPOSE_STRIP;
+			long rows = Min(TRANSPOSE_STRIP, m - i0);
+			TransposeRecursive<CONJUGATE>(rows, n, a + i0 * lda, lda, b + i0, ldb);
+		}
+
+		return;
+	}
+
+
+
+	// n x n with stride n, the block pairs on either side of the diagonal
+	// are swapped and the diagonal blocks transposed where they are
+	template<bool CONJUGATE, class T>
+	void SquareTransposeInPlace(long n, T *a)
+	{
+		long numBlocks = (n + TRANSPOSE_BLOCK - 1) / TRANSPOSE_BLOCK;
+
+		#pragma omp parallel for schedule(dynamic) num_threads(NumThreads()) if (UseThreads((double) n * n))
+		for (long bi = 0; bi < numBlocks; ++bi) {
+			long i0 = bi * TRANSPOSE_BLOCK;
+			long i1 = Min(i0 + TRANSPOSE_BLOCK, n);
+
+			// diagonal block
+			for (long i = i0; i < i1; ++i) {
+				a[i * n + i] = TransposeElement<CONJUGATE>(a[i * n + i]);
+				for (long j = i + 1; j < i1; ++j) {
+					T tmp = a[i * n + j];
+					a[i * n + j] = TransposeElement<CONJUGATE>(a[j * n + i]);
+					a[j * n + i] = TransposeElement<CONJUGATE>(tmp);
+				}
+			}
+
+			// the blocks to its right and their mirror images below it
+			for (long j0 = i1; j0 < n; j0 += TRANSPOSE_BLOCK) {
+				long j1 = Min(j0 + TRANSPOSE_BLOCK, n);
+				for (long i = i0; i < i1; ++i) {
+					for (long j = j0; j < j1; ++j) {
+						T tmp = a[i * n + j];
+						a[i * n + j] = TransposeElement<CONJUGATE>(a[j * n + i]);
+						a[j * n + i] = TransposeElement<CONJUGATE>(tmp);
+					}
+				}
+			}
+		}
+
+		return;
+	}
+
+
+
+	// m x n with stride n, element k = i * n + j moves to j * m + i, which is
+	// k * m mod (m n - 1) apart from the first and last elements, so position
+	// p is filled from p * n mod (m n - 1)
+	template<class T>
+	void RectangularTransposeInPlace(long m, long n, T *a)
+	{
+		long size = m * n;
+		if (size < 3)
+			return;
+
+		long modulus = size - 1;
+		vector<bool> moved(size, false);
+
+		for (long start = 1; start < modulus; ++start) {
+			if (moved[start])
+				continue;
+
+			T tmp = a[start];
+			long p = start;
+			while (true) {
+				moved[p] = true;
+				long source = (p * n) % modulus;
+				if (source == start) {
+					a[p] = tmp;
+					break;
+				}
+				a[p] = a[source];
+				p = source;
+			}
+		}
+
+		return;
+	}
+
+
+
+	template<bool CONJUGATE, class T>
+	void InPlaceTranspose(long m, long n, T *a)
+	{
+		if ((m < 0) || (n < 0))
+			ThrowException("TransposeMatrixInPlace : negative size");
+
+		if (m == n) {
+			SquareTransposeInPlace<CONJUGATE>(n, a);
+			return;
+		}
+
+		RectangularTransposeInPlace(m, n, a);
+
+		if (CONJUGATE) {
+			for (long k = 0; k < m * n; ++k)
+				a[k] = TransposeElement<CONJUGATE>(a[k]);
+		}
+
+		return;
+	}
+}
+
+
+
+namespace utility {
+void TransposeMatrix(long m, long n, const double *a, long lda, double *b, long ldb)
+{
+	OutOfPlaceTranspose<false>(m, n, a, lda, b, ldb);
+	return;
+}
+
+
+
+void TransposeMatrix(long m, long n, const float *a, long lda, float *b, long ldb)
+{
+	OutOfPlaceTranspose<false>(m, n, a, lda, b, ldb);
+	return;
+}
+
+
+
+void TransposeMatrix(long m, long n, const ComplexNumber *a, long lda, ComplexNumber *b, long ldb)
+{
+	OutOfPlaceTranspose<false>(m, n, a, lda, b, ldb);
+	return;
+}
+
+
+
+void AdjointMatrix(long m, long n, const ComplexNumber *a, long lda, ComplexNumber *b, long ldb)
+{
+	OutOfPlaceTranspose<true>(m, n, a, lda, b, ldb);
+	return;
+}
+
+
+
+void TransposeMatrixInPlace(long m, long n, double *a)
+{
+	InPlaceTranspose<false>(m, n, a);
+	return;
+}
+
+
+
+void TransposeMatrixInPlace(long m, long n, float *a)
+{
+	InPlaceTranspose<false>(m, n, a);
+	return;
+}
+
+
+
+void TransposeMatrixInPlace(long m, long n, ComplexNumber *a)
+{
+	InPlaceTranspose<false>(m, n, a);
+	return;
+}
+
+
+
+void AdjointMatrixInPlace(long m, long n, ComplexNumber *a)
+{
+	InPlaceTranspose<true>(m, n, a);
+	return;
+}
+}
@@ -0,0 +1,245 @@
+/*
+ * Copyright (C) 2004-2018 David Bernstein <david.h.bernstein@gmail.com>
+ *
+ * This file is part of utility_cpp.
+ *
+ * utility_cpp is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * utility_cpp is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with utility_cpp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "workspacepool.h"
+
+#include <new>
+#include <vector>
+
+using namespace utility;
+using namespace std;
+
+// Each thread reaches its lists through a plain thread_local pointer, which
+// stays readable until the thread is gone. The lists themselves are freed
+// by the destructor of a second thread_local object, and after that the
+// pointer is NULL and the thread allocates and frees straight from the heap,
+// which matters for matrices destroyed after the main thread's
+// thread_locals, static ones for instance.
+
+namespace {
+	// the smallest class, smaller requests are rounded up to it
+	const long WORKSPACE_MIN_SHIFT = 6;
+
+	const long WORKSPACE_CLASSES_PER_DOUBLING = 4;
+	const long WORKSPACE_NUM_CLASSES = WORKSPACE_CLASSES_PER_DOUBLING * (64 - WORKSPACE_MIN_SHIFT) + 1;
+
+	size_t gCacheLimit = WORKSPACE_CACHE_LIMIT;
+
+
+
+	struct WorkspaceCache {
+		vector<void*> freeList[WORKSPACE_NUM_CLASSES];
+		WorkspaceStatistics statistics;
+
+		WorkspaceCache(void)
+		{
+			statistics.hits = 0;
+			statistics.misses = 0;
+			statistics.releases = 0;
+			statistics.discards = 0;
+			statistics.cachedBytes = 0;
+		}
+
+		void Trim(void)
+		{
+			for (long i = 0; i < WORKSPACE_NUM_CLASSES; ++i) {
+				for (size_t j = 0; j < freeList[i].size(); ++j)
+					::operator delete(freeList[i][j]);
+				freeList[i].clear();
+			}
+			statistics.cachedBytes = 0;
+
+			return;
+		}
+	};
+
+
+
+	thread_local WorkspaceCache *tCache = NULL;
+	thread_local bool tCacheDestroyed = false;
+
+	struct WorkspaceCacheOwner {
+		~WorkspaceCacheOwner(void)
+		{
+			if (tCache != NULL) {
+				tCache->Trim();
+				delete tCache;
+			}
+
+			tCache = NULL;
+			tCacheDestroyed = true;
+		}
+
+		bool registered;
+	};
+
+	thread_local WorkspaceCacheOwner tCacheOwner;
+
+
+
+	// NULL once the thread is shutting down
+	WorkspaceCache* Cache()
+	{
+		if ((tCache == NULL) && !tCacheDestroyed) {
+			// touching the owner constructs it, so its destructor runs
+			// when the thread exits
+			tCacheOwner.registered = true;
+			tCache = new WorkspaceCache;
+		}
+
+		return tCache;
+	}
+
+
+
+	// rounds bytes up to its size class, the classes between 2^e and
+	// 2^(e + 1) are 2^e (1 + q / 4) for q = 1, ..., 4
+	size_t SizeClass(size_t bytes, long &index)
+	{
+		long e = WORKSPACE_MIN_SHIFT;
+		if (bytes <= ((size_t) 1 << e)) {
+			index = 0;
+			return (size_t) 1 << e;
+		}
+
+		while (((size_t) 1 << (e + 1)) < bytes)
+			++e;
+
+		size_t base = (size_t) 1 << e;
+		size_t step = base / WORKSPACE_CLASSES_PER_DOUBLING;
+		size_t q = (bytes - base + step - 1) / step;
+		index = WORKSPACE_CLASSES_PER_DOUBLING * (e - WORKSPACE_MIN_SHIFT) + (long) q;
+
+		return base + q * step;
+	}
+}
+
+
+
+namespace utility {
+void* WorkspaceAllocate(size_t bytes)
+{
+	long index;
+	size_t size = SizeClass(bytes, index);
+
+	WorkspaceCache *cache = Cache();
+	if (cache == NULL)
+		return ::operator new(size);
+
+	vector<void*> &list = cache->freeList[index];
+	if (!list.empty()) {
+		void *p = list.back();
+		list.pop_back();
+		cache->statistics.cachedBytes -= size;
+		++cache->statistics.hits;
+		return p;
+	}
+
+	++cache->statistics.misses;
+	return ::operator new(size);
+}
+
+
+
+void WorkspaceRelease(void *p, size_t bytes)
+{
+	if (p == NULL)
+		return;
+
+	long index;
+	size_t size = SizeClass(bytes, index);
+
+	WorkspaceCache *cache = Cache();
+	if (cache == NULL) {
+		::operator delete(p);
+		return;
+	}
+
+	if (cache->statistics.cachedBytes + size > gCacheLimit) {
+		++cache->statistics.discards;
+		::operator delete(p);
+		return;
+	}
+
+	cache->freeList[index].push_back(p);
+	cache->statistics.cachedBytes += size;
+	++cache->statistics.releases;
+
+	return;
+}
+
+
+
+void SetWorkspaceCacheLimit(size_t bytes)
+{
+	gCacheLimit = bytes;
+	return;
+}
+
+
+
+size_t WorkspaceCacheLimit()
+{
+	return gCacheLimit;
+}
+
+
+
+void TrimWorkspaceCache()
+{
+	WorkspaceCache *cache = Cache();
+	if (cache != NULL)
+		cache->Trim();
+
+	return;
+}
+
+
+
+WorkspaceStatistics GetWorkspaceStatistics()
+{
+	WorkspaceStatistics statistics;
+	statistics.hits = 0;
+	statistics.misses = 0;
+	statistics.releases = 0;
+	statistics.discards = 0;
+	statistics.cachedBytes = 0;
+
+	WorkspaceCache *cache = Cache();
+	if (cache != NULL)
+		statistics = cache->statistics;
+
+	return statistics;
+}
+
+
+
+void ResetWorkspaceStatistics()
+{
+	WorkspaceCache *cache = Cache();
+	if (cache != NULL) {
+		cache->statistics.hits = 0;
+		cache->statistics.misses = 0;
+		cache->statistics.releases = 0;
+		cache->statistics.discards = 0;
+	}
+
+	return;
+}
+}